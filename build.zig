@@ -129,6 +129,13 @@ fn addServerExecutable(
             "main.c",
             "server.c",
             "jsonrpc.c",
+            "msgpack.c",
+            "websocket.c",
+            "router.c",
+            "pool.c",
+            "timer_wheel.c",
+            "flow_control.c",
+            "uring_server.c",
             "arena.c",
             "parson.c",
         },
@@ -184,6 +191,14 @@ fn addBenchExecutable(
         .file = b.path("tools/bench_rps.c"),
         .flags = c_flags,
     });
+    exe.addCSourceFile(.{
+        .file = b.path("src/msgpack.c"),
+        .flags = c_flags,
+    });
+    exe.addCSourceFile(.{
+        .file = b.path("src/websocket.c"),
+        .flags = c_flags,
+    });
     exe.addCSourceFile(.{
         .file = b.path("src/parson.c"),
         .flags = c_flags,
@@ -231,6 +246,12 @@ fn addTestsExecutable(
         .files = &.{
             "testing/tests.c",
             "src/jsonrpc.c",
+            "src/msgpack.c",
+            "src/websocket.c",
+            "src/router.c",
+            "src/pool.c",
+            "src/timer_wheel.c",
+            "src/flow_control.c",
             "src/arena.c",
             "src/parson.c",
         },
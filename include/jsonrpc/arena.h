@@ -252,11 +252,21 @@ typedef struct Arena_Allocation_s {
 
 #endif /* ARENA_DEBUG */
 
+typedef struct Arena_Block_s {
+  struct Arena_Block_s *next;
+  size_t size;
+  alignas(max_align_t) char data[];
+} Arena_Block;
+
 typedef struct {
   char *region;
   size_t index;
   size_t size;
 
+  /* Chained arenas only (see arena_create_chained), nullptr otherwise. */
+  Arena_Block *block;   /* block backing region */
+  Arena_Block *retired; /* filled blocks, newest first */
+
 #ifdef ARENA_DEBUG
   size_t allocations;
   Arena_Allocation *head_allocation;
@@ -265,10 +275,12 @@ typedef struct {
 
 void arena_init(Arena *arena, void *region, size_t size);
 [[nodiscard]] Arena *arena_create(size_t size);
+[[nodiscard]] Arena *arena_create_chained(size_t initial_size);
 [[nodiscard]] void *arena_alloc(Arena *arena, size_t size);
 [[nodiscard]] void *arena_alloc_aligned(Arena *arena, size_t size,
                                         size_t alignment);
 [[nodiscard]] size_t arena_copy(Arena *dest, Arena *src);
+[[nodiscard]] bool arena_owns(const Arena *arena, const void *ptr);
 void arena_clear(Arena *arena);
 void arena_destroy(Arena *arena);
 #ifdef ARENA_DEBUG
@@ -305,6 +317,22 @@ Return:
 */
 [[nodiscard]] Arena *arena_create(size_t size);
 
+/*
+Same as arena_create, except that the arena never runs out
+of room: when an allocation does not fit, the current block
+is retired and a new one of at least twice its size is
+linked in. arena_clear keeps only the largest block, so an
+arena that is cleared between similar workloads settles on
+a single block. Pointers stay valid until the next clear.
+
+Parameters:
+  size_t initial_size    |    The size (in bytes) of the
+                              first block.
+Return:
+  Pointer to arena on success, nullptr on failure
+*/
+[[nodiscard]] Arena *arena_create_chained(size_t initial_size);
+
 /*
 Return a pointer to a portion of specified size of the
 specified arena's region. Nothing will restrict you
@@ -368,10 +396,25 @@ Return:
 */
 [[nodiscard]] size_t arena_copy(Arena *dest, Arena *src);
 
+/*
+Check whether a pointer lies in memory handed out by the
+arena since it was last cleared. For chained arenas every
+block is searched.
+
+Parameters:
+  Arena *arena    |    The arena to search.
+  void *ptr       |    The pointer to look up.
+
+Return:
+  true if ptr belongs to the arena, false otherwise.
+*/
+[[nodiscard]] bool arena_owns(const Arena *arena, const void *ptr);
+
 /*
 Reset the pointer to the arena region to the beginning
 of the allocation. Allows reuse of the memory without
-expensive frees.
+expensive frees. Chained arenas also free every block
+except the largest one.
 
 Parameters:
   Arena *arena    |    The arena to be cleared.
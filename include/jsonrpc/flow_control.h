@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief High and low watermarks on a byte count, e.g. a connection's queued
+ * responses. Past high the producer pauses; at or below low it resumes, so a
+ * count hovering around one mark does not toggle on every change.
+ */
+typedef struct {
+  size_t high; // 0 disables the watermarks
+  size_t low;
+} jsonrpc_watermarks_t;
+
+/**
+ * @brief What a watermark check asks the caller to do.
+ */
+typedef enum {
+  JSONRPC_WATERMARK_HOLD,   // keep the current state
+  JSONRPC_WATERMARK_PAUSE,  // crossed high while running
+  JSONRPC_WATERMARK_RESUME, // drained to low while paused
+} jsonrpc_watermark_action_t;
+
+/**
+ * @brief Watermarks for high; a low not below high defaults to a quarter of
+ * high.
+ */
+[[nodiscard]] jsonrpc_watermarks_t jsonrpc_watermarks_make(size_t high,
+                                                           size_t low);
+
+/**
+ * @brief Decide whether a producer at count bytes, currently paused or not,
+ * changes state. Disabled watermarks always hold.
+ */
+[[nodiscard]] jsonrpc_watermark_action_t
+jsonrpc_watermarks_check(const jsonrpc_watermarks_t *marks, size_t count,
+                         bool paused);
+
+/**
+ * @brief Admission policy for a listener: a cap on open connections and on
+ * accepts per loop iteration, each 0 for no limit.
+ */
+typedef struct {
+  size_t max_connections;
+  uint32_t accepts_per_tick;
+  bool pause_at_limit; // leave arrivals queued at the cap instead of shedding
+} jsonrpc_admission_t;
+
+/**
+ * @brief What to do with a connection waiting on the listener.
+ */
+typedef enum {
+  JSONRPC_ADMIT_ACCEPT,
+  JSONRPC_ADMIT_DEFER, // accept budget spent: retry next iteration
+  JSONRPC_ADMIT_SHED,  // at the cap: accept, reject and close it
+  JSONRPC_ADMIT_PAUSE, // at the cap: stop accepting until one closes
+} jsonrpc_admit_action_t;
+
+/**
+ * @brief Decide on one arrival, given the accepts already made this
+ * iteration and the connections open without it. A shed connection still
+ * counts against the accept budget.
+ */
+[[nodiscard]] jsonrpc_admit_action_t
+jsonrpc_admission_check(const jsonrpc_admission_t *policy,
+                        uint32_t accepts_this_tick, size_t open);
+
+/**
+ * @brief When a connection's unfinished message began, for a message
+ * timeout. The clock restarts whenever a read completes a message, so a peer
+ * pipelining requests is timed per message rather than from the first
+ * partial one it ever left buffered.
+ */
+typedef struct {
+  uint64_t since;     // start of the buffered partial message
+  uint64_t completed; // jsonrpc_conn_messages_completed at the last update
+  bool pending;       // a partial message is buffered
+} jsonrpc_partial_clock_t;
+
+/**
+ * @brief Update the clock after a read at now_ms that left pending_bytes of
+ * an unfinished message and brought the connection's completed count to
+ * completed.
+ * @return true when the clock (re)started at now_ms.
+ */
+[[nodiscard]] bool jsonrpc_partial_clock_update(jsonrpc_partial_clock_t *clock,
+                                                uint64_t now_ms,
+                                                size_t pending_bytes,
+                                                uint64_t completed);
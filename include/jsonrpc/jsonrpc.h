@@ -3,6 +3,7 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "jsonrpc/arena.h"
 #include "jsonrpc/parson.h"
 
 typedef struct jsonrpc_transport_s {
@@ -16,9 +17,70 @@ typedef struct jsonrpc_transport_s {
   bool (*send_raw)(struct jsonrpc_transport_s *self, const uint8_t *data,
                    size_t len);
   void (*close)(struct jsonrpc_transport_s *self);
+  /**
+   * @brief Optional zero-copy send path, used together with commit. Return a
+   * writable region at the tail of the outbound queue with room for at least
+   * min_len bytes and store its usable size in out_cap. Repeated calls for the
+   * same message must preserve bytes written into the previous reservation.
+   * @return nullptr on failure.
+   */
+  uint8_t *(*reserve)(struct jsonrpc_transport_s *self, size_t min_len,
+                      size_t *out_cap);
+  /**
+   * @brief Queue len bytes of the current reservation, starting skip bytes
+   * into it, as one message. The skipped bytes are dropped: they are what a
+   * frame header left of the room reserved for it. Same return contract as
+   * send_raw.
+   */
+  bool (*commit)(struct jsonrpc_transport_s *self, size_t skip, size_t len);
+  /**
+   * @brief Optional flow control, used together with resume_reads: stop
+   * feeding the connection until resume_reads is called. Input that arrives
+   * in the meantime is still accepted. HTTP framing pauses while requests
+   * are held behind a deferred one; without these hooks everything the peer
+   * pipelines is buffered.
+   */
+  void (*pause_reads)(struct jsonrpc_transport_s *self);
+  void (*resume_reads)(struct jsonrpc_transport_s *self);
 } jsonrpc_transport_t;
 
+/**
+ * @brief How messages are delimited on a connection, in both directions.
+ */
+typedef enum {
+  // One message per line. Every inbound byte is scanned for the '\n'.
+  JSONRPC_FRAMING_NEWLINE,
+  // A 4-byte big-endian payload length, then the payload.
+  JSONRPC_FRAMING_LENGTH_PREFIX,
+  // LSP-style headers ("Content-Length: N\r\n", others ignored) ended by an
+  // empty line, then the payload.
+  JSONRPC_FRAMING_CONTENT_LENGTH,
+  // HTTP/1.1 POST requests with Content-Length bodies, kept alive and
+  // pipelined. Each request gets exactly one response, in request order: the
+  // JSON-RPC response, or 204 No Content when there is none (notifications).
+  JSONRPC_FRAMING_HTTP,
+  // An HTTP upgrade handshake, then WebSocket frames (RFC 6455): each text or
+  // binary message carries one message, and the server sends notifications
+  // as well as responses. Control frames are answered by the library.
+  JSONRPC_FRAMING_WEBSOCKET,
+} jsonrpc_framing_t;
+
+// Longest header written ahead of a message, HTTP error responses included.
+constexpr size_t JSONRPC_FRAME_HEADER_MAX = 160U;
+
+/**
+ * @brief How message bodies are encoded on a connection, in both directions.
+ */
+typedef enum {
+  JSONRPC_ENCODING_JSON,
+  // MessagePack, decoded into and encoded from the same DOM (see msgpack.h).
+  JSONRPC_ENCODING_MSGPACK,
+} jsonrpc_encoding_t;
+
 typedef struct jsonrpc_conn_s jsonrpc_conn_t;
+typedef struct jsonrpc_router_s jsonrpc_router_t;
+typedef struct jsonrpc_request_handle_s jsonrpc_request_handle_t;
+typedef struct jsonrpc_method_s jsonrpc_method_t;
 
 /**
  * @brief Response container populated by on_request. The server
@@ -41,6 +103,22 @@ typedef struct {
                      const JSON_Value *params, jsonrpc_response_t *response);
   void (*on_notification)(jsonrpc_conn_t *conn, const char *method,
                           const JSON_Value *params);
+  /**
+   * @brief Optional method table (see jsonrpc/router.h), consulted before
+   * on_request and on_notification. Calls for methods it does not hold fall
+   * through to those callbacks. Not owned by the connection.
+   */
+  const jsonrpc_router_t *router;
+  /**
+   * @brief Optional executor for JSONRPC_METHOD_BLOCKING router methods.
+   * Called on the loop thread with the request already deferred (params
+   * kept); run method->handler elsewhere and hand the outcome back to the
+   * loop thread for jsonrpc_request_complete_response.
+   * @return false to run the handler inline instead; handle stays owned by
+   *         the library in that case.
+   */
+  bool (*offload)(jsonrpc_conn_t *conn, const jsonrpc_method_t *method,
+                  jsonrpc_request_handle_t *handle);
 } jsonrpc_callbacks_t;
 
 [[nodiscard]] jsonrpc_conn_t *jsonrpc_conn_new(jsonrpc_transport_t transport,
@@ -65,4 +143,172 @@ void jsonrpc_conn_feed(jsonrpc_conn_t *conn, const uint8_t *data, size_t len);
                                            const JSON_Value *id, int32_t code,
                                            const char *message);
 
+/**
+ * @brief Send a notification (a call without id) to the peer, e.g. to push
+ * events to WebSocket clients. Takes ownership of params (an array, an
+ * object or nullptr) on success/failure. Call on the connection's loop
+ * thread.
+ * @return false on failure, under HTTP framing where every message answers
+ *         a request, and before a WebSocket handshake has completed.
+ */
+[[nodiscard]] bool jsonrpc_conn_send_notification(jsonrpc_conn_t *conn,
+                                                  const char *method,
+                                                  JSON_Value *params);
+
 [[nodiscard]] void *jsonrpc_conn_get_context(jsonrpc_conn_t *conn);
+
+/**
+ * @brief Switch the connection from newline framing, before anything has been
+ * fed. Length-delimited frames are read without scanning the payload, and a
+ * message split across feeds is buffered in one allocation sized from its
+ * header. They may carry up to max_message_bytes (0 for the 64 KiB newline
+ * limit); larger ones are answered with an error and the connection closed.
+ * Under HTTP framing, requests pipelined behind a deferred one are held
+ * (within the same limit) until it has been answered. A WebSocket message
+ * over the limit, counting all its fragments, closes the connection with
+ * status 1009.
+ * @return false once input is buffered or the connection is closed, and for
+ *         newline framing once the connection speaks MessagePack.
+ */
+[[nodiscard]] bool jsonrpc_conn_set_framing(jsonrpc_conn_t *conn,
+                                            jsonrpc_framing_t framing,
+                                            size_t max_message_bytes);
+
+/**
+ * @brief Let a connection with length-delimited framing speak MessagePack.
+ * Its first message decides: one that starts with a MessagePack map or array
+ * (a request or a batch) switches the connection to MessagePack for the rest
+ * of its life, responses and errors included; anything else keeps it on JSON.
+ * Handlers see the same DOM either way.
+ * @return false under newline framing, once input is buffered or the
+ *         connection is closed.
+ */
+[[nodiscard]] bool jsonrpc_conn_allow_msgpack(jsonrpc_conn_t *conn);
+
+/**
+ * @brief Encoding the connection uses; JSON until a first message has
+ * switched it to MessagePack.
+ */
+[[nodiscard]] jsonrpc_encoding_t
+jsonrpc_conn_get_encoding(const jsonrpc_conn_t *conn);
+
+/**
+ * @brief Write the header that precedes a body_len-byte message under framing
+ * into out (JSONRPC_FRAME_HEADER_MAX bytes). Newline framing has no header;
+ * its messages end with '\n' instead. For HTTP this is a 200 response header
+ * for a JSON body on a kept-alive connection, for WebSocket a text frame
+ * header.
+ * @return header length; 0 for newline framing, and for a length prefix
+ *         that body_len does not fit in.
+ */
+[[nodiscard]] size_t jsonrpc_frame_header(jsonrpc_framing_t framing,
+                                          size_t body_len, uint8_t *out);
+
+/**
+ * @brief Tell the connection its input is read into a buffer shared with
+ * other connections. It then releases its inbound buffer whenever that
+ * drains, so an idle connection holds no read memory; otherwise the buffer
+ * is kept for the next unfinished message.
+ */
+void jsonrpc_conn_set_shared_reads(jsonrpc_conn_t *conn, bool shared);
+
+/**
+ * @brief Give the connection an arena (e.g. from a pool) to parse into instead
+ * of creating one on its first message. The connection takes ownership.
+ * @return false if the connection already has an arena.
+ */
+[[nodiscard]] bool jsonrpc_conn_set_arena(jsonrpc_conn_t *conn, Arena *arena);
+
+/**
+ * @brief Take the connection's (cleared) arena back, e.g. to pool it before
+ * jsonrpc_conn_free. The connection creates a new one if it parses again.
+ * @return nullptr if it has none or is inside a callback.
+ */
+[[nodiscard]] Arena *jsonrpc_conn_take_arena(jsonrpc_conn_t *conn);
+
+/**
+ * @brief Release memory the connection holds but is not using: empty inbound
+ * and outbound buffers, and an arena grown past its initial size. Meant for a
+ * server that stops reading from the connection to save memory; buffers are
+ * allocated again on demand. Does nothing inside a callback.
+ */
+void jsonrpc_conn_trim(jsonrpc_conn_t *conn);
+
+/**
+ * @brief Bytes the connection currently holds in its inbound and outbound
+ * buffers and its arena, for memory accounting.
+ */
+[[nodiscard]] size_t jsonrpc_conn_memory_usage(const jsonrpc_conn_t *conn);
+
+/**
+ * @brief Bytes of an unfinished message buffered from earlier feeds, e.g.
+ * for a server to time out peers that never finish a line or frame.
+ */
+[[nodiscard]] size_t jsonrpc_conn_pending_input(const jsonrpc_conn_t *conn);
+
+/**
+ * @brief Messages the connection has received in full so far. A server can
+ * compare it across reads to tell a peer still finishing one message from
+ * one that completed some and started another.
+ */
+[[nodiscard]] uint64_t
+jsonrpc_conn_messages_completed(const jsonrpc_conn_t *conn);
+
+/**
+ * @brief Whether deferred requests on this connection are still outstanding.
+ */
+[[nodiscard]] bool jsonrpc_conn_has_deferred(const jsonrpc_conn_t *conn);
+
+/**
+ * @brief Defer the response to the request being handled. Call from
+ * on_request or a router handler, then return true; anything left in the
+ * response is discarded. Complete the handle later, on the connection's loop
+ * thread, with jsonrpc_request_complete_result or _error. The handle owns a
+ * copy of the request id, plus a copy of params when keep_params is set.
+ * Batches are sent once every deferred member has completed. If the
+ * connection closes first, the handle stays valid and completing it only
+ * releases it.
+ * @return nullptr outside a request handler, for notifications, when the
+ *         request was already deferred, or on allocation failure.
+ */
+[[nodiscard]] jsonrpc_request_handle_t *jsonrpc_conn_defer(jsonrpc_conn_t *conn,
+                                                           bool keep_params);
+
+[[nodiscard]] const JSON_Value *
+jsonrpc_request_handle_id(const jsonrpc_request_handle_t *handle);
+
+/**
+ * @brief Params copied by jsonrpc_conn_defer, nullptr if none were kept.
+ */
+[[nodiscard]] const JSON_Value *
+jsonrpc_request_handle_params(const jsonrpc_request_handle_t *handle);
+
+/**
+ * @brief Connection the request arrived on, nullptr once it has closed.
+ */
+[[nodiscard]] jsonrpc_conn_t *
+jsonrpc_request_handle_conn(const jsonrpc_request_handle_t *handle);
+
+/**
+ * @brief Answer a deferred request and release the handle. Takes ownership of
+ * result; a nullptr result answers with an internal error.
+ * @return false when the connection is gone or the send failed.
+ */
+[[nodiscard]] bool jsonrpc_request_complete_result(
+    jsonrpc_request_handle_t *handle, JSON_Value *result);
+
+/**
+ * @brief Answer a deferred request from a filled jsonrpc_response_t, with the
+ * same rules as a synchronous handler: handled == false answers "method not
+ * found", a non-zero error_code an error, otherwise the result (owned).
+ */
+[[nodiscard]] bool jsonrpc_request_complete_response(
+    jsonrpc_request_handle_t *handle, bool handled,
+    jsonrpc_response_t *response);
+
+/**
+ * @brief Answer a deferred request with an error and release the handle.
+ * message may be nullptr for the default text of code.
+ */
+[[nodiscard]] bool jsonrpc_request_complete_error(
+    jsonrpc_request_handle_t *handle, int32_t code, const char *message);
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "jsonrpc/parson.h"
+
+/**
+ * @brief Decode one MessagePack document into a parson DOM, allocated through
+ * parson's allocator like json_parse_string_with_len. Map keys must be
+ * strings without NUL bytes and may not repeat; binary and extension types
+ * have no JSON equivalent and are rejected, as are documents nested deeper
+ * than the JSON parser allows and trailing bytes.
+ * @return nullptr when data is not exactly one valid document.
+ */
+[[nodiscard]] JSON_Value *jsonrpc_msgpack_decode(const uint8_t *data,
+                                                 size_t len);
+
+/**
+ * @brief Append the MessagePack encoding of value to sink, in the smallest
+ * form of each type. Numbers with an integral value in the int64 range are
+ * written as integers, the rest as float32 when that is exact, else float64.
+ * @return false on allocation failure, with sink->len restored.
+ */
+[[nodiscard]] bool jsonrpc_msgpack_encode(const JSON_Value *value,
+                                          JSON_Output_Sink *sink);
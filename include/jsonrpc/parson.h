@@ -61,6 +61,8 @@ typedef enum json_boolean_result JSON_Boolean;
 
 typedef void *(*JSON_Malloc_Function)(size_t);
 typedef void (*JSON_Free_Function)(void *);
+typedef void *(*JSON_Malloc_Ctx_Function)(void *ctx, size_t);
+typedef void (*JSON_Free_Ctx_Function)(void *ctx, void *);
 
 /* A function used for serializing numbers (see
    json_set_number_serialization_function). If 'buf' is null then it should
@@ -74,6 +76,19 @@ typedef int (*JSON_Number_Serialization_Function)(double num, char *buf);
 void json_set_allocation_functions(JSON_Malloc_Function malloc_fun,
                                    JSON_Free_Function free_fun);
 
+/* Like json_set_allocation_functions, but both functions also receive the
+   calling thread's allocation context (see json_set_allocation_context). A
+   block may be freed under a different context than it was allocated in. */
+void json_set_allocation_functions_with_context(
+    JSON_Malloc_Ctx_Function malloc_fun, JSON_Free_Ctx_Function free_fun);
+
+/* Sets the allocation context of the calling thread and returns the previous
+   one. Every thread starts with nullptr. */
+void *json_set_allocation_context(void *ctx);
+
+/* Returns the allocation context of the calling thread. */
+void *json_get_allocation_context();
+
 /* Sets if slashes should be escaped or not when serializing JSON. By default
  slashes are escaped. This function sets a global setting and is not thread
  safe. */
@@ -99,6 +114,13 @@ void json_set_number_serialization_function(
 /*  Parses first JSON value in a string, returns nullptr in case of error */
 [[nodiscard]] JSON_Value *json_parse_string(const char *string);
 
+/*  Parses exactly len bytes of string as one JSON value; the input does not
+    need to be NUL-terminated. Unlike json_parse_string, anything other than
+    whitespace after the value (including an embedded '\0') is an error.
+    Returns nullptr in case of error */
+[[nodiscard]] JSON_Value *json_parse_string_with_len(const char *string,
+                                                     size_t len);
+
 /*  Parses first JSON value in a string and ignores comments (/ * * / and //),
     returns nullptr in case of error */
 [[nodiscard]] JSON_Value *json_parse_string_with_comments(const char *string);
@@ -124,6 +146,25 @@ void json_free_serialized_string(
     char *string); /* frees string from json_serialize_to_string and
                       json_serialize_to_string_pretty */
 
+/* Caller-owned output buffer for single-pass serialization. 'data' holds 'cap'
+   writable bytes of which the first 'len' are in use. When the serializer
+   needs more room it calls grow(sink, min_free), which must make at least
+   min_free bytes available past 'len' (keeping data[0..len) intact, possibly
+   moving 'data') or return false. 'user_data' is reserved for the owner. */
+typedef struct json_output_sink_t {
+  char *data;
+  size_t len;
+  size_t cap;
+  bool (*grow)(struct json_output_sink_t *sink, size_t min_free);
+  void *user_data;
+} JSON_Output_Sink;
+
+/* Appends the compact serialization of value to sink in one walk of the tree
+   and leaves at least 'reserve' free bytes after it (e.g. for a trailing
+   newline). Output is not NUL-terminated. On failure sink->len is restored. */
+JSON_Status json_serialize_to_sink(const JSON_Value *value,
+                                   JSON_Output_Sink *sink, size_t reserve);
+
 /* Comparing */
 bool json_value_equals(const JSON_Value *a, const JSON_Value *b);
 
@@ -304,6 +345,13 @@ json_value_init_string(const char *string); /* copies passed string */
 [[nodiscard]] JSON_Value *json_value_deep_copy(const JSON_Value *value);
 void json_value_free(JSON_Value *value);
 
+/* Marks value and everything below it as living in memory that is released in
+   bulk (e.g. an arena). json_value_free then returns without visiting the
+   subtree, including when a parent tree is freed. Only mark trees whose every
+   node, string and cell array came from that memory. */
+void json_value_set_bulk_owned(JSON_Value *value, bool bulk_owned);
+bool json_value_is_bulk_owned(const JSON_Value *value);
+
 JSON_Value_Type json_value_get_type(const JSON_Value *value);
 JSON_Object *json_value_get_object(const JSON_Value *value);
 JSON_Array *json_value_get_array(const JSON_Value *value);
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Releases one pooled object for good (e.g. free, arena_destroy).
+ */
+typedef void (*jsonrpc_pool_release_t)(void *item);
+
+/**
+ * @brief Free list of same-kind objects owned by one thread (usually one event
+ * loop), so churn reuses objects instead of going back to the allocator.
+ * At most high_water released objects are kept; jsonrpc_pool_idle_trim cuts
+ * the list back to low_water once it has gone a trim interval without reuse.
+ * A high_water of 0 disables pooling: every put releases the object.
+ */
+typedef struct {
+  void **items;
+  size_t count;
+  size_t high_water;
+  size_t low_water;
+  jsonrpc_pool_release_t release;
+  size_t gets_since_trim;
+  // Statistics.
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t trimmed;
+} jsonrpc_pool_t;
+
+/**
+ * @brief Set up an empty pool; storage for high_water entries is allocated
+ * once here. low_water is clamped to high_water.
+ * @return false on allocation failure (the pool then keeps nothing).
+ */
+[[nodiscard]] bool jsonrpc_pool_init(jsonrpc_pool_t *pool, size_t high_water,
+                                     size_t low_water,
+                                     jsonrpc_pool_release_t release);
+
+/**
+ * @brief Take a pooled object; its contents are whatever the last owner left.
+ * @return nullptr when the pool is empty and the caller must allocate.
+ */
+[[nodiscard]] void *jsonrpc_pool_get(jsonrpc_pool_t *pool);
+
+/**
+ * @brief Return an object to the pool, or release it when the pool is full.
+ */
+void jsonrpc_pool_put(jsonrpc_pool_t *pool, void *item);
+
+/**
+ * @brief Release pooled objects until at most keep remain.
+ */
+void jsonrpc_pool_trim(jsonrpc_pool_t *pool, size_t keep);
+
+/**
+ * @brief Call once per trim interval: trims to low_water when nothing was
+ * taken from the pool since the previous call.
+ */
+void jsonrpc_pool_idle_trim(jsonrpc_pool_t *pool);
+
+/**
+ * @brief Release every pooled object and the pool's storage.
+ */
+void jsonrpc_pool_destroy(jsonrpc_pool_t *pool);
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "jsonrpc/jsonrpc.h"
+
+/**
+ * @brief Per-method dispatch flags, combined with bitwise or.
+ */
+enum jsonrpc_method_flags {
+  JSONRPC_METHOD_DEFAULT = 0U,
+  /** Notifications for this method are dropped without calling the handler. */
+  JSONRPC_METHOD_REQUEST_ONLY = 1U << 0,
+  /**
+   * The handler blocks or is CPU-heavy: requests are handed to
+   * jsonrpc_callbacks_t.offload and the handler runs on another thread with
+   * conn == nullptr, reading only its params. Notifications and connections
+   * without an offload hook still run it inline.
+   */
+  JSONRPC_METHOD_BLOCKING = 1U << 1,
+};
+
+/**
+ * @brief Handle one call of a registered method. Same contract as
+ * jsonrpc_callbacks_t.on_request; for notifications the response is discarded.
+ * @return true if handled, false to trigger "method not found".
+ */
+typedef bool (*jsonrpc_method_handler_t)(jsonrpc_conn_t *conn,
+                                         const JSON_Value *params,
+                                         jsonrpc_response_t *response,
+                                         void *user_data);
+
+typedef struct jsonrpc_method_s {
+  jsonrpc_method_handler_t handler;
+  uint32_t flags; // enum jsonrpc_method_flags
+  void *user_data;
+} jsonrpc_method_t;
+
+/**
+ * @brief Create an empty method table. Register every method before the
+ * router is attached to connections; lookups never modify the table, so one
+ * router can be shared by all worker loops.
+ */
+[[nodiscard]] jsonrpc_router_t *jsonrpc_router_new();
+
+void jsonrpc_router_free(jsonrpc_router_t *router);
+
+/**
+ * @brief Register handler for method. The name is copied.
+ * @return false on allocation failure or when method is already registered.
+ */
+[[nodiscard]] bool jsonrpc_router_add(jsonrpc_router_t *router,
+                                      const char *method,
+                                      jsonrpc_method_handler_t handler,
+                                      uint32_t flags, void *user_data);
+
+/**
+ * @brief Look up a method by name; method does not need to be NUL-terminated.
+ * @return nullptr when the method is not registered.
+ */
+[[nodiscard]] const jsonrpc_method_t *
+jsonrpc_router_find(const jsonrpc_router_t *router, const char *method,
+                    size_t method_len);
+
+[[nodiscard]] size_t jsonrpc_router_count(const jsonrpc_router_t *router);
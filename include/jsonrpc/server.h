@@ -1,10 +1,173 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include "jsonrpc/jsonrpc.h"
 
+/**
+ * @brief What happens to connections arriving at max_connections.
+ */
+typedef enum {
+  // Accept, send a JSON-RPC error (id null, code -32000), then close.
+  SERVER_SHED_REJECT,
+  // Leave them in the listen backlog until connections close.
+  SERVER_SHED_PAUSE,
+} server_shed_mode_t;
+
+/**
+ * @brief How workers drive their TCP connections.
+ */
+typedef enum {
+  SERVER_BACKEND_LIBUV,
+  // Raw io_uring (Linux): multishot accept and recv into a shared buffer
+  // ring, batched sends, one io_uring_enter per loop iteration.
+  SERVER_BACKEND_IO_URING,
+} server_backend_t;
+
+/**
+ * @brief Listener configuration. Initialize with server_config_init before
+ * overriding individual fields.
+ */
+typedef struct {
+  int32_t port;
+  /**
+   * Number of event loops. Worker 0 runs on the calling thread's default loop;
+   * each additional worker gets its own thread, loop and SO_REUSEPORT listener
+   * on the same port. 0 is treated as 1.
+   */
+  uint32_t workers;
+  /**
+   * Per-loop free lists for connection contexts, read buffers and arenas.
+   * Up to pool_high_water released objects of each kind are kept; when a
+   * pool_trim_ms interval passes without reuse they are trimmed back to
+   * pool_low_water. pool_high_water 0 disables pooling, pool_trim_ms 0 the
+   * trim.
+   */
+  uint32_t pool_high_water;
+  uint32_t pool_low_water;
+  uint32_t pool_trim_ms;
+  /**
+   * Read every connection of a loop into one shared 64 KiB slab instead of a
+   * per-connection buffer. Complete messages are parsed straight from the
+   * slab and only a trailing partial message is copied into the connection,
+   * so idle connections hold no read memory.
+   */
+  bool shared_read_buffer;
+  /**
+   * Memory budget across all connections: inbound and outbound buffers,
+   * arenas and queued writes. Above memory_budget_bytes, connections stop
+   * reading, heaviest first, until usage falls to memory_resume_bytes (0 means
+   * three quarters of the budget). Requests are delayed, never rejected.
+   * 0 disables the budget.
+   */
+  size_t memory_budget_bytes;
+  size_t memory_resume_bytes;
+  /**
+   * Per-connection write backpressure: once more than write_queue_high_bytes
+   * of responses wait in libuv's write queue (the peer reads too slowly), the
+   * connection stops reading until the queue drains to write_queue_low_bytes.
+   * write_queue_high_bytes 0 disables it.
+   */
+  size_t write_queue_high_bytes;
+  size_t write_queue_low_bytes;
+  /**
+   * Connections are closed after idle_timeout_ms without reading or writing
+   * anything, or when a message started message_timeout_ms ago is still not
+   * complete (slow or stalled senders). Time spent waiting on the server, for
+   * deferred requests or the memory budget, does not count. Checked on a
+   * per-loop timer wheel, so expiry may run up to 100 ms late. 0 disables
+   * either timeout.
+   */
+  uint32_t idle_timeout_ms;
+  uint32_t message_timeout_ms;
+  /**
+   * Admission control. At most max_connections are open across all workers
+   * (0 for no limit); further ones are handled per shed_mode. Each loop
+   * accepts at most accepts_per_tick connections per iteration (0 for no
+   * limit) and leaves the rest queued, so an accept storm cannot starve
+   * established connections.
+   */
+  uint32_t max_connections;
+  server_shed_mode_t shed_mode;
+  uint32_t accepts_per_tick;
+  /**
+   * Listeners: TCP on 0.0.0.0:port when listen_tcp is set, and a Unix domain
+   * socket at unix_path (nullptr for none; a stale socket file there is
+   * replaced, and the file is removed on shutdown). At least one is needed.
+   * Connections from either are served the same way by every worker.
+   */
+  bool listen_tcp;
+  const char *unix_path;
+  /**
+   * I/O backend for TCP connections. SERVER_BACKEND_IO_URING still runs each
+   * worker's libuv loop (signals, offloaded requests) but moves accept, reads
+   * and writes onto an io_uring per worker. It serves TCP only, and the memory
+   * budget, write backpressure, timeouts and admission control above apply
+   * to the libuv backend only.
+   */
+  server_backend_t backend;
+  /**
+   * Message framing per listener, newline by default: tcp_framing for TCP
+   * (either backend), unix_framing for the Unix socket. Length-prefixed,
+   * Content-Length and HTTP frames carry up to max_framed_message_bytes (0
+   * for the 64 KiB newline limit), and a partial frame's buffer is allocated
+   * for the size its header announces. JSONRPC_FRAMING_HTTP serves JSON-RPC
+   * over HTTP/1.1 POST with keep-alive and pipelining, no proxy needed, and
+   * JSONRPC_FRAMING_WEBSOCKET over WebSocket, one message per frame.
+   */
+  jsonrpc_framing_t tcp_framing;
+  jsonrpc_framing_t unix_framing;
+  size_t max_framed_message_bytes;
+  /**
+   * Let clients of length-delimited listeners send MessagePack instead of
+   * JSON, chosen per connection by its first message (see
+   * jsonrpc_conn_allow_msgpack). Newline listeners stay JSON-only.
+   */
+  bool msgpack;
+} server_config_t;
+
+/**
+ * @brief Server-wide counters, see server_get_stats.
+ */
+typedef struct {
+  size_t connections;
+  size_t memory_used;
+  size_t memory_budget_bytes;
+  size_t memory_paused; // connections not reading because of the budget
+  size_t write_queue_high_bytes;
+  size_t write_queue_low_bytes;
+  size_t write_paused;   // connections not reading because of their queue
+  uint64_t write_pauses; // times a queue crossed the high watermark
+  uint64_t idle_timeouts;
+  uint64_t message_timeouts;
+  size_t max_connections;
+  uint64_t connections_shed; // rejected at max_connections
+  uint64_t accept_pauses;    // times a listener paused at max_connections
+  uint64_t uring_enters;     // io_uring_enter calls (io_uring backend)
+  uint64_t uring_sqes;       // submission entries they carried
+} server_stats_t;
+
 void server_set_callbacks(jsonrpc_callbacks_t callbacks);
 [[nodiscard]] jsonrpc_callbacks_t server_get_callbacks();
+void server_config_init(server_config_t *config);
+/**
+ * @brief Bytes currently accounted to open connections, across all workers.
+ */
+[[nodiscard]] size_t server_memory_usage();
+/**
+ * @brief Snapshot of the server-wide counters. Safe to call from any thread.
+ */
+void server_get_stats(server_stats_t *stats);
 void start_jsonrpc_server(int32_t port, jsonrpc_callbacks_t callbacks);
+/**
+ * @brief Run the server until server_request_shutdown. When callbacks.offload
+ * is unset, JSONRPC_METHOD_BLOCKING methods run on the libuv thread pool
+ * (sized by UV_THREADPOOL_SIZE) and complete back on their connection's loop.
+ */
+void start_jsonrpc_server_with_config(const server_config_t *config,
+                                      jsonrpc_callbacks_t callbacks);
+/**
+ * @brief Stop every worker loop. Safe to call from any thread.
+ */
 void server_request_shutdown();
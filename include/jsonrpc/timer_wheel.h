@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct jsonrpc_timer_s jsonrpc_timer_t;
+
+/**
+ * @brief Called when a timer expires. The timer is already disarmed, so the
+ * callback may schedule it again.
+ */
+typedef void (*jsonrpc_timer_cb_t)(jsonrpc_timer_t *timer);
+
+/**
+ * @brief One timeout, embedded in the object it belongs to. Set it up with
+ * jsonrpc_timer_init; the wheel links it into a slot while it is armed.
+ */
+struct jsonrpc_timer_s {
+  jsonrpc_timer_t *prev;
+  jsonrpc_timer_t *next;
+  uint64_t deadline;      // absolute, in the wheel's milliseconds
+  uint64_t deadline_tick; // first tick at or after deadline
+  jsonrpc_timer_cb_t callback;
+  void *data;
+  bool armed;
+};
+
+/**
+ * @brief Hashed timer wheel: slot_count lists indexed by deadline tick, so
+ * arming and cancelling are O(1) and each tick only looks at one slot.
+ * Timers further out than one revolution sit in their slot until the tick
+ * that reaches them. Time is whatever millisecond clock the owner passes in
+ * (e.g. uv_now); timers never fire before their deadline but may fire up to
+ * one tick late. Owned by one thread.
+ */
+typedef struct {
+  jsonrpc_timer_t **slots;
+  size_t slot_count; // power of two
+  uint64_t tick_ms;
+  uint64_t tick; // last tick processed
+  size_t armed;
+  jsonrpc_timer_t *cursor; // next timer of the slot being expired
+  // Statistics.
+  uint64_t expired;
+} jsonrpc_timer_wheel_t;
+
+/**
+ * @brief Set up an empty wheel starting at now_ms. slot_count is rounded up
+ * to a power of two; tick_ms is the resolution.
+ * @return false on invalid arguments or allocation failure.
+ */
+[[nodiscard]] bool jsonrpc_timer_wheel_init(jsonrpc_timer_wheel_t *wheel,
+                                            size_t slot_count,
+                                            uint64_t tick_ms, uint64_t now_ms);
+
+void jsonrpc_timer_init(jsonrpc_timer_t *timer, jsonrpc_timer_cb_t callback,
+                        void *data);
+
+/**
+ * @brief Arm timer to expire at deadline_ms, moving it if already armed.
+ * Deadlines already past expire on the next tick.
+ */
+void jsonrpc_timer_wheel_schedule(jsonrpc_timer_wheel_t *wheel,
+                                  jsonrpc_timer_t *timer, uint64_t deadline_ms);
+
+/**
+ * @brief Disarm timer; a no-op when it is not armed.
+ */
+void jsonrpc_timer_wheel_cancel(jsonrpc_timer_wheel_t *wheel,
+                                jsonrpc_timer_t *timer);
+
+/**
+ * @brief Process every tick up to now_ms, running the callbacks of the timers
+ * that expired. Call once per tick (e.g. from a repeating uv_timer_t).
+ * @return number of timers expired.
+ */
+size_t jsonrpc_timer_wheel_advance(jsonrpc_timer_wheel_t *wheel,
+                                   uint64_t now_ms);
+
+/**
+ * @brief Disarm every timer and release the wheel's storage.
+ */
+void jsonrpc_timer_wheel_destroy(jsonrpc_timer_wheel_t *wheel);
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stddef.h>
+#include <sys/socket.h>
+
+#include <uv.h>
+
+#include "jsonrpc/flow_control.h"
+#include "jsonrpc/server.h"
+
+/**
+ * @brief io_uring transport for one worker loop (server_config_t.backend
+ * SERVER_BACKEND_IO_URING), driven through raw io_uring syscalls: one
+ * multishot accept on the listener, one multishot recv per connection reading
+ * into a provided buffer ring, and responses batched into one send per
+ * connection per loop iteration. The ring is hosted on the worker's libuv loop
+ * through a uv_poll_t on its fd, so signals, timers and offloaded requests
+ * keep working; submissions go out in one io_uring_enter per iteration.
+ */
+typedef struct uring_server_s uring_server_t;
+
+/**
+ * @brief Set up a ring and a TCP listener on addr and start accepting.
+ * Connections use framing, see jsonrpc_conn_set_framing, and may switch to
+ * MessagePack when msgpack is set and framing is length-delimited. A
+ * connection stops reading while its unsent responses are over the
+ * write_queue watermarks.
+ * @return nullptr (after logging why) when io_uring or a feature it needs is
+ *         unavailable, or on bind/listen failure.
+ */
+[[nodiscard]] uring_server_t *
+uring_server_start(uv_loop_t *loop, const struct sockaddr *addr,
+                   bool reuse_port, jsonrpc_framing_t framing,
+                   size_t max_message_bytes, bool msgpack,
+                   jsonrpc_watermarks_t write_queue);
+
+/**
+ * @brief Cancel outstanding operations, close every connection and release
+ * the ring. Call once the loop's handles have been closed.
+ */
+void uring_server_destroy(uring_server_t *server);
+
+/**
+ * @brief Add the io_uring connections and submission counters to stats.
+ */
+void uring_server_add_stats(server_stats_t *stats);
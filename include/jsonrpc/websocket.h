@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Longest client frame header: 2 bytes, a 64-bit length and the mask key.
+constexpr size_t JSONRPC_WS_HEADER_MAX = 14U;
+// Longest server frame header, which carries no mask key.
+constexpr size_t JSONRPC_WS_SEND_HEADER_MAX = 10U;
+// Control frames (close, ping, pong) carry at most this many payload bytes.
+constexpr size_t JSONRPC_WS_CONTROL_MAX = 125U;
+// Length of a Sec-WebSocket-Key, and of the Sec-WebSocket-Accept answering it.
+constexpr size_t JSONRPC_WS_KEY_LEN = 24U;
+constexpr size_t JSONRPC_WS_ACCEPT_LEN = 28U;
+
+typedef enum {
+  JSONRPC_WS_CONTINUATION = 0x0,
+  JSONRPC_WS_TEXT = 0x1,
+  JSONRPC_WS_BINARY = 0x2,
+  JSONRPC_WS_CLOSE = 0x8,
+  JSONRPC_WS_PING = 0x9,
+  JSONRPC_WS_PONG = 0xA,
+} jsonrpc_ws_opcode_t;
+
+typedef enum {
+  JSONRPC_WS_INCOMPLETE,
+  JSONRPC_WS_READY, // the frame fields are set
+  JSONRPC_WS_INVALID,
+} jsonrpc_ws_status_t;
+
+typedef struct {
+  size_t header_len;
+  size_t payload_len;
+  uint8_t mask[4];
+  jsonrpc_ws_opcode_t opcode;
+  bool fin;
+} jsonrpc_ws_frame_t;
+
+/**
+ * @brief Parse the header of a client-to-server frame (RFC 6455 section 5.2).
+ * Client frames must be masked; no extension is negotiated, so reserved bits
+ * must be clear; control frames must be final and short.
+ */
+[[nodiscard]] jsonrpc_ws_status_t
+jsonrpc_ws_parse_frame(const uint8_t *data, size_t len,
+                       jsonrpc_ws_frame_t *frame);
+
+/**
+ * @brief Write the header of a final, unmasked server frame carrying
+ * payload_len bytes into out (JSONRPC_WS_SEND_HEADER_MAX bytes).
+ * @return header length.
+ */
+[[nodiscard]] size_t jsonrpc_ws_frame_header(jsonrpc_ws_opcode_t opcode,
+                                             size_t payload_len, uint8_t *out);
+
+/**
+ * @brief Unmask len payload bytes from src into dst (which may equal src).
+ * offset is the position of src[0] within the frame's payload, so a payload
+ * arriving in pieces is unmasked piece by piece. Runs 32 or 16 bytes at a
+ * time with AVX2 or SSE2 where available.
+ */
+void jsonrpc_ws_unmask(uint8_t *dst, const uint8_t *src, size_t len,
+                       const uint8_t mask[4], size_t offset);
+
+/**
+ * @brief Compute the Sec-WebSocket-Accept value for a client's key: the
+ * base64 SHA-1 of the key followed by the protocol GUID. out receives
+ * JSONRPC_WS_ACCEPT_LEN characters and no terminator.
+ */
+void jsonrpc_ws_accept_key(const uint8_t key[JSONRPC_WS_KEY_LEN],
+                           uint8_t out[JSONRPC_WS_ACCEPT_LEN]);
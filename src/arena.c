@@ -223,6 +223,8 @@ void arena_init(Arena *arena, void *region, size_t size) {
   arena->region = nullptr;
   arena->index = 0;
   arena->size = 0;
+  arena->block = nullptr;
+  arena->retired = nullptr;
 
 #ifdef ARENA_DEBUG
   arena->allocations = 0;
@@ -263,6 +265,76 @@ cleanup_arena:
   return nullptr;
 }
 
+[[nodiscard]] static Arena_Block *arena_block_new(size_t size) {
+  if (size > SIZE_MAX - sizeof(Arena_Block)) {
+    return nullptr;
+  }
+  Arena_Block *block = ARENA_MALLOC(sizeof(Arena_Block) + size);
+  if (block == nullptr) {
+    return nullptr;
+  }
+  block->next = nullptr;
+  block->size = size;
+  return block;
+}
+
+static void arena_use_block(Arena *arena, Arena_Block *block) {
+  arena->block = block;
+  arena->region = block->data;
+  arena->size = block->size;
+  arena->index = 0;
+}
+
+Arena *arena_create_chained(size_t initial_size) {
+  if (initial_size == 0) {
+    return nullptr;
+  }
+
+  Arena *arena = ARENA_MALLOC(sizeof(Arena));
+  if (arena == nullptr) {
+    return nullptr;
+  }
+
+  Arena_Block *block = arena_block_new(initial_size);
+  if (block == nullptr) {
+    ARENA_FREE(arena);
+    return nullptr;
+  }
+
+  arena_init(arena, nullptr, 0);
+  arena_use_block(arena, block);
+  return arena;
+}
+
+/*
+Retire the current block of a chained arena and switch to
+a new one that fits size bytes at the given alignment.
+*/
+[[nodiscard]] static bool arena_grow(Arena *arena, size_t size,
+                                     size_t alignment) {
+  if (size > SIZE_MAX - alignment) {
+    return false;
+  }
+  size_t block_size = size + alignment;
+  if (arena->size <= SIZE_MAX / 2 && arena->size * 2 > block_size) {
+    block_size = arena->size * 2;
+  }
+
+  Arena_Block *block = arena_block_new(block_size);
+  if (block == nullptr) {
+    return false;
+  }
+
+#ifdef ARENA_DEBUG
+  arena_delete_allocation_list(arena);
+#endif /* ARENA_DEBUG */
+
+  arena->block->next = arena->retired;
+  arena->retired = arena->block;
+  arena_use_block(arena, block);
+  return true;
+}
+
 void *arena_alloc(Arena *arena, size_t size) {
   return arena_alloc_aligned(arena, size, arena_default_alignment);
 }
@@ -276,6 +348,20 @@ void *arena_alloc_aligned(Arena *arena, size_t size, size_t alignment) {
     return nullptr;
   }
 
+  if (arena->block != nullptr) {
+    const uintptr_t current =
+        (uintptr_t)arena->region + (uintptr_t)arena->index;
+    const size_t padding =
+        alignment != 0 ? (alignment - (size_t)(current % alignment)) % alignment
+                       : 0;
+    const bool fits = arena->index <= arena->size &&
+                      padding <= arena->size - arena->index &&
+                      size <= arena->size - arena->index - padding;
+    if (!fits && !arena_grow(arena, size, alignment)) {
+      return nullptr;
+    }
+  }
+
   if (arena->index > arena->size) {
     return nullptr;
   }
@@ -326,11 +412,50 @@ size_t arena_copy(Arena *dest, Arena *src) {
   return bytes;
 }
 
+bool arena_owns(const Arena *arena, const void *ptr) {
+  if (arena == nullptr || ptr == nullptr || arena->region == nullptr) {
+    return false;
+  }
+
+  const uintptr_t address = (uintptr_t)ptr;
+  const uintptr_t start = (uintptr_t)arena->region;
+  if (address >= start && address - start < arena->index) {
+    return true;
+  }
+
+  for (const Arena_Block *block = arena->retired; block != nullptr;
+       block = block->next) {
+    const uintptr_t block_start = (uintptr_t)block->data;
+    if (address >= block_start && address - block_start < block->size) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void arena_clear(Arena *arena) {
   if (arena == nullptr) {
     return;
   }
 
+  if (arena->retired != nullptr) {
+    Arena_Block *largest = arena->block;
+    Arena_Block *block = arena->retired;
+    while (block != nullptr) {
+      Arena_Block *next = block->next;
+      if (block->size > largest->size) {
+        ARENA_FREE(largest);
+        largest = block;
+      } else {
+        ARENA_FREE(block);
+      }
+      block = next;
+    }
+    largest->next = nullptr;
+    arena->retired = nullptr;
+    arena_use_block(arena, largest);
+  }
+
   arena->index = 0;
 
 #ifdef ARENA_DEBUG
@@ -347,7 +472,14 @@ void arena_destroy(Arena *arena) {
   arena_delete_allocation_list(arena);
 #endif /* ARENA_DEBUG */
 
-  if (arena->region != nullptr) {
+  if (arena->block != nullptr) {
+    while (arena->retired != nullptr) {
+      Arena_Block *next = arena->retired->next;
+      ARENA_FREE(arena->retired);
+      arena->retired = next;
+    }
+    ARENA_FREE(arena->block);
+  } else if (arena->region != nullptr) {
     ARENA_FREE(arena->region);
   }
 
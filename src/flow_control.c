@@ -0,0 +1,60 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "jsonrpc/flow_control.h"
+
+jsonrpc_watermarks_t jsonrpc_watermarks_make(size_t high, size_t low) {
+  return (jsonrpc_watermarks_t){
+      .high = high, .low = low < high ? low : high / 4U};
+}
+
+jsonrpc_watermark_action_t
+jsonrpc_watermarks_check(const jsonrpc_watermarks_t *marks, size_t count,
+                         bool paused) {
+  if (marks == nullptr || marks->high == 0U) {
+    return JSONRPC_WATERMARK_HOLD;
+  }
+  if (!paused && count > marks->high) {
+    return JSONRPC_WATERMARK_PAUSE;
+  }
+  if (paused && count <= marks->low) {
+    return JSONRPC_WATERMARK_RESUME;
+  }
+  return JSONRPC_WATERMARK_HOLD;
+}
+
+jsonrpc_admit_action_t
+jsonrpc_admission_check(const jsonrpc_admission_t *policy,
+                        uint32_t accepts_this_tick, size_t open) {
+  if (policy == nullptr) {
+    return JSONRPC_ADMIT_ACCEPT;
+  }
+  if (policy->accepts_per_tick != 0U &&
+      accepts_this_tick >= policy->accepts_per_tick) {
+    return JSONRPC_ADMIT_DEFER;
+  }
+  if (policy->max_connections != 0U && open >= policy->max_connections) {
+    return policy->pause_at_limit ? JSONRPC_ADMIT_PAUSE : JSONRPC_ADMIT_SHED;
+  }
+  return JSONRPC_ADMIT_ACCEPT;
+}
+
+bool jsonrpc_partial_clock_update(jsonrpc_partial_clock_t *clock,
+                                  uint64_t now_ms, size_t pending_bytes,
+                                  uint64_t completed) {
+  if (clock == nullptr) {
+    return false;
+  }
+  const bool progressed = completed != clock->completed;
+  clock->completed = completed;
+  if (pending_bytes == 0U) {
+    clock->pending = false;
+    return false;
+  }
+  if (clock->pending && !progressed) {
+    return false;
+  }
+  clock->pending = true;
+  clock->since = now_ms;
+  return true;
+}
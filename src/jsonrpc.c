@@ -2,15 +2,30 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <threads.h>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 #include "jsonrpc/arena.h"
 #include "jsonrpc/jsonrpc.h"
+#include "jsonrpc/msgpack.h"
+#include "jsonrpc/router.h"
+#include "jsonrpc/websocket.h"
 
 constexpr size_t INITIAL_BUFFER_CAP = 4'096;
 constexpr size_t MAX_MESSAGE_BYTES = 65'536U; // 64 KiB per JSON-RPC message
 constexpr size_t MAX_BUFFER_BYTES = 131'072U; // 128 KiB cap for partial lines
-// Small per-connection arena to avoid large baseline memory; larger allocations
-// fall back to the heap via jsonrpc_arena_malloc.
+// Longest Content-Length header block read before giving up on the frame.
+constexpr size_t CONTENT_LENGTH_HEADERS_MAX = 1'024U;
+// Same for an HTTP request line and headers.
+constexpr size_t HTTP_HEADERS_MAX = 8'192U;
+constexpr size_t LENGTH_PREFIX_BYTES = 4U;
+// "Content-Length: " + 20 digits + "\r\n\r\n"
+constexpr size_t CONTENT_LENGTH_HEADER_MAX = 40U;
+// Initial block of the per-connection arena. The arena is chained, so larger
+// messages link in further blocks; clearing it keeps only the largest.
 constexpr size_t JSONRPC_ARENA_BYTES = INITIAL_BUFFER_CAP;
 constexpr size_t RPC_BUFFER_SHRINK_THRESHOLD = INITIAL_BUFFER_CAP * 4U;
 
@@ -20,23 +35,29 @@ constexpr int32_t JSONRPC_ERR_METHOD_NOT_FOUND = -32'601;
 constexpr int32_t JSONRPC_ERR_INVALID_PARAMS = -32'602;
 constexpr int32_t JSONRPC_ERR_INTERNAL = -32'603;
 
+// WebSocket close status codes (RFC 6455 section 7.4.1).
+constexpr uint16_t WS_CLOSE_PROTOCOL_ERROR = 1'002U;
+constexpr uint16_t WS_CLOSE_TOO_BIG = 1'009U;
+
+// Live bytes are data[start, start + len). Consuming only advances start; the
+// bytes are moved back to the front only when the tail runs out of room.
 typedef struct {
   uint8_t *data;
+  size_t start;
   size_t len;
   size_t cap;
 } rpc_buffer_t;
 
-typedef struct {
-  uint32_t tag;
-  uint32_t origin;
-} jsonrpc_alloc_header_t;
-
-constexpr uint32_t JSONRPC_ALLOC_TAG = 0x4A52'5043; // "JRPC"
-constexpr uint32_t JSONRPC_ALLOC_ORIGIN_ARENA = 1U;
-constexpr uint32_t JSONRPC_ALLOC_ORIGIN_HEAP = 2U;
-constexpr size_t JSONRPC_ALLOC_HEADER_BYTES =
-    ((sizeof(jsonrpc_alloc_header_t) + alignof(max_align_t) - 1U) /
-     alignof(max_align_t)) *
+// Arena scopes can nest (a callback on one connection may complete a request
+// on another), so a value may be freed while a different arena is active.
+constexpr size_t JSONRPC_ARENA_SCOPE_DEPTH = 8U;
+
+// Heap memory handed to Parson starts with a tag saying so; arena memory has
+// no header. The tag is mixed with its own address, so stale bytes in front
+// of an arena allocation never pass for it.
+constexpr uintptr_t JSONRPC_HEAP_TAG = (uintptr_t)0x4A52'5043'4845'4150U;
+constexpr size_t JSONRPC_HEAP_HEADER_BYTES =
+    ((sizeof(uintptr_t) + alignof(max_align_t) - 1U) / alignof(max_align_t)) *
     alignof(max_align_t);
 
 typedef struct {
@@ -44,8 +65,55 @@ typedef struct {
   bool changed;
 } jsonrpc_arena_scope_t;
 
-static Arena *g_current_arena = nullptr;
-static bool g_parson_allocator_initialized = false;
+// The active arena is Parson's per-thread allocation context, so every event
+// loop or worker thread parses into its own arena (or the heap).
+static once_flag g_parson_allocator_once = ONCE_FLAG_INIT;
+
+// Allocations on this thread that wanted the arena but got the heap. A tree
+// built while this stays unchanged lives entirely in the arena.
+static thread_local size_t t_arena_heap_fallbacks = 0U;
+
+// Arenas of the scopes open on this thread, innermost last. jsonrpc_arena_free
+// looks addresses up in these before checking for the heap tag.
+static thread_local Arena *t_arena_scopes[JSONRPC_ARENA_SCOPE_DEPTH];
+static thread_local size_t t_arena_scope_count = 0U;
+
+// Response array of a batch with deferred members. It is sent once the batch
+// has been fully dispatched (open == false) and every deferred member has
+// completed. Responses are heap copies because the batch outlives the message
+// arena.
+typedef struct {
+  jsonrpc_conn_t *conn; // nullptr once the connection is gone
+  JSON_Value *responses;
+  size_t pending;
+  bool open;
+} jsonrpc_batch_t;
+
+struct jsonrpc_request_handle_s {
+  jsonrpc_conn_t *conn; // nullptr once the connection is gone
+  jsonrpc_batch_t *batch;
+  JSON_Value *id;     // owned heap copy
+  JSON_Value *params; // owned heap copy, nullptr unless requested
+  jsonrpc_request_handle_t *prev;
+  jsonrpc_request_handle_t *next;
+};
+
+// WebSocket framing: the frame being received. The data message it belongs
+// to is assembled, unmasked, in inbound; control frames are unmasked into
+// control instead, since they may arrive between the fragments of a message.
+typedef struct {
+  bool open;       // the upgrade handshake has been answered
+  bool in_message; // a data frame without FIN has been received
+  bool in_frame;   // header read, payload_left bytes still to come
+  bool fin;
+  jsonrpc_ws_opcode_t opcode;
+  uint8_t mask[4];
+  size_t payload_left;
+  size_t payload_seen;
+  size_t header_len; // bytes of a split frame header held in header
+  uint8_t header[JSONRPC_WS_HEADER_MAX];
+  uint8_t control[JSONRPC_WS_CONTROL_MAX];
+} rpc_ws_t;
 
 struct jsonrpc_conn_s {
   jsonrpc_transport_t transport;
@@ -55,7 +123,30 @@ struct jsonrpc_conn_s {
   bool pending_free;
   size_t callback_depth;
   rpc_buffer_t inbound;
+  size_t inbound_scanned; // prefix of inbound already known to hold no '\n'
+  uint64_t messages_completed; // framed and handed to dispatch
+  bool inbound_saw_nul;   // that prefix contains a '\0'
+  jsonrpc_framing_t framing;
+  size_t max_message_bytes; // length-delimited framings
+  jsonrpc_encoding_t encoding;
+  bool encoding_open; // MessagePack allowed, first message not seen yet
+  // HTTP framing: the request being answered.
+  uint16_t http_status;
+  bool http_keep_alive;
+  bool http_responded;
+  bool http_continue_sent;
+  bool reads_paused; // requests are held behind a deferred one
+  bool shared_reads; // input is fed from a buffer shared by connections
+  rpc_ws_t ws;
+  rpc_buffer_t outbound; // serialization scratch for transports without reserve
   Arena *arena;
+  // Request being dispatched, so a handler can defer it.
+  const JSON_Value *current_id;
+  const JSON_Value *current_params;
+  bool current_deferred;
+  bool in_batch;
+  jsonrpc_batch_t *current_batch; // created by the first deferred member
+  jsonrpc_request_handle_t *handles; // outstanding deferred requests
 };
 
 static void jsonrpc_conn_callback_enter(jsonrpc_conn_t *conn) {
@@ -81,65 +172,65 @@ static bool jsonrpc_conn_needs_finalize(const jsonrpc_conn_t *conn) {
 }
 
 [[nodiscard]]
-static void *jsonrpc_arena_malloc(size_t size) {
+static void *jsonrpc_arena_malloc(void *ctx, size_t size) {
   if (size == 0U) {
     return nullptr;
   }
 
-  if (size > SIZE_MAX - JSONRPC_ALLOC_HEADER_BYTES) {
-    return nullptr;
-  }
-
-  const size_t total_size = size + JSONRPC_ALLOC_HEADER_BYTES;
-  void *block = nullptr;
-  uint32_t origin = JSONRPC_ALLOC_ORIGIN_HEAP;
-
-  if (g_current_arena != nullptr) {
-    block = arena_alloc(g_current_arena, total_size);
+  if (ctx != nullptr) {
+    void *block = arena_alloc((Arena *)ctx, size);
     if (block != nullptr) {
-      origin = JSONRPC_ALLOC_ORIGIN_ARENA;
+      return block;
     }
+    t_arena_heap_fallbacks += 1U;
   }
 
-  if (block == nullptr) {
-    block = calloc(1U, total_size);
-    origin = JSONRPC_ALLOC_ORIGIN_HEAP;
+  if (size > SIZE_MAX - JSONRPC_HEAP_HEADER_BYTES) {
+    return nullptr;
   }
-
-  if (block == nullptr) {
+  auto raw = (uint8_t *)calloc(1U, size + JSONRPC_HEAP_HEADER_BYTES);
+  if (raw == nullptr) {
     return nullptr;
   }
-
-  auto header = (jsonrpc_alloc_header_t *)block;
-  header->tag = JSONRPC_ALLOC_TAG;
-  header->origin = origin;
-
-  return (uint8_t *)block + JSONRPC_ALLOC_HEADER_BYTES;
+  const uintptr_t tag = JSONRPC_HEAP_TAG ^ (uintptr_t)raw;
+  memcpy(raw, &tag, sizeof(tag));
+  return raw + JSONRPC_HEAP_HEADER_BYTES;
 }
 
-static void jsonrpc_arena_free(void *ptr) {
+static void jsonrpc_arena_free(void *ctx, void *ptr) {
   if (ptr == nullptr) {
     return;
   }
 
-  auto raw = (uint8_t *)ptr - JSONRPC_ALLOC_HEADER_BYTES;
-  auto header = (jsonrpc_alloc_header_t *)raw;
-  if (header->tag != JSONRPC_ALLOC_TAG) {
+  if (arena_owns((const Arena *)ctx, ptr)) {
     return;
   }
-
-  if (header->origin == JSONRPC_ALLOC_ORIGIN_HEAP) {
-    free(raw);
+  for (size_t i = t_arena_scope_count; i > 0U; --i) {
+    const Arena *arena = t_arena_scopes[i - 1U];
+    if (arena != ctx && arena_owns(arena, ptr)) {
+      return;
+    }
   }
-}
 
-static void jsonrpc_init_parson_allocator() {
-  if (g_parson_allocator_initialized) {
+  // Only tagged memory is freed. Anything else is arena memory outliving its
+  // scope or reaching another connection's arena; it goes with that arena.
+  auto raw = (uint8_t *)ptr - JSONRPC_HEAP_HEADER_BYTES;
+  uintptr_t tag = 0U;
+  memcpy(&tag, raw, sizeof(tag));
+  if (tag != (JSONRPC_HEAP_TAG ^ (uintptr_t)raw)) {
     return;
   }
+  memset(raw, 0, sizeof(tag));
+  free(raw);
+}
+
+static void jsonrpc_install_parson_allocator() {
+  json_set_allocation_functions_with_context(jsonrpc_arena_malloc,
+                                             jsonrpc_arena_free);
+}
 
-  json_set_allocation_functions(jsonrpc_arena_malloc, jsonrpc_arena_free);
-  g_parson_allocator_initialized = true;
+static void jsonrpc_init_parson_allocator() {
+  call_once(&g_parson_allocator_once, jsonrpc_install_parson_allocator);
 }
 
 static void jsonrpc_conn_ensure_arena(jsonrpc_conn_t *conn) {
@@ -147,16 +238,21 @@ static void jsonrpc_conn_ensure_arena(jsonrpc_conn_t *conn) {
     return;
   }
 
-  conn->arena = arena_create(JSONRPC_ARENA_BYTES);
+  conn->arena = arena_create_chained(JSONRPC_ARENA_BYTES);
 }
 
 static jsonrpc_arena_scope_t jsonrpc_arena_scope_begin(Arena *arena) {
-  jsonrpc_arena_scope_t scope = {.prev = g_current_arena, .changed = false};
-  if (arena == nullptr || g_current_arena == arena) {
+  jsonrpc_arena_scope_t scope = {
+      .prev = (Arena *)json_get_allocation_context(), .changed = false};
+  if (arena == nullptr || scope.prev == arena ||
+      t_arena_scope_count == JSONRPC_ARENA_SCOPE_DEPTH) {
+    // Nothing to switch to, or nested too deeply: keep allocating from the
+    // enclosing context, which outlives this scope.
     return scope;
   }
 
-  g_current_arena = arena;
+  t_arena_scopes[t_arena_scope_count++] = arena;
+  (void)json_set_allocation_context(arena);
   scope.changed = true;
   return scope;
 }
@@ -169,7 +265,33 @@ static void jsonrpc_arena_scope_end(Arena *arena, jsonrpc_arena_scope_t scope) {
   if (arena != nullptr) {
     arena_clear(arena);
   }
-  g_current_arena = scope.prev;
+  t_arena_scope_count -= 1U;
+  (void)json_set_allocation_context(scope.prev);
+}
+
+// Marks a parsed request as released together with the active arena, so
+// freeing it skips the walk. Only done when the root lies in the arena and
+// nothing since fallbacks_before spilled to the heap. Handler results may
+// attach values the handler already owned, so they are always freed node by
+// node.
+static void jsonrpc_arena_adopt(JSON_Value *value, size_t fallbacks_before) {
+  if (value == nullptr || t_arena_heap_fallbacks != fallbacks_before) {
+    return;
+  }
+  auto arena = (const Arena *)json_get_allocation_context();
+  if (arena_owns(arena, value)) {
+    json_value_set_bulk_owned(value, true);
+  }
+}
+
+// State that outlives the current message (deferred requests and batches)
+// must not be allocated from the connection arena.
+static Arena *jsonrpc_heap_scope_begin() {
+  return (Arena *)json_set_allocation_context(nullptr);
+}
+
+static void jsonrpc_heap_scope_end(Arena *prev) {
+  (void)json_set_allocation_context(prev);
 }
 
 static const char *jsonrpc_default_message(int32_t code) {
@@ -194,10 +316,15 @@ static void rpc_buffer_free(rpc_buffer_t *buffer) {
     free(buffer->data);
     buffer->data = nullptr;
   }
+  buffer->start = 0U;
   buffer->len = 0U;
   buffer->cap = 0U;
 }
 
+static inline uint8_t *rpc_buffer_begin(const rpc_buffer_t *buffer) {
+  return buffer->data + buffer->start;
+}
+
 static void rpc_buffer_maybe_shrink(rpc_buffer_t *buffer) {
   if (buffer == nullptr || buffer->data == nullptr) {
     return;
@@ -205,6 +332,7 @@ static void rpc_buffer_maybe_shrink(rpc_buffer_t *buffer) {
   if (buffer->len != 0U) {
     return;
   }
+  buffer->start = 0U;
   if (buffer->cap <= RPC_BUFFER_SHRINK_THRESHOLD) {
     return;
   }
@@ -225,7 +353,13 @@ static bool rpc_buffer_reserve(rpc_buffer_t *buffer, size_t desired) {
     return false;
   }
 
+  if (desired <= buffer->cap - buffer->start) {
+    return true;
+  }
   if (desired <= buffer->cap) {
+    // Enough room once the consumed prefix is dropped.
+    memmove(buffer->data, rpc_buffer_begin(buffer), buffer->len);
+    buffer->start = 0U;
     return true;
   }
 
@@ -247,27 +381,28 @@ static bool rpc_buffer_reserve(rpc_buffer_t *buffer, size_t desired) {
   }
 
   if (buffer->data != nullptr && buffer->len > 0U) {
-    memcpy(new_data, buffer->data, buffer->len);
+    memcpy(new_data, rpc_buffer_begin(buffer), buffer->len);
   }
   if (buffer->data != nullptr) {
     free(buffer->data);
   }
 
   buffer->data = new_data;
+  buffer->start = 0U;
   buffer->cap = new_cap;
   return true;
 }
 
 [[nodiscard]]
 static bool rpc_buffer_append(rpc_buffer_t *buffer, const uint8_t *data,
-                              size_t len) {
+                              size_t len, size_t limit) {
   if (buffer == nullptr || (len != 0U && data == nullptr)) {
     return false;
   }
   if (len == 0U) {
     return true;
   }
-  if (len > MAX_BUFFER_BYTES - buffer->len) {
+  if (buffer->len > limit || len > limit - buffer->len) {
     return false;
   }
   const size_t required = buffer->len + len;
@@ -275,7 +410,7 @@ static bool rpc_buffer_append(rpc_buffer_t *buffer, const uint8_t *data,
     return false;
   }
 
-  memcpy(buffer->data + buffer->len, data, len);
+  memcpy(rpc_buffer_begin(buffer) + buffer->len, data, len);
   buffer->len += len;
   return true;
 }
@@ -284,45 +419,585 @@ static void rpc_buffer_consume(rpc_buffer_t *buffer, size_t count) {
   if (count == 0U || buffer->len < count) {
     return;
   }
-  const size_t remaining = buffer->len - count;
-  if (remaining > 0U) {
-    memmove(buffer->data, buffer->data + count, remaining);
-  }
-  buffer->len = remaining;
+  buffer->start += count;
+  buffer->len -= count;
   if (buffer->len == 0U) {
     rpc_buffer_maybe_shrink(buffer);
   }
 }
 
+// Framing kernels: each returns the index of the first '\n' in data[0, len),
+// or len when there is none, and sets *saw_nul when a '\0' precedes it. The
+// caller resumes from where the previous call stopped, so every inbound byte
+// is examined once for both characters.
+static size_t rpc_scan_frame_scalar(const uint8_t *data, size_t len,
+                                    bool *saw_nul) {
+  for (size_t i = 0U; i < len; ++i) {
+    if (data[i] == '\n') {
+      return i;
+    }
+    if (data[i] == '\0') {
+      *saw_nul = true;
+    }
+  }
+  return len;
+}
+
+#if defined(__SSE2__)
+static size_t rpc_scan_frame_sse2(const uint8_t *data, size_t len,
+                                  bool *saw_nul) {
+  const __m128i newline = _mm_set1_epi8('\n');
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0U;
+  for (; i + 16U <= len; i += 16U) {
+    const __m128i chunk = _mm_loadu_si128((const __m128i *)(data + i));
+    const auto newlines =
+        (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline));
+    const auto nuls = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, zero));
+    if (newlines != 0U) {
+      const auto pos = (uint32_t)__builtin_ctz(newlines);
+      if ((nuls & ((1U << pos) - 1U)) != 0U) {
+        *saw_nul = true;
+      }
+      return i + pos;
+    }
+    if (nuls != 0U) {
+      *saw_nul = true;
+    }
+  }
+  return i + rpc_scan_frame_scalar(data + i, len - i, saw_nul);
+}
+#endif
+
+#if defined(__SSE2__) && defined(__x86_64__)
+#define JSONRPC_SCAN_AVX2 1
+[[gnu::target("avx2")]]
+static size_t rpc_scan_frame_avx2(const uint8_t *data, size_t len,
+                                  bool *saw_nul) {
+  const __m256i newline = _mm256_set1_epi8('\n');
+  const __m256i zero = _mm256_setzero_si256();
+  size_t i = 0U;
+  for (; i + 32U <= len; i += 32U) {
+    const __m256i chunk = _mm256_loadu_si256((const __m256i *)(data + i));
+    const auto newlines =
+        (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, newline));
+    const auto nuls =
+        (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, zero));
+    if (newlines != 0U) {
+      const auto pos = (uint32_t)__builtin_ctz(newlines);
+      if ((nuls & ((1U << pos) - 1U)) != 0U) {
+        *saw_nul = true;
+      }
+      return i + pos;
+    }
+    if (nuls != 0U) {
+      *saw_nul = true;
+    }
+  }
+  return i + rpc_scan_frame_sse2(data + i, len - i, saw_nul);
+}
+#endif
+
+static size_t rpc_scan_frame(const uint8_t *data, size_t len, bool *saw_nul) {
+#if defined(JSONRPC_SCAN_AVX2)
+  if (len >= 32U && __builtin_cpu_supports("avx2")) {
+    return rpc_scan_frame_avx2(data, len, saw_nul);
+  }
+#endif
+#if defined(__SSE2__)
+  return rpc_scan_frame_sse2(data, len, saw_nul);
+#else
+  return rpc_scan_frame_scalar(data, len, saw_nul);
+#endif
+}
+
+// Write value in decimal at out; returns the digit count.
+static size_t rpc_write_decimal(size_t value, uint8_t *out) {
+  char digits[20];
+  size_t digit_count = 0U;
+  do {
+    digits[digit_count++] = (char)('0' + value % 10U);
+    value /= 10U;
+  } while (value != 0U);
+  for (size_t i = 0U; i < digit_count; ++i) {
+    out[i] = (uint8_t)digits[digit_count - 1U - i];
+  }
+  return digit_count;
+}
+
+// Copy text to out + at; returns the offset past it.
+static size_t rpc_append(uint8_t *out, size_t at, const char *text) {
+  const size_t len = strlen(text);
+  memcpy(out + at, text, len);
+  return at + len;
+}
+
+/**
+ * @brief HTTP response header for a body_len-byte body. The common 200 JSON
+ * keep-alive header is one precomputed prefix plus the length; 204 has no
+ * body headers at all.
+ */
+static size_t rpc_http_header(uint16_t status, jsonrpc_encoding_t encoding,
+                              bool keep_alive, size_t body_len, uint8_t *out) {
+  static const char ok_json[] = "HTTP/1.1 200 OK\r\n"
+                                "Content-Type: application/json\r\n"
+                                "Content-Length: ";
+  size_t len = 0U;
+  if (status == 200U && encoding == JSONRPC_ENCODING_JSON) {
+    len = rpc_append(out, len, ok_json);
+  } else {
+    switch (status) {
+    case 200U:
+      len = rpc_append(out, len, "HTTP/1.1 200 OK\r\n");
+      break;
+    case 204U:
+      len = rpc_append(out, len, "HTTP/1.1 204 No Content\r\n");
+      break;
+    case 405U:
+      len = rpc_append(out, len, "HTTP/1.1 405 Method Not Allowed\r\n");
+      len = rpc_append(out, len, "Allow: POST\r\n");
+      break;
+    case 413U:
+      len = rpc_append(out, len, "HTTP/1.1 413 Content Too Large\r\n");
+      break;
+    case 501U:
+      len = rpc_append(out, len, "HTTP/1.1 501 Not Implemented\r\n");
+      break;
+    default:
+      len = rpc_append(out, len, "HTTP/1.1 400 Bad Request\r\n");
+      break;
+    }
+    if (status != 204U) {
+      len = encoding == JSONRPC_ENCODING_MSGPACK
+                ? rpc_append(out, len, "Content-Type: application/msgpack\r\n")
+                : rpc_append(out, len, "Content-Type: application/json\r\n");
+      len = rpc_append(out, len, "Content-Length: ");
+    }
+  }
+  if (status != 204U) {
+    len += rpc_write_decimal(body_len, out + len);
+    len = rpc_append(out, len, "\r\n");
+  }
+  if (!keep_alive) {
+    len = rpc_append(out, len, "Connection: close\r\n");
+  }
+  return rpc_append(out, len, "\r\n");
+}
+
+size_t jsonrpc_frame_header(jsonrpc_framing_t framing, size_t body_len,
+                            uint8_t *out) {
+  if (out == nullptr) {
+    return 0U;
+  }
+  switch (framing) {
+  case JSONRPC_FRAMING_NEWLINE:
+    return 0U;
+  case JSONRPC_FRAMING_LENGTH_PREFIX:
+    if (body_len > UINT32_MAX) {
+      return 0U;
+    }
+    out[0] = (uint8_t)(body_len >> 24U);
+    out[1] = (uint8_t)(body_len >> 16U);
+    out[2] = (uint8_t)(body_len >> 8U);
+    out[3] = (uint8_t)body_len;
+    return LENGTH_PREFIX_BYTES;
+  case JSONRPC_FRAMING_CONTENT_LENGTH: {
+    size_t len = rpc_append(out, 0U, "Content-Length: ");
+    len += rpc_write_decimal(body_len, out + len);
+    return rpc_append(out, len, "\r\n\r\n");
+  }
+  case JSONRPC_FRAMING_HTTP:
+    return rpc_http_header(200U, JSONRPC_ENCODING_JSON, true, body_len, out);
+  case JSONRPC_FRAMING_WEBSOCKET:
+    return jsonrpc_ws_frame_header(JSONRPC_WS_TEXT, body_len, out);
+  }
+  return 0U;
+}
+
+typedef enum {
+  RPC_FRAME_INCOMPLETE,
+  RPC_FRAME_READY, // the frame's header fields are set
+  RPC_FRAME_INVALID,
+} rpc_frame_status_t;
+
+typedef struct {
+  size_t header_len;
+  size_t body_len;
+  // HTTP only.
+  uint16_t status;       // response status when the header is invalid
+  bool keep_alive;       // the connection persists after the response
+  bool expect_continue;  // the client waits for "100 Continue" to send the body
+  // WebSocket handshake only.
+  bool upgrade;            // Upgrade: websocket
+  bool connection_upgrade; // Connection lists "upgrade"
+  bool ws_version_ok;      // Sec-WebSocket-Version: 13
+  const uint8_t *ws_key;   // Sec-WebSocket-Key, pointing into the request
+  size_t ws_key_len;
+} rpc_frame_t;
+
+// Case-insensitive match of an ASCII header name or token.
+static bool rpc_header_token_is(const uint8_t *name, size_t len,
+                                const char *expected) {
+  for (size_t i = 0U; i < len; ++i) {
+    uint8_t c = name[i];
+    if (c >= 'A' && c <= 'Z') {
+      c = (uint8_t)(c - 'A' + 'a');
+    }
+    if (expected[i] == '\0' || c != (uint8_t)expected[i]) {
+      return false;
+    }
+  }
+  return expected[len] == '\0';
+}
+
+static bool rpc_is_space(uint8_t c) { return c == ' ' || c == '\t'; }
+
+/**
+ * @brief Parse an HTTP request line ("POST /target HTTP/1.1") ending at
+ * line_end. Only POST carries JSON-RPC, and only GET opens a WebSocket; the
+ * target is not interpreted.
+ */
+static bool rpc_parse_request_line(const uint8_t *data, size_t line_end,
+                                   bool websocket, rpc_frame_t *frame) {
+  static const char version[] = "HTTP/1.";
+  const size_t version_len = sizeof(version) - 1U + 1U;
+  const uint8_t *space = (const uint8_t *)memchr(data, ' ', line_end);
+  if (space == nullptr || line_end < version_len + 2U ||
+      data[line_end - version_len - 1U] != ' ' ||
+      (size_t)(space - data) + 1U >= line_end - version_len - 1U) {
+    return false;
+  }
+  if (websocket) {
+    if (space - data != 3 || memcmp(data, "GET", 3U) != 0) {
+      return false;
+    }
+  } else if (space - data != 4 || memcmp(data, "POST", 4U) != 0) {
+    frame->status = 405U;
+    return false;
+  }
+  const uint8_t *v = data + line_end - version_len;
+  if (memcmp(v, version, version_len - 1U) != 0 ||
+      (v[version_len - 1U] != '0' && v[version_len - 1U] != '1')) {
+    return false;
+  }
+  // HTTP/1.1 connections persist unless closed; 1.0 ones only on request.
+  frame->keep_alive = v[version_len - 1U] == '1';
+  return true;
+}
+
+/**
+ * @brief Apply one HTTP header other than Content-Length. Connection may
+ * list several tokens; any Transfer-Encoding means a chunked or otherwise
+ * encoded body this parser does not read. The upgrade headers only matter
+ * to a WebSocket handshake.
+ */
+static bool rpc_apply_http_header(const uint8_t *name, size_t name_len,
+                                  const uint8_t *value, size_t value_len,
+                                  rpc_frame_t *frame) {
+  if (rpc_header_token_is(name, name_len, "transfer-encoding")) {
+    frame->status = 501U;
+    return false;
+  }
+  if (rpc_header_token_is(name, name_len, "expect")) {
+    frame->expect_continue =
+        rpc_header_token_is(value, value_len, "100-continue");
+    return true;
+  }
+  if (rpc_header_token_is(name, name_len, "upgrade")) {
+    frame->upgrade = rpc_header_token_is(value, value_len, "websocket");
+    return true;
+  }
+  if (rpc_header_token_is(name, name_len, "sec-websocket-key")) {
+    frame->ws_key = value;
+    frame->ws_key_len = value_len;
+    return true;
+  }
+  if (rpc_header_token_is(name, name_len, "sec-websocket-version")) {
+    frame->ws_version_ok = rpc_header_token_is(value, value_len, "13");
+    return true;
+  }
+  if (rpc_header_token_is(name, name_len, "connection")) {
+    size_t token = 0U;
+    while (token < value_len) {
+      size_t token_end = token;
+      while (token_end < value_len && value[token_end] != ',') {
+        token_end += 1U;
+      }
+      size_t first = token;
+      size_t last = token_end;
+      while (first < last && rpc_is_space(value[first])) {
+        first += 1U;
+      }
+      while (last > first && rpc_is_space(value[last - 1U])) {
+        last -= 1U;
+      }
+      if (rpc_header_token_is(value + first, last - first, "close")) {
+        frame->keep_alive = false;
+      } else if (rpc_header_token_is(value + first, last - first,
+                                     "upgrade")) {
+        frame->connection_upgrade = true;
+      } else if (rpc_header_token_is(value + first, last - first,
+                                     "keep-alive")) {
+        frame->keep_alive = true;
+      }
+      token = token_end + 1U;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Parse a header block ending in "\r\n\r\n": LSP-style headers, or
+ * for HTTP and a WebSocket handshake a request line and headers. A repeated
+ * or malformed Content-Length is invalid; a missing one is too, except that
+ * an HTTP request without one has an empty body. Other headers are skipped.
+ */
+static rpc_frame_status_t rpc_parse_headers(jsonrpc_framing_t framing,
+                                            const uint8_t *data, size_t len,
+                                            rpc_frame_t *frame) {
+  const bool websocket = framing == JSONRPC_FRAMING_WEBSOCKET;
+  const bool http = framing == JSONRPC_FRAMING_HTTP || websocket;
+  const size_t headers_max =
+      http ? HTTP_HEADERS_MAX : CONTENT_LENGTH_HEADERS_MAX;
+  const size_t limit = len < headers_max ? len : headers_max;
+  size_t end = 0U;
+  while (end + 4U <= limit && memcmp(data + end, "\r\n\r\n", 4U) != 0) {
+    end += 1U;
+  }
+  if (end + 4U > limit) {
+    return len < headers_max ? RPC_FRAME_INCOMPLETE : RPC_FRAME_INVALID;
+  }
+
+  frame->status = 400U;
+  size_t line = 0U;
+  if (http) {
+    const uint8_t *cr = (const uint8_t *)memchr(data, '\r', end + 1U);
+    const size_t line_end = (size_t)(cr - data);
+    if (data[line_end + 1U] != '\n' ||
+        !rpc_parse_request_line(data, line_end, websocket, frame)) {
+      return RPC_FRAME_INVALID;
+    }
+    line = line_end + 2U;
+    frame->body_len = 0U;
+    frame->expect_continue = false;
+  }
+
+  bool found = false;
+  while (line <= end) {
+    size_t line_end = line;
+    while (line_end < end && data[line_end] != '\r') {
+      line_end += 1U;
+    }
+    if (line_end < end && data[line_end + 1U] != '\n') {
+      return RPC_FRAME_INVALID;
+    }
+    size_t colon = line;
+    while (colon < line_end && data[colon] != ':') {
+      colon += 1U;
+    }
+    if (colon == line_end || colon == line) {
+      return RPC_FRAME_INVALID;
+    }
+    size_t i = colon + 1U;
+    while (i < line_end && rpc_is_space(data[i])) {
+      i += 1U;
+    }
+    if (rpc_header_token_is(data + line, colon - line, "content-length")) {
+      size_t value = 0U;
+      const size_t digits_start = i;
+      while (i < line_end && data[i] >= '0' && data[i] <= '9') {
+        const auto digit = (size_t)(data[i] - '0');
+        if (value > (SIZE_MAX - digit) / 10U) {
+          return RPC_FRAME_INVALID;
+        }
+        value = value * 10U + digit;
+        i += 1U;
+      }
+      while (i < line_end && rpc_is_space(data[i])) {
+        i += 1U;
+      }
+      if (found || i == digits_start || i != line_end) {
+        return RPC_FRAME_INVALID;
+      }
+      found = true;
+      frame->body_len = value;
+    } else if (http) {
+      size_t value_end = line_end;
+      while (value_end > i && rpc_is_space(data[value_end - 1U])) {
+        value_end -= 1U;
+      }
+      if (!rpc_apply_http_header(data + line, colon - line, data + i,
+                                 value_end - i, frame)) {
+        return RPC_FRAME_INVALID;
+      }
+    }
+    line = line_end + 2U;
+  }
+  if (!found && !http) {
+    return RPC_FRAME_INVALID;
+  }
+  frame->header_len = end + 4U;
+  return RPC_FRAME_READY;
+}
+
+static rpc_frame_status_t rpc_parse_frame_header(jsonrpc_framing_t framing,
+                                                 const uint8_t *data,
+                                                 size_t len,
+                                                 rpc_frame_t *frame) {
+  if (framing != JSONRPC_FRAMING_LENGTH_PREFIX) {
+    return rpc_parse_headers(framing, data, len, frame);
+  }
+  if (len < LENGTH_PREFIX_BYTES) {
+    return RPC_FRAME_INCOMPLETE;
+  }
+  frame->header_len = LENGTH_PREFIX_BYTES;
+  frame->body_len = (size_t)data[0] << 24U | (size_t)data[1] << 16U |
+                    (size_t)data[2] << 8U | (size_t)data[3];
+  return RPC_FRAME_READY;
+}
+
 [[nodiscard]]
-static bool jsonrpc_send_value(jsonrpc_conn_t *conn, const JSON_Value *value) {
-  if (conn == nullptr || conn->transport.send_raw == nullptr ||
-      value == nullptr || conn->closed) {
+static bool jsonrpc_transport_sink_grow(JSON_Output_Sink *sink,
+                                        size_t min_free) {
+  auto transport = (jsonrpc_transport_t *)sink->user_data;
+  if (min_free > SIZE_MAX - sink->len) {
     return false;
   }
+  const size_t needed = sink->len + min_free;
+  size_t cap = 0U;
+  uint8_t *region = transport->reserve(transport, needed, &cap);
+  if (region == nullptr || cap < needed) {
+    return false;
+  }
+  sink->data = (char *)region;
+  sink->cap = cap;
+  return true;
+}
 
-  auto serialized = json_serialize_to_string(value);
-  if (serialized == nullptr) {
+[[nodiscard]]
+static bool jsonrpc_buffer_sink_grow(JSON_Output_Sink *sink, size_t min_free) {
+  auto buffer = (rpc_buffer_t *)sink->user_data;
+  if (min_free > SIZE_MAX - sink->len) {
+    return false;
+  }
+  buffer->len = sink->len;
+  if (!rpc_buffer_reserve(buffer, sink->len + min_free)) {
     return false;
   }
+  sink->data = (char *)buffer->data;
+  sink->cap = buffer->cap;
+  return true;
+}
+
+/**
+ * @brief Header for a message sent on conn. HTTP responses carry the status
+ * of the request they answer, as do errors refusing a WebSocket handshake;
+ * WebSocket messages are text frames, or binary ones for MessagePack.
+ */
+static size_t jsonrpc_conn_frame_header(const jsonrpc_conn_t *conn,
+                                        size_t body_len, uint8_t *out) {
+  if (conn->framing == JSONRPC_FRAMING_HTTP ||
+      (conn->framing == JSONRPC_FRAMING_WEBSOCKET && !conn->ws.open)) {
+    return rpc_http_header(conn->http_status, conn->encoding,
+                           conn->http_keep_alive, body_len, out);
+  }
+  if (conn->framing == JSONRPC_FRAMING_WEBSOCKET) {
+    return jsonrpc_ws_frame_header(conn->encoding == JSONRPC_ENCODING_MSGPACK
+                                       ? JSONRPC_WS_BINARY
+                                       : JSONRPC_WS_TEXT,
+                                   body_len, out);
+  }
+  return jsonrpc_frame_header(conn->framing, body_len, out);
+}
 
-  const size_t len = strlen(serialized);
-  if (len > SIZE_MAX - 1U) {
-    json_free_serialized_string(serialized);
+[[nodiscard]]
+static bool jsonrpc_send_value(jsonrpc_conn_t *conn, const JSON_Value *value) {
+  if (conn == nullptr || conn->transport.send_raw == nullptr ||
+      value == nullptr || conn->closed) {
     return false;
   }
-  auto payload = (uint8_t *)jsonrpc_arena_malloc(len + 1U);
-  if (payload == nullptr) {
-    json_free_serialized_string(serialized);
+
+  // Serialize straight into the transport's outbound queue when it supports
+  // reservations; otherwise into the connection's reusable scratch buffer.
+  const bool zero_copy =
+      conn->transport.reserve != nullptr && conn->transport.commit != nullptr;
+  JSON_Output_Sink sink = {.data = nullptr,
+                           .len = 0U,
+                           .cap = 0U,
+                           .grow = jsonrpc_transport_sink_grow,
+                           .user_data = &conn->transport};
+  if (!zero_copy) {
+    conn->outbound.start = 0U;
+    conn->outbound.len = 0U;
+    sink.data = (char *)conn->outbound.data;
+    sink.cap = conn->outbound.cap;
+    sink.grow = jsonrpc_buffer_sink_grow;
+    sink.user_data = &conn->outbound;
+  }
+
+  // Newline framing reserves one byte past the document for the delimiter.
+  // Length-delimited framings leave room for the longest header in front
+  // and fill in its tail once the body length is known; the unused head of
+  // the room is skipped when sending.
+  const bool newline = conn->framing == JSONRPC_FRAMING_NEWLINE;
+  size_t header_room = 0U;
+  switch (conn->framing) {
+  case JSONRPC_FRAMING_NEWLINE:
+    break;
+  case JSONRPC_FRAMING_LENGTH_PREFIX:
+    header_room = LENGTH_PREFIX_BYTES;
+    break;
+  case JSONRPC_FRAMING_CONTENT_LENGTH:
+    header_room = CONTENT_LENGTH_HEADER_MAX;
+    break;
+  case JSONRPC_FRAMING_HTTP:
+    header_room = JSONRPC_FRAME_HEADER_MAX;
+    break;
+  case JSONRPC_FRAMING_WEBSOCKET:
+    header_room = conn->ws.open ? JSONRPC_WS_SEND_HEADER_MAX
+                                : JSONRPC_FRAME_HEADER_MAX;
+    break;
+  }
+  bool serialized = header_room <= sink.cap || sink.grow(&sink, header_room);
+  if (serialized) {
+    sink.len = header_room;
+    serialized =
+        conn->encoding == JSONRPC_ENCODING_MSGPACK
+            ? jsonrpc_msgpack_encode(value, &sink)
+            : json_serialize_to_sink(value, &sink, newline ? 1U : 0U) ==
+                  JSONSuccess;
+  }
+  uint8_t header[JSONRPC_FRAME_HEADER_MAX];
+  const size_t body_len = sink.len - header_room;
+  size_t header_len = 0U;
+  if (serialized) {
+    header_len = jsonrpc_conn_frame_header(conn, body_len, header);
+  }
+  if (!serialized || (!newline && header_len == 0U)) {
+    if (!zero_copy) {
+      rpc_buffer_maybe_shrink(&conn->outbound);
+    }
     return false;
   }
+  size_t skip = 0U;
+  if (newline) {
+    sink.data[sink.len] = '\n';
+    sink.len += 1U;
+  } else {
+    skip = header_room - header_len;
+    memcpy(sink.data + skip, header, header_len);
+  }
 
-  memcpy(payload, serialized, len);
-  payload[len] = '\n';
-  const bool sent =
-      conn->transport.send_raw(&conn->transport, payload, len + 1U);
-  jsonrpc_arena_free(payload);
-  json_free_serialized_string(serialized);
+  bool sent = false;
+  if (zero_copy) {
+    sent = conn->transport.commit(&conn->transport, skip, sink.len - skip);
+  } else {
+    sent = conn->transport.send_raw(&conn->transport,
+                                    (const uint8_t *)sink.data + skip,
+                                    sink.len - skip);
+    conn->outbound.len = 0U;
+    rpc_buffer_maybe_shrink(&conn->outbound);
+  }
 
   if (!sent) {
     if (conn->transport.close != nullptr) {
@@ -331,9 +1006,40 @@ static bool jsonrpc_send_value(jsonrpc_conn_t *conn, const JSON_Value *value) {
     return false;
   }
 
+  conn->http_responded = true;
   return true;
 }
 
+/**
+ * @brief HTTP framing: the current request has been handled and any deferred
+ * part of it answered. Send 204 if nothing was, and close the connection if
+ * the request asked for that; otherwise read again if reads were paused.
+ * @return false when the connection was closed.
+ */
+[[nodiscard]]
+static bool jsonrpc_conn_http_finish(jsonrpc_conn_t *conn) {
+  if (!conn->http_responded && !conn->closed) {
+    uint8_t header[JSONRPC_FRAME_HEADER_MAX];
+    const size_t header_len = rpc_http_header(
+        204U, conn->encoding, conn->http_keep_alive, 0U, header);
+    if (!conn->transport.send_raw(&conn->transport, header, header_len)) {
+      conn->http_keep_alive = false;
+    }
+    conn->http_responded = true;
+  }
+  if (conn->http_keep_alive && !conn->closed) {
+    if (conn->reads_paused) {
+      conn->reads_paused = false;
+      conn->transport.resume_reads(&conn->transport);
+    }
+    return true;
+  }
+  if (!conn->closed && conn->transport.close != nullptr) {
+    conn->transport.close(&conn->transport);
+  }
+  return false;
+}
+
 [[nodiscard]]
 static JSON_Value *jsonrpc_copy_id(const JSON_Value *id) {
   if (id == nullptr) {
@@ -466,6 +1172,83 @@ static bool jsonrpc_params_is_valid(const JSON_Value *params) {
   return type == JSONArray || type == JSONObject;
 }
 
+// Appends a heap copy of response; the caller keeps ownership of response.
+[[nodiscard]]
+static bool jsonrpc_batch_add(jsonrpc_batch_t *batch,
+                              const JSON_Value *response) {
+  if (response == nullptr) {
+    return false;
+  }
+  Arena *prev = jsonrpc_heap_scope_begin();
+  JSON_Value *copy = json_value_deep_copy(response);
+  bool added = copy != nullptr;
+  if (added && json_array_append_value(json_value_get_array(batch->responses),
+                                       copy) != JSONSuccess) {
+    json_value_free(copy);
+    added = false;
+  }
+  jsonrpc_heap_scope_end(prev);
+  return added;
+}
+
+static void jsonrpc_batch_maybe_finish(jsonrpc_batch_t *batch) {
+  if (batch->open || batch->pending != 0U) {
+    return;
+  }
+  jsonrpc_conn_t *conn = batch->conn;
+  if (conn != nullptr && !conn->closed &&
+      json_array_get_count(json_value_get_array(batch->responses)) != 0U) {
+    (void)jsonrpc_send_value(conn, batch->responses);
+  }
+  json_value_free(batch->responses);
+  free(batch);
+}
+
+static void jsonrpc_handle_release(jsonrpc_request_handle_t *handle) {
+  if (handle->conn != nullptr) {
+    if (handle->prev != nullptr) {
+      handle->prev->next = handle->next;
+    } else {
+      handle->conn->handles = handle->next;
+    }
+    if (handle->next != nullptr) {
+      handle->next->prev = handle->prev;
+    }
+  }
+  if (handle->batch != nullptr) {
+    handle->batch->pending -= 1U;
+    jsonrpc_batch_maybe_finish(handle->batch);
+  }
+  if (handle->id != nullptr) {
+    json_value_free(handle->id);
+  }
+  if (handle->params != nullptr) {
+    json_value_free(handle->params);
+  }
+  free(handle);
+}
+
+// Called when the connection is finalized: outstanding handles stay valid
+// but no longer reach it, and unfinished batches are dropped.
+static void jsonrpc_conn_detach_handles(jsonrpc_conn_t *conn) {
+  jsonrpc_request_handle_t *handle = conn->handles;
+  conn->handles = nullptr;
+  while (handle != nullptr) {
+    jsonrpc_request_handle_t *next = handle->next;
+    handle->conn = nullptr;
+    handle->prev = nullptr;
+    handle->next = nullptr;
+    if (handle->batch != nullptr) {
+      jsonrpc_batch_t *batch = handle->batch;
+      handle->batch = nullptr;
+      batch->conn = nullptr;
+      batch->pending -= 1U;
+      jsonrpc_batch_maybe_finish(batch);
+    }
+    handle = next;
+  }
+}
+
 [[nodiscard]]
 static JSON_Value *jsonrpc_process_object(jsonrpc_conn_t *conn,
                                           const JSON_Value *value) {
@@ -489,7 +1272,8 @@ static JSON_Value *jsonrpc_process_object(jsonrpc_conn_t *conn,
     return jsonrpc_build_error(id, JSONRPC_ERR_INVALID_REQUEST, nullptr);
   }
 
-  const char *method = json_object_get_string(obj, "method");
+  const JSON_Value *method_value = json_object_get_value(obj, "method");
+  const char *method = json_value_get_string(method_value);
   if (method == nullptr) {
     return jsonrpc_build_error(id, JSONRPC_ERR_INVALID_REQUEST, nullptr);
   }
@@ -502,8 +1286,23 @@ static JSON_Value *jsonrpc_process_object(jsonrpc_conn_t *conn,
     return jsonrpc_build_error(id, JSONRPC_ERR_INVALID_PARAMS, nullptr);
   }
 
+  const jsonrpc_method_t *route =
+      jsonrpc_router_find(conn->callbacks.router, method,
+                          json_value_get_string_len(method_value));
+
   if (!has_id) {
-    if (conn->callbacks.on_notification != nullptr) {
+    if (route != nullptr) {
+      if ((route->flags & JSONRPC_METHOD_REQUEST_ONLY) == 0U) {
+        jsonrpc_response_t discarded = {
+            .result = nullptr, .error_code = 0, .error_message = nullptr};
+        jsonrpc_conn_callback_enter(conn);
+        (void)route->handler(conn, params, &discarded, route->user_data);
+        jsonrpc_conn_callback_leave(conn);
+        if (discarded.result != nullptr) {
+          json_value_free(discarded.result);
+        }
+      }
+    } else if (conn->callbacks.on_notification != nullptr) {
       jsonrpc_conn_callback_enter(conn);
       conn->callbacks.on_notification(conn, method, params);
       jsonrpc_conn_callback_leave(conn);
@@ -514,16 +1313,59 @@ static JSON_Value *jsonrpc_process_object(jsonrpc_conn_t *conn,
     return nullptr;
   }
 
-  if (conn->callbacks.on_request == nullptr) {
+  if (route == nullptr && conn->callbacks.on_request == nullptr) {
     return jsonrpc_build_error(id, JSONRPC_ERR_METHOD_NOT_FOUND, nullptr);
   }
 
+  if (route != nullptr && (route->flags & JSONRPC_METHOD_BLOCKING) != 0U &&
+      conn->callbacks.offload != nullptr) {
+    conn->current_id = id;
+    conn->current_params = params;
+    jsonrpc_request_handle_t *handle = jsonrpc_conn_defer(conn, true);
+    conn->current_id = nullptr;
+    conn->current_params = nullptr;
+    conn->current_deferred = false;
+    if (handle != nullptr) {
+      jsonrpc_conn_callback_enter(conn);
+      const bool queued = conn->callbacks.offload(conn, route, handle);
+      jsonrpc_conn_callback_leave(conn);
+      if (!queued) {
+        jsonrpc_response_t inline_response = {
+            .result = nullptr, .error_code = 0, .error_message = nullptr};
+        jsonrpc_conn_callback_enter(conn);
+        const bool handled =
+            route->handler(conn, params, &inline_response, route->user_data);
+        jsonrpc_conn_callback_leave(conn);
+        (void)jsonrpc_request_complete_response(handle, handled,
+                                                &inline_response);
+      }
+      return nullptr;
+    }
+    // Deferring failed; fall back to handling the request inline.
+  }
+
   jsonrpc_response_t response = {
       .result = nullptr, .error_code = 0, .error_message = nullptr};
+  conn->current_id = id;
+  conn->current_params = params;
+  conn->current_deferred = false;
   jsonrpc_conn_callback_enter(conn);
   const bool handled =
-      conn->callbacks.on_request(conn, method, params, &response);
+      route != nullptr
+          ? route->handler(conn, params, &response, route->user_data)
+          : conn->callbacks.on_request(conn, method, params, &response);
   jsonrpc_conn_callback_leave(conn);
+  const bool deferred = conn->current_deferred;
+  conn->current_id = nullptr;
+  conn->current_params = nullptr;
+  conn->current_deferred = false;
+
+  if (deferred) {
+    if (response.result != nullptr) {
+      json_value_free(response.result);
+    }
+    return nullptr;
+  }
 
   if (conn->closed) {
     if (response.result != nullptr) {
@@ -575,7 +1417,10 @@ static JSON_Value *jsonrpc_process_value(jsonrpc_conn_t *conn,
     }
     auto response_array = json_value_get_array(response_array_value);
     size_t response_count = 0U;
+    bool append_failed = false;
 
+    conn->in_batch = true;
+    conn->current_batch = nullptr;
     for (size_t i = 0U; i < count; ++i) {
       if (conn->closed) {
         break;
@@ -587,11 +1432,39 @@ static JSON_Value *jsonrpc_process_value(jsonrpc_conn_t *conn,
       }
       if (json_array_append_value(response_array, response) != JSONSuccess) {
         json_value_free(response);
-        json_value_free(response_array_value);
-        return jsonrpc_build_error(nullptr, JSONRPC_ERR_INTERNAL, nullptr);
+        append_failed = true;
+        break;
       }
       response_count += 1U;
     }
+    jsonrpc_batch_t *batch = conn->current_batch;
+    conn->in_batch = false;
+    conn->current_batch = nullptr;
+
+    if (batch != nullptr) {
+      // Some members were deferred: the synchronous responses join the
+      // batch, which is sent when its last deferred member completes.
+      for (size_t i = 0U; i < response_count && !conn->closed; ++i) {
+        if (!jsonrpc_batch_add(batch,
+                               json_array_get_value(response_array, i))) {
+          append_failed = true;
+          break;
+        }
+      }
+      json_value_free(response_array_value);
+      batch->open = false;
+      jsonrpc_batch_maybe_finish(batch);
+      if (append_failed && !conn->closed &&
+          conn->transport.close != nullptr) {
+        conn->transport.close(&conn->transport);
+      }
+      return nullptr;
+    }
+
+    if (append_failed) {
+      json_value_free(response_array_value);
+      return jsonrpc_build_error(nullptr, JSONRPC_ERR_INTERNAL, nullptr);
+    }
 
     if (conn->closed) {
       json_value_free(response_array_value);
@@ -620,10 +1493,17 @@ static void jsonrpc_conn_finalize(jsonrpc_conn_t *conn) {
     jsonrpc_conn_callback_leave(conn);
   }
 
+  jsonrpc_conn_detach_handles(conn);
   rpc_buffer_free(&conn->inbound);
+  rpc_buffer_free(&conn->outbound);
   if (conn->arena != nullptr) {
-    if (g_current_arena == conn->arena) {
-      g_current_arena = nullptr;
+    if (json_get_allocation_context() == conn->arena) {
+      (void)json_set_allocation_context(nullptr);
+    }
+    for (size_t i = 0U; i < t_arena_scope_count; ++i) {
+      if (t_arena_scopes[i] == conn->arena) {
+        t_arena_scopes[i] = nullptr;
+      }
     }
     arena_destroy(conn->arena);
     conn->arena = nullptr;
@@ -655,9 +1535,31 @@ static void jsonrpc_conn_finalize_if_needed(jsonrpc_conn_t *conn) {
   conn->pending_free = false;
   conn->callback_depth = 0U;
   conn->inbound.data = nullptr;
+  conn->inbound.start = 0U;
   conn->inbound.len = 0U;
   conn->inbound.cap = 0U;
+  conn->outbound.data = nullptr;
+  conn->outbound.start = 0U;
+  conn->outbound.len = 0U;
+  conn->outbound.cap = 0U;
+  conn->inbound_scanned = 0U;
+  conn->inbound_saw_nul = false;
+  conn->framing = JSONRPC_FRAMING_NEWLINE;
+  conn->max_message_bytes = MAX_MESSAGE_BYTES;
+  conn->encoding = JSONRPC_ENCODING_JSON;
+  conn->encoding_open = false;
+  conn->http_status = 200U;
+  conn->http_keep_alive = true;
+  conn->http_responded = false;
+  conn->http_continue_sent = false;
+  conn->ws = (rpc_ws_t){};
   conn->arena = nullptr;
+  conn->current_id = nullptr;
+  conn->current_params = nullptr;
+  conn->current_deferred = false;
+  conn->in_batch = false;
+  conn->current_batch = nullptr;
+  conn->handles = nullptr;
 
   if (conn->callbacks.on_open != nullptr) {
     jsonrpc_conn_callback_enter(conn);
@@ -691,136 +1593,590 @@ void jsonrpc_conn_free(jsonrpc_conn_t *conn) {
   jsonrpc_conn_finalize(conn);
 }
 
-void jsonrpc_conn_feed(jsonrpc_conn_t *conn, const uint8_t *data, size_t len) {
-  if (conn == nullptr || data == nullptr || len == 0U) {
-    return;
+static void jsonrpc_conn_drop_input(jsonrpc_conn_t *conn, size_t count) {
+  rpc_buffer_consume(&conn->inbound, count);
+  // Only partial messages are buffered (complete ones are parsed from the
+  // caller's data), so with shared reads an idle connection keeps no inbound
+  // storage; otherwise it is kept for the next partial message.
+  if (conn->shared_reads && conn->inbound.len == 0U) {
+    rpc_buffer_free(&conn->inbound);
   }
-  if (conn->closed) {
-    jsonrpc_conn_finalize_if_needed(conn);
+}
+
+static void jsonrpc_conn_consume_input(jsonrpc_conn_t *conn, bool borrowed,
+                                       const uint8_t **view, size_t *view_len,
+                                       size_t count) {
+  if (borrowed) {
+    *view += count;
+    *view_len -= count;
     return;
   }
+  jsonrpc_conn_drop_input(conn, count);
+}
 
-  jsonrpc_init_parson_allocator();
+// Refuse input the connection cannot take (oversized, or a frame header that
+// does not parse): answer with an error, then close. Under HTTP framing the
+// error goes out with http_status.
+static void jsonrpc_conn_reject_input(jsonrpc_conn_t *conn,
+                                      uint16_t http_status,
+                                      const char *message) {
+  conn->http_status = http_status;
+  conn->http_keep_alive = false;
+  (void)jsonrpc_conn_send_error(conn, nullptr, JSONRPC_ERR_INVALID_REQUEST,
+                                message);
+  if (conn->transport.close != nullptr) {
+    conn->transport.close(&conn->transport);
+  }
+  jsonrpc_conn_finalize_if_needed(conn);
+}
 
-  if (!rpc_buffer_append(&conn->inbound, data, len)) {
-    const bool sent = jsonrpc_conn_send_error(
-        conn, nullptr, JSONRPC_ERR_INVALID_REQUEST, "Request too large");
-    if (!sent && conn->transport.close != nullptr) {
-      conn->transport.close(&conn->transport);
-      jsonrpc_conn_finalize_if_needed(conn);
-      return;
+/**
+ * @brief Parse and handle one complete message. message points into the
+ * caller's data or conn->inbound, which is left alone until this returns.
+ * @return false once the connection is closed (it may have been freed).
+ */
+[[nodiscard]]
+static bool jsonrpc_conn_dispatch(jsonrpc_conn_t *conn, const uint8_t *message,
+                                  size_t len, bool has_nul) {
+  conn->messages_completed += 1U;
+  jsonrpc_conn_ensure_arena(conn);
+  const jsonrpc_arena_scope_t scope = jsonrpc_arena_scope_begin(conn->arena);
+  JSON_Value *request = nullptr;
+  JSON_Value *response = nullptr;
+  bool close_connection = false;
+
+  // A request is a map and a batch an array: fixmap/fixarray (0x80-0x9F) or
+  // array/map 16/32 (0xDC-0xDF). JSON text never starts with those bytes;
+  // a UTF-8 BOM (0xEF) is JSON.
+  if (conn->encoding_open && len != 0U) {
+    conn->encoding_open = false;
+    if ((message[0] >= 0x80U && message[0] <= 0x9FU) ||
+        (message[0] >= 0xDCU && message[0] <= 0xDFU)) {
+      conn->encoding = JSONRPC_ENCODING_MSGPACK;
     }
-    if (conn->transport.close != nullptr) {
+  }
+
+  // Parse straight out of the input buffer: the parser is bounded by len and
+  // the DOM owns copies of every string, so the input can be consumed
+  // afterwards. A NUL found while framing is a parse error.
+  if (!has_nul) {
+    const size_t fallbacks_before = t_arena_heap_fallbacks;
+    request = conn->encoding == JSONRPC_ENCODING_MSGPACK
+                  ? jsonrpc_msgpack_decode(message, len)
+                  : json_parse_string_with_len((const char *)message, len);
+    jsonrpc_arena_adopt(request, fallbacks_before);
+  }
+
+  if (request == nullptr) {
+    const bool sent =
+        jsonrpc_conn_send_error(conn, nullptr, JSONRPC_ERR_PARSE, nullptr);
+    if (!sent && conn->transport.close != nullptr) {
       conn->transport.close(&conn->transport);
+      close_connection = true;
+      goto cleanup_message;
     }
-    jsonrpc_conn_finalize_if_needed(conn);
-    return;
+    goto cleanup_message;
   }
 
-  while (true) {
-    void *newline = memchr(conn->inbound.data, '\n', conn->inbound.len);
-    if (newline == nullptr) {
-      jsonrpc_conn_finalize_if_needed(conn);
-      return;
+  response = jsonrpc_process_value(conn, request);
+  if (response != nullptr) {
+    const bool sent = jsonrpc_send_value(conn, response);
+    if (!sent && conn->transport.close != nullptr) {
+      conn->transport.close(&conn->transport);
+      close_connection = true;
+      goto cleanup_message;
     }
+  }
 
-    const size_t newline_index =
-        (size_t)((uint8_t *)newline - conn->inbound.data);
-    size_t line_len = newline_index;
-    const size_t consume_len = line_len + 1U;
+cleanup_message:
+  // An HTTP request is finished here unless part of it was deferred.
+  if (conn->framing == JSONRPC_FRAMING_HTTP && !close_connection &&
+      conn->handles == nullptr && !jsonrpc_conn_http_finish(conn)) {
+    close_connection = true;
+  }
+  if (response != nullptr) {
+    json_value_free(response);
+  }
+  if (request != nullptr) {
+    json_value_free(request);
+  }
+  jsonrpc_arena_scope_end(conn->arena, scope);
+  if (close_connection || conn->closed) {
+    jsonrpc_conn_finalize_if_needed(conn);
+    return false;
+  }
+  return true;
+}
 
-    if (line_len > 0U && conn->inbound.data[line_len - 1U] == '\r') {
-      line_len -= 1U;
+static const char *rpc_frame_error_message(uint16_t http_status) {
+  switch (http_status) {
+  case 405U:
+    return "Method not allowed";
+  case 501U:
+    return "Transfer-Encoding not supported";
+  default:
+    return "Invalid frame header";
+  }
+}
+
+/**
+ * @brief jsonrpc_conn_feed for length-delimited framings. Whole frames are
+ * handled straight from data. A partial one is copied into inbound, sized for
+ * the whole frame once its header is known, and completed from later feeds
+ * without copying anything past its end; the payload is never scanned.
+ * Called with no data to resume HTTP requests held behind a deferred one.
+ */
+static void jsonrpc_conn_feed_framed(jsonrpc_conn_t *conn, const uint8_t *data,
+                                     size_t len) {
+  const bool http = conn->framing == JSONRPC_FRAMING_HTTP;
+  const size_t headers_max = http ? HTTP_HEADERS_MAX
+                             : conn->framing == JSONRPC_FRAMING_CONTENT_LENGTH
+                                 ? CONTENT_LENGTH_HEADERS_MAX
+                                 : LENGTH_PREFIX_BYTES;
+  const size_t frame_max = headers_max + conn->max_message_bytes;
+  while (true) {
+    if (http && conn->handles != nullptr) {
+      // Responses go out in request order, so requests pipelined behind a
+      // deferred one wait in inbound until it has been answered, with reads
+      // paused meanwhile. Nothing is refused here, as an error would go out
+      // ahead of the deferred response: each request is checked against the
+      // limit once it reaches the front.
+      if (len != 0U &&
+          !rpc_buffer_append(&conn->inbound, data, len, SIZE_MAX)) {
+        if (conn->transport.close != nullptr) {
+          conn->transport.close(&conn->transport);
+        }
+      } else if (len != 0U && !conn->reads_paused &&
+                 conn->transport.pause_reads != nullptr &&
+                 conn->transport.resume_reads != nullptr) {
+        conn->reads_paused = true;
+        conn->transport.pause_reads(&conn->transport);
+      }
+      jsonrpc_conn_finalize_if_needed(conn);
+      return;
     }
 
-    if (line_len == 0U) {
-      rpc_buffer_consume(&conn->inbound, consume_len);
+    const bool borrowed = conn->inbound.len == 0U;
+    const uint8_t *pending = borrowed ? data : rpc_buffer_begin(&conn->inbound);
+    const size_t pending_len = borrowed ? len : conn->inbound.len;
+    rpc_frame_t frame = {0};
+    const rpc_frame_status_t status =
+        rpc_parse_frame_header(conn->framing, pending, pending_len, &frame);
+    if (status == RPC_FRAME_INVALID) {
+      jsonrpc_conn_reject_input(conn, frame.status,
+                                rpc_frame_error_message(frame.status));
+      return;
+    }
+    const bool ready = status == RPC_FRAME_READY;
+    if (ready && frame.body_len > conn->max_message_bytes) {
+      jsonrpc_conn_reject_input(conn, 413U, "Request too large");
+      return;
+    }
+
+    const size_t frame_len = ready ? frame.header_len + frame.body_len : 0U;
+    if (ready && pending_len >= frame_len) {
+      if (http) {
+        conn->http_status = 200U;
+        conn->http_keep_alive = frame.keep_alive;
+        conn->http_responded = false;
+        conn->http_continue_sent = false;
+      }
+      // Empty frames are skipped, like blank lines; every HTTP request is
+      // answered, an empty one with a parse error.
+      if ((frame.body_len != 0U || http) &&
+          !jsonrpc_conn_dispatch(conn, pending + frame.header_len,
+                                 frame.body_len, false)) {
+        return;
+      }
+      if (borrowed) {
+        data += frame_len;
+        len -= frame_len;
+      } else {
+        jsonrpc_conn_drop_input(conn, frame_len);
+      }
       continue;
     }
 
-    if (line_len > MAX_MESSAGE_BYTES) {
-      const bool sent = jsonrpc_conn_send_error(
-          conn, nullptr, JSONRPC_ERR_INVALID_REQUEST, "Request too large");
-      if (!sent && conn->transport.close != nullptr) {
-        conn->transport.close(&conn->transport);
+    if (ready && frame.expect_continue && !conn->http_continue_sent) {
+      // The client holds the body back until told to go ahead.
+      static const char go_ahead[] = "HTTP/1.1 100 Continue\r\n\r\n";
+      conn->http_continue_sent = true;
+      if (!conn->transport.send_raw(&conn->transport,
+                                    (const uint8_t *)go_ahead,
+                                    sizeof(go_ahead) - 1U)) {
+        if (conn->transport.close != nullptr) {
+          conn->transport.close(&conn->transport);
+        }
         jsonrpc_conn_finalize_if_needed(conn);
         return;
       }
-      if (conn->transport.close != nullptr) {
-        conn->transport.close(&conn->transport);
-      }
+    }
+    if (len == 0U) {
       jsonrpc_conn_finalize_if_needed(conn);
       return;
     }
+    // Buffer the partial frame, or top up the one already buffered: up to
+    // its end when the header is known, else by at most the header limit.
+    size_t take = len;
+    if (!borrowed) {
+      const size_t wanted =
+          ready ? frame_len - pending_len : headers_max - pending_len;
+      take = len < wanted ? len : wanted;
+    }
+    if ((ready && !rpc_buffer_reserve(&conn->inbound, frame_len)) ||
+        !rpc_buffer_append(&conn->inbound, data, take, frame_max)) {
+      jsonrpc_conn_reject_input(conn, 413U, "Request too large");
+      return;
+    }
+    data += take;
+    len -= take;
+  }
+}
 
-    jsonrpc_conn_ensure_arena(conn);
-    const jsonrpc_arena_scope_t scope = jsonrpc_arena_scope_begin(conn->arena);
-    JSON_Value *request = nullptr;
-    JSON_Value *response = nullptr;
-    bool close_connection = false;
+/**
+ * @brief Send a WebSocket close frame, carrying code unless it is 0, and
+ * close the connection once it has gone out.
+ */
+static void jsonrpc_conn_ws_close(jsonrpc_conn_t *conn, uint16_t code) {
+  uint8_t frame[JSONRPC_WS_SEND_HEADER_MAX + 2U];
+  size_t len =
+      jsonrpc_ws_frame_header(JSONRPC_WS_CLOSE, code == 0U ? 0U : 2U, frame);
+  if (code != 0U) {
+    frame[len] = (uint8_t)(code >> 8U);
+    frame[len + 1U] = (uint8_t)code;
+    len += 2U;
+  }
+  (void)conn->transport.send_raw(&conn->transport, frame, len);
+  if (conn->transport.close != nullptr) {
+    conn->transport.close(&conn->transport);
+  }
+  jsonrpc_conn_finalize_if_needed(conn);
+}
 
-    auto line = (char *)jsonrpc_arena_malloc(line_len + 1U);
-    if (line == nullptr) {
-      const bool sent =
-          jsonrpc_conn_send_error(conn, nullptr, JSONRPC_ERR_INTERNAL, nullptr);
-      if (!sent && conn->transport.close != nullptr) {
-        conn->transport.close(&conn->transport);
-        close_connection = true;
-      }
-      rpc_buffer_consume(&conn->inbound, consume_len);
-      goto cleanup_message;
+/**
+ * @brief Answer the HTTP upgrade request at the front of the input with 101
+ * Switching Protocols. data is the latest feed; a request split across
+ * feeds is gathered in inbound, within the HTTP header limit.
+ * @return bytes of data the request took, or 0 while it is incomplete and
+ *         once the connection is closed.
+ */
+[[nodiscard]]
+static size_t jsonrpc_conn_ws_handshake(jsonrpc_conn_t *conn,
+                                        const uint8_t *data, size_t len) {
+  const size_t buffered = conn->inbound.len;
+  const uint8_t *request = data;
+  size_t request_len = len;
+  if (buffered != 0U) {
+    const size_t take = len < HTTP_HEADERS_MAX - buffered
+                            ? len
+                            : HTTP_HEADERS_MAX - buffered;
+    if (!rpc_buffer_append(&conn->inbound, data, take, HTTP_HEADERS_MAX)) {
+      jsonrpc_conn_reject_input(conn, 400U, "Invalid WebSocket handshake");
+      return 0U;
+    }
+    request = rpc_buffer_begin(&conn->inbound);
+    request_len = conn->inbound.len;
+  }
+
+  rpc_frame_t frame = {0};
+  const rpc_frame_status_t status = rpc_parse_headers(
+      JSONRPC_FRAMING_WEBSOCKET, request, request_len, &frame);
+  if (status == RPC_FRAME_INCOMPLETE) {
+    if (buffered == 0U &&
+        !rpc_buffer_append(&conn->inbound, data, len, HTTP_HEADERS_MAX)) {
+      jsonrpc_conn_reject_input(conn, 400U, "Invalid WebSocket handshake");
+      return 0U;
+    }
+    jsonrpc_conn_finalize_if_needed(conn);
+    return 0U;
+  }
+  if (status == RPC_FRAME_INVALID || !frame.upgrade ||
+      !frame.connection_upgrade || !frame.ws_version_ok ||
+      frame.ws_key_len != JSONRPC_WS_KEY_LEN || frame.body_len != 0U) {
+    jsonrpc_conn_reject_input(conn,
+                              status == RPC_FRAME_INVALID ? frame.status
+                                                          : 400U,
+                              frame.status == 501U
+                                  ? rpc_frame_error_message(frame.status)
+                                  : "Invalid WebSocket handshake");
+    return 0U;
+  }
+
+  static const char switching[] = "HTTP/1.1 101 Switching Protocols\r\n"
+                                  "Upgrade: websocket\r\n"
+                                  "Connection: Upgrade\r\n"
+                                  "Sec-WebSocket-Accept: ";
+  constexpr size_t prefix_len = sizeof(switching) - 1U;
+  uint8_t response[prefix_len + JSONRPC_WS_ACCEPT_LEN + 4U];
+  memcpy(response, switching, prefix_len);
+  jsonrpc_ws_accept_key(frame.ws_key, response + prefix_len);
+  memcpy(response + prefix_len + JSONRPC_WS_ACCEPT_LEN, "\r\n\r\n", 4U);
+  // Leaving inbound empty also lets a large buffered request go.
+  jsonrpc_conn_drop_input(conn, conn->inbound.len);
+  if (!conn->transport.send_raw(&conn->transport, response,
+                                sizeof(response))) {
+    if (conn->transport.close != nullptr) {
+      conn->transport.close(&conn->transport);
     }
+    jsonrpc_conn_finalize_if_needed(conn);
+    return 0U;
+  }
+  conn->ws.open = true;
+  return frame.header_len - buffered;
+}
 
-    memcpy(line, conn->inbound.data, line_len);
-    line[line_len] = '\0';
-    rpc_buffer_consume(&conn->inbound, consume_len);
+/**
+ * @brief Start receiving the payload of the frame whose header was just
+ * read. Data frames must continue the open message or start one, and the
+ * message must fit max_message_bytes; its buffer is sized up front.
+ * @return false once the connection is closed.
+ */
+[[nodiscard]]
+static bool jsonrpc_conn_ws_begin_frame(jsonrpc_conn_t *conn,
+                                        const jsonrpc_ws_frame_t *frame) {
+  rpc_ws_t *ws = &conn->ws;
+  if ((frame->opcode & 0x8U) == 0U) {
+    if ((frame->opcode == JSONRPC_WS_CONTINUATION) != ws->in_message) {
+      jsonrpc_conn_ws_close(conn, WS_CLOSE_PROTOCOL_ERROR);
+      return false;
+    }
+    if (frame->payload_len > conn->max_message_bytes - conn->inbound.len ||
+        !rpc_buffer_reserve(&conn->inbound,
+                            conn->inbound.len + frame->payload_len)) {
+      jsonrpc_conn_ws_close(conn, WS_CLOSE_TOO_BIG);
+      return false;
+    }
+    ws->in_message = !frame->fin;
+  }
+  ws->in_frame = true;
+  ws->fin = frame->fin;
+  ws->opcode = frame->opcode;
+  memcpy(ws->mask, frame->mask, sizeof(ws->mask));
+  ws->payload_left = frame->payload_len;
+  ws->payload_seen = 0U;
+  return true;
+}
 
-    if (memchr(line, '\0', line_len) != nullptr) {
-      const bool sent =
-          jsonrpc_conn_send_error(conn, nullptr, JSONRPC_ERR_PARSE, nullptr);
-      if (!sent && conn->transport.close != nullptr) {
+/**
+ * @brief Act on a fully received frame: dispatch a finished message, answer
+ * a ping, or echo a close.
+ * @return false once the connection is closed.
+ */
+[[nodiscard]]
+static bool jsonrpc_conn_ws_end_frame(jsonrpc_conn_t *conn) {
+  rpc_ws_t *ws = &conn->ws;
+  ws->in_frame = false;
+  switch (ws->opcode) {
+  case JSONRPC_WS_CLOSE:
+    if (ws->payload_seen == 1U) {
+      jsonrpc_conn_ws_close(conn, WS_CLOSE_PROTOCOL_ERROR);
+    } else {
+      jsonrpc_conn_ws_close(
+          conn, ws->payload_seen == 0U
+                    ? 0U
+                    : (uint16_t)(ws->control[0] << 8U | ws->control[1]));
+    }
+    return false;
+  case JSONRPC_WS_PING: {
+    uint8_t pong[JSONRPC_WS_SEND_HEADER_MAX + JSONRPC_WS_CONTROL_MAX];
+    size_t len =
+        jsonrpc_ws_frame_header(JSONRPC_WS_PONG, ws->payload_seen, pong);
+    memcpy(pong + len, ws->control, ws->payload_seen);
+    len += ws->payload_seen;
+    if (!conn->transport.send_raw(&conn->transport, pong, len)) {
+      if (conn->transport.close != nullptr) {
         conn->transport.close(&conn->transport);
-        close_connection = true;
       }
-      goto cleanup_message;
+      jsonrpc_conn_finalize_if_needed(conn);
+      return false;
     }
+    return true;
+  }
+  case JSONRPC_WS_PONG:
+    return true;
+  default:
+    break;
+  }
+  if (!ws->fin) {
+    return true;
+  }
+  // Empty messages are skipped, like empty frames.
+  if (conn->inbound.len != 0U &&
+      !jsonrpc_conn_dispatch(conn, rpc_buffer_begin(&conn->inbound),
+                             conn->inbound.len, false)) {
+    return false;
+  }
+  // Every message is unmasked into inbound, so its storage is kept for the
+  // next one unless a large message grew it.
+  conn->inbound.len = 0U;
+  rpc_buffer_maybe_shrink(&conn->inbound);
+  return true;
+}
 
-    request = json_parse_string(line);
-    jsonrpc_arena_free(line);
+/**
+ * @brief jsonrpc_conn_feed for WebSocket framing: the upgrade handshake,
+ * then frames. Payloads are unmasked straight from data into inbound, where
+ * the fragments of a message are assembled and the finished message is
+ * dispatched; only a frame header split across feeds is held back.
+ */
+static void jsonrpc_conn_feed_websocket(jsonrpc_conn_t *conn,
+                                        const uint8_t *data, size_t len) {
+  rpc_ws_t *ws = &conn->ws;
+  if (!ws->open) {
+    const size_t used = jsonrpc_conn_ws_handshake(conn, data, len);
+    if (used == 0U) {
+      return;
+    }
+    data += used;
+    len -= used;
+  }
+  while (true) {
+    if (!ws->in_frame) {
+      if (len == 0U) {
+        jsonrpc_conn_finalize_if_needed(conn);
+        return;
+      }
+      const size_t held = ws->header_len;
+      const uint8_t *header = data;
+      size_t header_len = len;
+      if (held != 0U) {
+        const size_t take = len < JSONRPC_WS_HEADER_MAX - held
+                                ? len
+                                : JSONRPC_WS_HEADER_MAX - held;
+        memcpy(ws->header + held, data, take);
+        header = ws->header;
+        header_len = held + take;
+      }
+      jsonrpc_ws_frame_t frame = {0};
+      const jsonrpc_ws_status_t status =
+          jsonrpc_ws_parse_frame(header, header_len, &frame);
+      if (status == JSONRPC_WS_INVALID) {
+        jsonrpc_conn_ws_close(conn, WS_CLOSE_PROTOCOL_ERROR);
+        return;
+      }
+      if (status == JSONRPC_WS_INCOMPLETE) {
+        // Shorter than the longest header, so it fits.
+        if (held == 0U) {
+          memcpy(ws->header, data, len);
+        }
+        ws->header_len = header_len;
+        jsonrpc_conn_finalize_if_needed(conn);
+        return;
+      }
+      ws->header_len = 0U;
+      data += frame.header_len - held;
+      len -= frame.header_len - held;
+      if (!jsonrpc_conn_ws_begin_frame(conn, &frame)) {
+        return;
+      }
+    }
 
-    if (request == nullptr) {
-      const bool sent =
-          jsonrpc_conn_send_error(conn, nullptr, JSONRPC_ERR_PARSE, nullptr);
-      if (!sent && conn->transport.close != nullptr) {
-        conn->transport.close(&conn->transport);
-        close_connection = true;
-        goto cleanup_message;
+    const size_t take = len < ws->payload_left ? len : ws->payload_left;
+    if (take != 0U) {
+      uint8_t *out = (ws->opcode & 0x8U) != 0U
+                         ? ws->control + ws->payload_seen
+                         : rpc_buffer_begin(&conn->inbound) + conn->inbound.len;
+      jsonrpc_ws_unmask(out, data, take, ws->mask, ws->payload_seen);
+      if ((ws->opcode & 0x8U) == 0U) {
+        conn->inbound.len += take;
       }
-      goto cleanup_message;
+      ws->payload_seen += take;
+      ws->payload_left -= take;
+      data += take;
+      len -= take;
+    }
+    if (ws->payload_left != 0U) {
+      jsonrpc_conn_finalize_if_needed(conn);
+      return;
+    }
+    if (!jsonrpc_conn_ws_end_frame(conn)) {
+      return;
     }
+  }
+}
 
-    response = jsonrpc_process_value(conn, request);
-    if (response != nullptr) {
-      const bool sent = jsonrpc_send_value(conn, response);
-      if (!sent && conn->transport.close != nullptr) {
-        conn->transport.close(&conn->transport);
-        close_connection = true;
-        goto cleanup_message;
+void jsonrpc_conn_feed(jsonrpc_conn_t *conn, const uint8_t *data, size_t len) {
+  if (conn == nullptr || data == nullptr || len == 0U) {
+    return;
+  }
+  if (conn->closed) {
+    jsonrpc_conn_finalize_if_needed(conn);
+    return;
+  }
+
+  jsonrpc_init_parson_allocator();
+  if (conn->framing == JSONRPC_FRAMING_WEBSOCKET) {
+    jsonrpc_conn_feed_websocket(conn, data, len);
+    return;
+  }
+  if (conn->framing != JSONRPC_FRAMING_NEWLINE) {
+    jsonrpc_conn_feed_framed(conn, data, len);
+    return;
+  }
+
+  // With nothing buffered, frames are parsed straight out of data and only an
+  // unterminated tail is copied into inbound, so a caller can read into a
+  // buffer shared by many connections.
+  const bool borrowed = conn->inbound.len == 0U;
+  const uint8_t *view = data;
+  size_t view_len = len;
+
+  if (!borrowed &&
+      !rpc_buffer_append(&conn->inbound, data, len, MAX_BUFFER_BYTES)) {
+    jsonrpc_conn_reject_input(conn, 413U, "Request too large");
+    return;
+  }
+
+  while (true) {
+    const uint8_t *pending = borrowed ? view : rpc_buffer_begin(&conn->inbound);
+    const size_t pending_len = borrowed ? view_len : conn->inbound.len;
+    const size_t scanned = conn->inbound_scanned;
+    const size_t newline_index =
+        scanned + rpc_scan_frame(pending + scanned, pending_len - scanned,
+                                 &conn->inbound_saw_nul);
+    if (newline_index == pending_len) {
+      conn->inbound_scanned = newline_index;
+      if (borrowed && pending_len != 0U &&
+          !rpc_buffer_append(&conn->inbound, pending, pending_len,
+                             MAX_BUFFER_BYTES)) {
+        conn->inbound_scanned = 0U;
+        conn->inbound_saw_nul = false;
+        (void)jsonrpc_conn_send_error(conn, nullptr,
+                                      JSONRPC_ERR_INVALID_REQUEST,
+                                      "Request too large");
+        if (conn->transport.close != nullptr) {
+          conn->transport.close(&conn->transport);
+        }
       }
+      jsonrpc_conn_finalize_if_needed(conn);
+      return;
     }
 
-  cleanup_message:
-    if (response != nullptr) {
-      json_value_free(response);
+    // Every path below consumes this line or closes the connection.
+    const bool line_has_nul = conn->inbound_saw_nul;
+    conn->inbound_scanned = 0U;
+    conn->inbound_saw_nul = false;
+    size_t line_len = newline_index;
+    const size_t consume_len = line_len + 1U;
+
+    if (line_len > 0U && pending[line_len - 1U] == '\r') {
+      line_len -= 1U;
     }
-    if (request != nullptr) {
-      json_value_free(request);
+
+    if (line_len == 0U) {
+      jsonrpc_conn_consume_input(conn, borrowed, &view, &view_len, consume_len);
+      continue;
     }
-    jsonrpc_arena_scope_end(conn->arena, scope);
-    if (close_connection || conn->closed) {
-      jsonrpc_conn_finalize_if_needed(conn);
+
+    if (line_len > MAX_MESSAGE_BYTES) {
+      jsonrpc_conn_reject_input(conn, 413U, "Request too large");
       return;
     }
+
+    if (!jsonrpc_conn_dispatch(conn, pending, line_len, line_has_nul)) {
+      return;
+    }
+    jsonrpc_conn_consume_input(conn, borrowed, &view, &view_len, consume_len);
   }
 }
 
@@ -886,6 +2242,216 @@ void jsonrpc_conn_feed(jsonrpc_conn_t *conn, const uint8_t *data, size_t len) {
   return sent;
 }
 
+[[nodiscard]] bool jsonrpc_conn_send_notification(jsonrpc_conn_t *conn,
+                                                  const char *method,
+                                                  JSON_Value *params) {
+  if (conn == nullptr || method == nullptr || conn->closed ||
+      conn->framing == JSONRPC_FRAMING_HTTP ||
+      (conn->framing == JSONRPC_FRAMING_WEBSOCKET && !conn->ws.open) ||
+      !jsonrpc_params_is_valid(params)) {
+    if (params != nullptr) {
+      json_value_free(params);
+    }
+    if (conn != nullptr) {
+      jsonrpc_conn_finalize_if_needed(conn);
+    }
+    return false;
+  }
+
+  jsonrpc_init_parson_allocator();
+  jsonrpc_conn_ensure_arena(conn);
+  const jsonrpc_arena_scope_t scope = jsonrpc_arena_scope_begin(conn->arena);
+
+  auto notification = json_value_init_object();
+  auto object = json_value_get_object(notification);
+  bool built = object != nullptr &&
+               json_object_set_string(object, "jsonrpc", "2.0") ==
+                   JSONSuccess &&
+               json_object_set_string(object, "method", method) == JSONSuccess;
+  if (params != nullptr &&
+      (!built ||
+       json_object_set_value(object, "params", params) != JSONSuccess)) {
+    json_value_free(params);
+    built = false;
+  }
+
+  const bool sent = built && jsonrpc_send_value(conn, notification);
+  if (notification != nullptr) {
+    json_value_free(notification);
+  }
+  jsonrpc_arena_scope_end(conn->arena, scope);
+  jsonrpc_conn_finalize_if_needed(conn);
+  return sent;
+}
+
+jsonrpc_request_handle_t *jsonrpc_conn_defer(jsonrpc_conn_t *conn,
+                                             bool keep_params) {
+  if (conn == nullptr || conn->closed || conn->current_id == nullptr ||
+      conn->current_deferred) {
+    return nullptr;
+  }
+
+  auto handle = (jsonrpc_request_handle_t *)calloc(
+      1U, sizeof(jsonrpc_request_handle_t));
+  if (handle == nullptr) {
+    return nullptr;
+  }
+
+  Arena *prev = jsonrpc_heap_scope_begin();
+  handle->id = jsonrpc_copy_id(conn->current_id);
+  bool ok = handle->id != nullptr;
+  if (ok && keep_params && conn->current_params != nullptr) {
+    handle->params = json_value_deep_copy(conn->current_params);
+    ok = handle->params != nullptr;
+  }
+  if (ok && conn->in_batch && conn->current_batch == nullptr) {
+    auto batch = (jsonrpc_batch_t *)calloc(1U, sizeof(jsonrpc_batch_t));
+    if (batch != nullptr) {
+      batch->conn = conn;
+      batch->responses = json_value_init_array();
+      batch->open = true;
+      if (batch->responses == nullptr) {
+        free(batch);
+        batch = nullptr;
+      }
+    }
+    conn->current_batch = batch;
+    ok = batch != nullptr;
+  }
+  jsonrpc_heap_scope_end(prev);
+
+  if (!ok) {
+    jsonrpc_handle_release(handle);
+    return nullptr;
+  }
+
+  if (conn->in_batch) {
+    handle->batch = conn->current_batch;
+    handle->batch->pending += 1U;
+  }
+  handle->conn = conn;
+  handle->next = conn->handles;
+  if (conn->handles != nullptr) {
+    conn->handles->prev = handle;
+  }
+  conn->handles = handle;
+  conn->current_deferred = true;
+  return handle;
+}
+
+const JSON_Value *
+jsonrpc_request_handle_id(const jsonrpc_request_handle_t *handle) {
+  return handle == nullptr ? nullptr : handle->id;
+}
+
+const JSON_Value *
+jsonrpc_request_handle_params(const jsonrpc_request_handle_t *handle) {
+  return handle == nullptr ? nullptr : handle->params;
+}
+
+jsonrpc_conn_t *
+jsonrpc_request_handle_conn(const jsonrpc_request_handle_t *handle) {
+  return handle == nullptr ? nullptr : handle->conn;
+}
+
+// Builds the response for handle (taking ownership of result when non-null),
+// routes it to the batch or the transport, and releases the handle.
+[[nodiscard]]
+static bool jsonrpc_request_complete(jsonrpc_request_handle_t *handle,
+                                     JSON_Value *result, int32_t code,
+                                     const char *message) {
+  jsonrpc_conn_t *conn = handle->conn;
+  if (conn == nullptr || conn->closed) {
+    if (result != nullptr) {
+      json_value_free(result);
+    }
+    jsonrpc_handle_release(handle);
+    return false;
+  }
+
+  jsonrpc_init_parson_allocator();
+  jsonrpc_conn_ensure_arena(conn);
+  const jsonrpc_arena_scope_t scope = jsonrpc_arena_scope_begin(conn->arena);
+  JSON_Value *response = result != nullptr
+                             ? jsonrpc_build_result(handle->id, result)
+                             : jsonrpc_build_error(handle->id, code, message);
+  bool sent = false;
+  if (handle->batch != nullptr) {
+    sent = jsonrpc_batch_add(handle->batch, response);
+  } else if (response != nullptr) {
+    sent = jsonrpc_send_value(conn, response);
+  }
+  if (response != nullptr) {
+    json_value_free(response);
+  }
+  // Releasing the last deferred member of a batch sends the batch.
+  jsonrpc_handle_release(handle);
+  jsonrpc_arena_scope_end(conn->arena, scope);
+  // With the HTTP request answered, carry on with those held behind it
+  // (inside a handler, the dispatch that called it does that).
+  if (conn->framing == JSONRPC_FRAMING_HTTP && conn->handles == nullptr &&
+      conn->callback_depth == 0U && !conn->closed &&
+      jsonrpc_conn_http_finish(conn)) {
+    jsonrpc_conn_feed_framed(conn, nullptr, 0U);
+  }
+  jsonrpc_conn_finalize_if_needed(conn);
+  return sent;
+}
+
+bool jsonrpc_request_complete_result(jsonrpc_request_handle_t *handle,
+                                     JSON_Value *result) {
+  if (handle == nullptr || result == nullptr) {
+    if (result != nullptr) {
+      json_value_free(result);
+    }
+    if (handle != nullptr) {
+      return jsonrpc_request_complete(handle, nullptr, JSONRPC_ERR_INTERNAL,
+                                      "Handler returned no result");
+    }
+    return false;
+  }
+  return jsonrpc_request_complete(handle, result, 0, nullptr);
+}
+
+bool jsonrpc_request_complete_response(jsonrpc_request_handle_t *handle,
+                                       bool handled,
+                                       jsonrpc_response_t *response) {
+  if (handle == nullptr || response == nullptr) {
+    if (response != nullptr && response->result != nullptr) {
+      json_value_free(response->result);
+      response->result = nullptr;
+    }
+    return handle != nullptr &&
+           jsonrpc_request_complete(handle, nullptr, JSONRPC_ERR_INTERNAL,
+                                    nullptr);
+  }
+
+  JSON_Value *result = response->result;
+  response->result = nullptr;
+  if (!handled || response->error_code != 0) {
+    if (result != nullptr) {
+      json_value_free(result);
+    }
+    return jsonrpc_request_complete(
+        handle, nullptr,
+        handled ? response->error_code : JSONRPC_ERR_METHOD_NOT_FOUND,
+        handled ? response->error_message : nullptr);
+  }
+  if (result == nullptr) {
+    return jsonrpc_request_complete(handle, nullptr, JSONRPC_ERR_INTERNAL,
+                                    "Handler returned no result");
+  }
+  return jsonrpc_request_complete(handle, result, 0, nullptr);
+}
+
+bool jsonrpc_request_complete_error(jsonrpc_request_handle_t *handle,
+                                    int32_t code, const char *message) {
+  if (handle == nullptr) {
+    return false;
+  }
+  return jsonrpc_request_complete(handle, nullptr, code, message);
+}
+
 [[nodiscard]] void *jsonrpc_conn_get_context(jsonrpc_conn_t *conn) {
   if (conn == nullptr) {
     return nullptr;
@@ -896,3 +2462,109 @@ void jsonrpc_conn_feed(jsonrpc_conn_t *conn, const uint8_t *data, size_t len) {
   }
   return conn->user_context;
 }
+
+bool jsonrpc_conn_set_arena(jsonrpc_conn_t *conn, Arena *arena) {
+  if (conn == nullptr || arena == nullptr || conn->arena != nullptr) {
+    return false;
+  }
+  arena_clear(arena);
+  conn->arena = arena;
+  return true;
+}
+
+bool jsonrpc_conn_set_framing(jsonrpc_conn_t *conn, jsonrpc_framing_t framing,
+                              size_t max_message_bytes) {
+  if (conn == nullptr || conn->closed || conn->callback_depth != 0U ||
+      conn->inbound.len != 0U || framing < JSONRPC_FRAMING_NEWLINE ||
+      framing > JSONRPC_FRAMING_WEBSOCKET ||
+      (framing == JSONRPC_FRAMING_NEWLINE &&
+       conn->encoding == JSONRPC_ENCODING_MSGPACK)) {
+    return false;
+  }
+  conn->framing = framing;
+  if (framing == JSONRPC_FRAMING_NEWLINE) {
+    conn->encoding_open = false;
+  }
+  conn->max_message_bytes =
+      max_message_bytes == 0U ? MAX_MESSAGE_BYTES : max_message_bytes;
+  if (conn->max_message_bytes > SIZE_MAX / 2U) {
+    conn->max_message_bytes = SIZE_MAX / 2U;
+  }
+  return true;
+}
+
+void jsonrpc_conn_set_shared_reads(jsonrpc_conn_t *conn, bool shared) {
+  if (conn != nullptr) {
+    conn->shared_reads = shared;
+  }
+}
+
+bool jsonrpc_conn_allow_msgpack(jsonrpc_conn_t *conn) {
+  if (conn == nullptr || conn->closed || conn->inbound.len != 0U ||
+      conn->framing == JSONRPC_FRAMING_NEWLINE) {
+    return false;
+  }
+  conn->encoding_open = conn->encoding == JSONRPC_ENCODING_JSON;
+  return true;
+}
+
+jsonrpc_encoding_t jsonrpc_conn_get_encoding(const jsonrpc_conn_t *conn) {
+  return conn == nullptr ? JSONRPC_ENCODING_JSON : conn->encoding;
+}
+
+size_t jsonrpc_conn_memory_usage(const jsonrpc_conn_t *conn) {
+  if (conn == nullptr) {
+    return 0U;
+  }
+  size_t bytes = sizeof(*conn) + conn->inbound.cap + conn->outbound.cap;
+  if (conn->arena != nullptr) {
+    bytes += sizeof(Arena) + conn->arena->size;
+    for (const Arena_Block *block = conn->arena->retired; block != nullptr;
+         block = block->next) {
+      bytes += block->size;
+    }
+  }
+  return bytes;
+}
+
+size_t jsonrpc_conn_pending_input(const jsonrpc_conn_t *conn) {
+  return conn == nullptr ? 0U : conn->inbound.len;
+}
+
+uint64_t jsonrpc_conn_messages_completed(const jsonrpc_conn_t *conn) {
+  return conn == nullptr ? 0U : conn->messages_completed;
+}
+
+bool jsonrpc_conn_has_deferred(const jsonrpc_conn_t *conn) {
+  return conn != nullptr && conn->handles != nullptr;
+}
+
+Arena *jsonrpc_conn_take_arena(jsonrpc_conn_t *conn) {
+  if (conn == nullptr || conn->callback_depth != 0U ||
+      json_get_allocation_context() == conn->arena) {
+    return nullptr;
+  }
+  Arena *arena = conn->arena;
+  conn->arena = nullptr;
+  return arena;
+}
+
+void jsonrpc_conn_trim(jsonrpc_conn_t *conn) {
+  if (conn == nullptr || conn->callback_depth != 0U) {
+    return;
+  }
+  if (conn->inbound.len == 0U) {
+    rpc_buffer_free(&conn->inbound);
+  }
+  if (conn->outbound.len == 0U) {
+    rpc_buffer_free(&conn->outbound);
+  }
+  // Outside a callback the arena has been cleared down to its largest block;
+  // one grown past the initial size is dropped and recreated on demand.
+  Arena *arena = conn->arena;
+  if (arena != nullptr && arena->size > JSONRPC_ARENA_BYTES &&
+      arena->index == 0U && json_get_allocation_context() != arena) {
+    arena_destroy(arena);
+    conn->arena = nullptr;
+  }
+}
@@ -10,6 +10,7 @@
 #include <uv.h>
 
 #include "jsonrpc/jsonrpc.h"
+#include "jsonrpc/router.h"
 #include "jsonrpc/server.h"
 
 constexpr int32_t JSONRPC_ERR_INVALID_PARAMS = -32'602;
@@ -31,7 +32,38 @@ void my_on_open([[maybe_unused]] jsonrpc_conn_t *conn) {
   printf("[Server] New JSON-RPC connection opened.\n");
 }
 
-static bool handle_add(const JSON_Value *params, jsonrpc_response_t *response) {
+static bool handle_ping([[maybe_unused]] jsonrpc_conn_t *conn,
+                        [[maybe_unused]] const JSON_Value *params,
+                        jsonrpc_response_t *response,
+                        [[maybe_unused]] void *user_data) {
+  response->result = json_value_init_string("pong");
+  if (response->result == nullptr) {
+    response->error_code = JSONRPC_ERR_INTERNAL;
+    response->error_message = "Out of memory";
+  }
+  return true;
+}
+
+static bool handle_echo([[maybe_unused]] jsonrpc_conn_t *conn,
+                        const JSON_Value *params, jsonrpc_response_t *response,
+                        [[maybe_unused]] void *user_data) {
+  if (params == nullptr) {
+    response->error_code = JSONRPC_ERR_INVALID_PARAMS;
+    response->error_message = "Missing params";
+    return true;
+  }
+
+  response->result = json_value_deep_copy(params);
+  if (response->result == nullptr) {
+    response->error_code = JSONRPC_ERR_INTERNAL;
+    response->error_message = "Out of memory";
+  }
+  return true;
+}
+
+static bool handle_add([[maybe_unused]] jsonrpc_conn_t *conn,
+                       const JSON_Value *params, jsonrpc_response_t *response,
+                       [[maybe_unused]] void *user_data) {
   if (params == nullptr || json_value_get_type(params) != JSONArray) {
     response->error_code = JSONRPC_ERR_INVALID_PARAMS;
     response->error_message = "Expected array params";
@@ -59,37 +91,68 @@ static bool handle_add(const JSON_Value *params, jsonrpc_response_t *response) {
   return true;
 }
 
-bool my_on_request([[maybe_unused]] jsonrpc_conn_t *conn, const char *method,
-                   const JSON_Value *params, jsonrpc_response_t *response) {
-  if (strcmp(method, "ping") == 0) {
-    response->result = json_value_init_string("pong");
-    if (response->result == nullptr) {
-      response->error_code = JSONRPC_ERR_INTERNAL;
-      response->error_message = "Out of memory";
-    }
-    return true;
+static bool handle_stats([[maybe_unused]] jsonrpc_conn_t *conn,
+                         [[maybe_unused]] const JSON_Value *params,
+                         jsonrpc_response_t *response,
+                         [[maybe_unused]] void *user_data) {
+  server_stats_t stats;
+  server_get_stats(&stats);
+  const struct {
+    const char *name;
+    double value;
+  } fields[] = {
+      {"connections", (double)stats.connections},
+      {"memory_used", (double)stats.memory_used},
+      {"memory_budget_bytes", (double)stats.memory_budget_bytes},
+      {"memory_paused", (double)stats.memory_paused},
+      {"write_queue_high_bytes", (double)stats.write_queue_high_bytes},
+      {"write_queue_low_bytes", (double)stats.write_queue_low_bytes},
+      {"write_paused", (double)stats.write_paused},
+      {"write_pauses", (double)stats.write_pauses},
+      {"idle_timeouts", (double)stats.idle_timeouts},
+      {"message_timeouts", (double)stats.message_timeouts},
+      {"max_connections", (double)stats.max_connections},
+      {"connections_shed", (double)stats.connections_shed},
+      {"accept_pauses", (double)stats.accept_pauses},
+      {"uring_enters", (double)stats.uring_enters},
+      {"uring_sqes", (double)stats.uring_sqes},
+  };
+  auto result = json_value_init_object();
+  auto object = json_value_get_object(result);
+  bool filled = object != nullptr;
+  for (size_t i = 0U; filled && i < sizeof(fields) / sizeof(fields[0]); ++i) {
+    filled = json_object_set_number(object, fields[i].name, fields[i].value) ==
+             JSONSuccess;
   }
-
-  if (strcmp(method, "echo") == 0) {
-    if (params == nullptr) {
-      response->error_code = JSONRPC_ERR_INVALID_PARAMS;
-      response->error_message = "Missing params";
-      return true;
-    }
-
-    response->result = json_value_deep_copy(params);
-    if (response->result == nullptr) {
-      response->error_code = JSONRPC_ERR_INTERNAL;
-      response->error_message = "Out of memory";
-    }
+  if (!filled) {
+    json_value_free(result);
+    response->error_code = JSONRPC_ERR_INTERNAL;
+    response->error_message = "Out of memory";
     return true;
   }
+  response->result = result;
+  return true;
+}
 
-  if (strcmp(method, "add") == 0) {
-    return handle_add(params, response);
+[[nodiscard]] static jsonrpc_router_t *build_router() {
+  auto router = jsonrpc_router_new();
+  if (router == nullptr) {
+    return nullptr;
   }
-
-  return false;
+  const bool registered =
+      jsonrpc_router_add(router, "ping", handle_ping, JSONRPC_METHOD_DEFAULT,
+                         nullptr) &&
+      jsonrpc_router_add(router, "echo", handle_echo, JSONRPC_METHOD_DEFAULT,
+                         nullptr) &&
+      jsonrpc_router_add(router, "add", handle_add, JSONRPC_METHOD_DEFAULT,
+                         nullptr) &&
+      jsonrpc_router_add(router, "stats", handle_stats,
+                         JSONRPC_METHOD_DEFAULT, nullptr);
+  if (!registered) {
+    jsonrpc_router_free(router);
+    return nullptr;
+  }
+  return router;
 }
 
 void my_on_notification([[maybe_unused]] jsonrpc_conn_t *conn,
@@ -113,30 +176,207 @@ static void on_signal(uv_signal_t *handle, int signum [[maybe_unused]]) {
   server_request_shutdown();
 }
 
+[[nodiscard]] static bool parse_u32(const char *text, uint32_t max,
+                                    uint32_t *out) {
+  char *end = nullptr;
+  errno = 0;
+  const auto parsed = strtol(text, &end, 10);
+  const bool valid = (errno == 0) && (end != text) && (*end == '\0');
+  if (!valid || parsed <= 0 || (unsigned long)parsed > max) {
+    return false;
+  }
+  *out = (uint32_t)parsed;
+  return true;
+}
+
+[[nodiscard]] static bool parse_framing(const char *text,
+                                        jsonrpc_framing_t *out) {
+  static const struct {
+    const char *name;
+    jsonrpc_framing_t framing;
+  } framings[] = {
+      {"newline", JSONRPC_FRAMING_NEWLINE},
+      {"length", JSONRPC_FRAMING_LENGTH_PREFIX},
+      {"content-length", JSONRPC_FRAMING_CONTENT_LENGTH},
+      {"http", JSONRPC_FRAMING_HTTP},
+      {"websocket", JSONRPC_FRAMING_WEBSOCKET},
+  };
+  for (size_t i = 0U; i < sizeof(framings) / sizeof(framings[0]); ++i) {
+    if (strcmp(text, framings[i].name) == 0) {
+      *out = framings[i].framing;
+      return true;
+    }
+  }
+  return false;
+}
+
 int main(int argc, char **argv) {
-  constexpr int32_t DEFAULT_PORT = 8'080;
-  auto port = DEFAULT_PORT;
-  if (argc > 1) {
-    char *end = nullptr;
-    errno = 0;
-    const auto parsed = strtol(argv[1], &end, 10);
-    const bool valid = (errno == 0) && (end != argv[1]) && (*end == '\0');
-    if (valid && parsed > 0 && parsed <= UINT16_MAX) {
-      port = (int32_t)parsed;
+  constexpr uint32_t MAX_WORKERS = 256U;
+  constexpr uint32_t MAX_MEMORY_BUDGET_MB = 1'048'576U;
+  constexpr uint32_t MAX_WRITE_QUEUE_KB = 4'194'304U;
+  constexpr uint32_t MAX_TIMEOUT_MS = 86'400'000U;
+  constexpr uint32_t MAX_CONNECTIONS = 10'000'000U;
+  constexpr uint32_t MAX_MESSAGE_KB = 1'048'576U;
+  server_config_t config;
+  server_config_init(&config);
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--workers") == 0) {
+      if (i + 1 >= argc || !parse_u32(argv[i + 1], MAX_WORKERS,
+                                      &config.workers)) {
+        fprintf(stderr, "--workers expects a value in 1..%" PRIu32 "\n",
+                MAX_WORKERS);
+        return 2;
+      }
+      ++i;
+      continue;
+    }
+    if (strcmp(argv[i], "--memory-budget-mb") == 0) {
+      uint32_t megabytes = 0U;
+      if (i + 1 >= argc || !parse_u32(argv[i + 1], MAX_MEMORY_BUDGET_MB,
+                                      &megabytes)) {
+        fprintf(stderr,
+                "--memory-budget-mb expects a value in 1..%" PRIu32 "\n",
+                MAX_MEMORY_BUDGET_MB);
+        return 2;
+      }
+      config.memory_budget_bytes = (size_t)megabytes * 1'048'576U;
+      ++i;
+      continue;
+    }
+    if (strcmp(argv[i], "--write-queue-kb") == 0) {
+      uint32_t kilobytes = 0U;
+      if (i + 1 >= argc ||
+          !parse_u32(argv[i + 1], MAX_WRITE_QUEUE_KB, &kilobytes)) {
+        fprintf(stderr, "--write-queue-kb expects a value in 1..%" PRIu32 "\n",
+                MAX_WRITE_QUEUE_KB);
+        return 2;
+      }
+      config.write_queue_high_bytes = (size_t)kilobytes * 1'024U;
+      config.write_queue_low_bytes = config.write_queue_high_bytes / 4U;
+      ++i;
+      continue;
+    }
+    if (strcmp(argv[i], "--idle-timeout-ms") == 0 ||
+        strcmp(argv[i], "--message-timeout-ms") == 0) {
+      uint32_t *timeout = strcmp(argv[i], "--idle-timeout-ms") == 0
+                              ? &config.idle_timeout_ms
+                              : &config.message_timeout_ms;
+      if (i + 1 >= argc || !parse_u32(argv[i + 1], MAX_TIMEOUT_MS, timeout)) {
+        fprintf(stderr, "%s expects a value in 1..%" PRIu32 "\n", argv[i],
+                MAX_TIMEOUT_MS);
+        return 2;
+      }
+      ++i;
+      continue;
+    }
+    if (strcmp(argv[i], "--max-connections") == 0) {
+      if (i + 1 >= argc || !parse_u32(argv[i + 1], MAX_CONNECTIONS,
+                                      &config.max_connections)) {
+        fprintf(stderr, "--max-connections expects a value in 1..%" PRIu32 "\n",
+                MAX_CONNECTIONS);
+        return 2;
+      }
+      ++i;
+      continue;
+    }
+    if (strcmp(argv[i], "--shed") == 0) {
+      if (i + 1 < argc && strcmp(argv[i + 1], "reject") == 0) {
+        config.shed_mode = SERVER_SHED_REJECT;
+      } else if (i + 1 < argc && strcmp(argv[i + 1], "pause") == 0) {
+        config.shed_mode = SERVER_SHED_PAUSE;
+      } else {
+        fprintf(stderr, "--shed expects reject or pause\n");
+        return 2;
+      }
+      ++i;
+      continue;
+    }
+    if (strcmp(argv[i], "--unix") == 0) {
+      if (i + 1 >= argc || argv[i + 1][0] == '\0') {
+        fprintf(stderr, "--unix expects a socket path\n");
+        return 2;
+      }
+      config.unix_path = argv[++i];
+      continue;
+    }
+    if (strcmp(argv[i], "--no-tcp") == 0) {
+      config.listen_tcp = false;
+      continue;
+    }
+    if (strcmp(argv[i], "--framing") == 0 ||
+        strcmp(argv[i], "--unix-framing") == 0) {
+      jsonrpc_framing_t *framing = strcmp(argv[i], "--framing") == 0
+                                       ? &config.tcp_framing
+                                       : &config.unix_framing;
+      if (i + 1 >= argc || !parse_framing(argv[i + 1], framing)) {
+        fprintf(stderr,
+                "%s expects newline, length, content-length, http or "
+                "websocket\n",
+                argv[i]);
+        return 2;
+      }
+      ++i;
+      continue;
+    }
+    if (strcmp(argv[i], "--max-message-kb") == 0) {
+      uint32_t kilobytes = 0U;
+      if (i + 1 >= argc ||
+          !parse_u32(argv[i + 1], MAX_MESSAGE_KB, &kilobytes)) {
+        fprintf(stderr, "--max-message-kb expects a value in 1..%" PRIu32 "\n",
+                MAX_MESSAGE_KB);
+        return 2;
+      }
+      config.max_framed_message_bytes = (size_t)kilobytes * 1'024U;
+      ++i;
+      continue;
+    }
+    if (strcmp(argv[i], "--msgpack") == 0) {
+      config.msgpack = true;
+      continue;
+    }
+    if (strcmp(argv[i], "--io-uring") == 0) {
+      config.backend = SERVER_BACKEND_IO_URING;
+      continue;
+    }
+    if (strcmp(argv[i], "--shared-read-buffer") == 0) {
+      config.shared_read_buffer = true;
+      continue;
+    }
+
+    uint32_t port = 0U;
+    if (parse_u32(argv[i], UINT16_MAX, &port)) {
+      config.port = (int32_t)port;
     } else {
       fprintf(stderr,
               "Invalid port '%s' (expected 1..65535), falling back to %" PRId32
               "\n",
-              argv[1], port);
+              argv[i], config.port);
     }
   }
 
-  // Define application callbacks
+  auto router = build_router();
+  if (router == nullptr) {
+    fprintf(stderr, "Failed to build the method table\n");
+    return 1;
+  }
+
+  // Define application callbacks; requests are dispatched through the router
   jsonrpc_callbacks_t callbacks = {.on_open = my_on_open,
                                    .on_close = my_on_close,
-                                   .on_request = my_on_request,
-                                   .on_notification = my_on_notification};
-  printf("Starting JSON-RPC Server on port %" PRId32 "...\n", port);
+                                   .on_request = nullptr,
+                                   .on_notification = my_on_notification,
+                                   .router = router};
+  printf("Starting JSON-RPC Server on port %" PRId32 " (%" PRIu32
+         " worker%s)...\n",
+         config.port, config.workers, config.workers == 1U ? "" : "s");
+  if (config.unix_path != nullptr) {
+    printf("Unix socket: %s%s\n", config.unix_path,
+           config.listen_tcp ? "" : " (TCP disabled)");
+  }
+  if (config.backend == SERVER_BACKEND_IO_URING) {
+    printf("I/O backend: io_uring\n");
+  }
   printf("libuv fs runtime: %s\n", libuv_fs_runtime());
 
   auto loop = uv_default_loop();
@@ -150,7 +390,8 @@ int main(int argc, char **argv) {
     (void)uv_signal_start(&sigterm_handle, on_signal, SIGTERM);
   }
 
-  start_jsonrpc_server(port, callbacks);
+  start_jsonrpc_server_with_config(&config, callbacks);
 
+  jsonrpc_router_free(router);
   return 0;
 }
@@ -0,0 +1,406 @@
+#include <float.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "jsonrpc/msgpack.h"
+
+// Same limit the JSON parser applies.
+constexpr size_t MSGPACK_MAX_NESTING = 2'048U;
+
+typedef struct {
+  const uint8_t *data;
+  size_t len;
+  size_t pos;
+} msgpack_reader_t;
+
+[[nodiscard]]
+static const uint8_t *msgpack_take(msgpack_reader_t *reader, size_t count) {
+  if (count > reader->len - reader->pos) {
+    return nullptr;
+  }
+  const uint8_t *bytes = reader->data + reader->pos;
+  reader->pos += count;
+  return bytes;
+}
+
+// Read a big-endian unsigned integer of width bytes (1, 2, 4 or 8).
+[[nodiscard]]
+static bool msgpack_take_uint(msgpack_reader_t *reader, size_t width,
+                              uint64_t *out) {
+  const uint8_t *bytes = msgpack_take(reader, width);
+  if (bytes == nullptr) {
+    return false;
+  }
+  uint64_t value = 0U;
+  for (size_t i = 0U; i < width; ++i) {
+    value = value << 8U | bytes[i];
+  }
+  *out = value;
+  return true;
+}
+
+/**
+ * @brief Length of the str, array or map whose tag was just read, from the
+ * tag itself for the fix forms or from the width-byte field that follows.
+ * A count must not exceed the bytes left, since every item takes at least one.
+ */
+[[nodiscard]]
+static bool msgpack_take_length(msgpack_reader_t *reader, size_t width,
+                                size_t fixed, size_t *out) {
+  uint64_t length = fixed;
+  if (width != 0U && !msgpack_take_uint(reader, width, &length)) {
+    return false;
+  }
+  if (length > reader->len - reader->pos) {
+    return false;
+  }
+  *out = (size_t)length;
+  return true;
+}
+
+static JSON_Value *msgpack_decode_value(msgpack_reader_t *reader,
+                                        size_t nesting);
+
+// Read the string at the reader (the key of a map entry). Its bytes stay in
+// the input; *out_len is its length.
+[[nodiscard]]
+static const uint8_t *msgpack_take_string(msgpack_reader_t *reader,
+                                          size_t *out_len) {
+  const uint8_t *tag = msgpack_take(reader, 1U);
+  if (tag == nullptr) {
+    return nullptr;
+  }
+  size_t width = 0U;
+  if (*tag >= 0xA0U && *tag <= 0xBFU) {
+    width = 0U;
+  } else if (*tag >= 0xD9U && *tag <= 0xDBU) {
+    width = (size_t)1U << (*tag - 0xD9U);
+  } else {
+    return nullptr;
+  }
+  if (!msgpack_take_length(reader, width, *tag & 0x1FU, out_len)) {
+    return nullptr;
+  }
+  return msgpack_take(reader, *out_len);
+}
+
+[[nodiscard]]
+static JSON_Value *msgpack_decode_array(msgpack_reader_t *reader, size_t count,
+                                        size_t nesting) {
+  JSON_Value *value = json_value_init_array();
+  JSON_Array *array = json_value_get_array(value);
+  for (size_t i = 0U; i < count && value != nullptr; ++i) {
+    JSON_Value *item = msgpack_decode_value(reader, nesting + 1U);
+    if (item == nullptr ||
+        json_array_append_value(array, item) != JSONSuccess) {
+      json_value_free(item);
+      json_value_free(value);
+      value = nullptr;
+    }
+  }
+  return value;
+}
+
+[[nodiscard]]
+static JSON_Value *msgpack_decode_map(msgpack_reader_t *reader, size_t count,
+                                      size_t nesting) {
+  JSON_Value *value = json_value_init_object();
+  JSON_Object *object = json_value_get_object(value);
+  for (size_t i = 0U; i < count && value != nullptr; ++i) {
+    // Object names are NUL-terminated, so the key is copied into a string
+    // value first; that also validates it as UTF-8.
+    size_t key_len = 0U;
+    const uint8_t *key_bytes = msgpack_take_string(reader, &key_len);
+    JSON_Value *key =
+        key_bytes == nullptr || memchr(key_bytes, '\0', key_len) != nullptr
+            ? nullptr
+            : json_value_init_string_with_len((const char *)key_bytes,
+                                              key_len);
+    const char *name = json_value_get_string(key);
+    JSON_Value *item = name == nullptr || json_object_has_value(object, name)
+                           ? nullptr
+                           : msgpack_decode_value(reader, nesting + 1U);
+    if (item == nullptr ||
+        json_object_set_value(object, name, item) != JSONSuccess) {
+      json_value_free(item);
+      json_value_free(value);
+      value = nullptr;
+    }
+    json_value_free(key);
+  }
+  return value;
+}
+
+static JSON_Value *msgpack_decode_value(msgpack_reader_t *reader,
+                                        size_t nesting) {
+  const uint8_t *tag_byte = msgpack_take(reader, 1U);
+  if (tag_byte == nullptr || nesting > MSGPACK_MAX_NESTING) {
+    return nullptr;
+  }
+  const uint8_t tag = *tag_byte;
+  if (tag <= 0x7FU) {
+    return json_value_init_number((double)tag);
+  }
+  if (tag >= 0xE0U) {
+    return json_value_init_number((double)(int8_t)tag);
+  }
+
+  size_t length = 0U;
+  uint64_t bits = 0U;
+  switch (tag) {
+  case 0xC0U:
+    return json_value_init_null();
+  case 0xC2U:
+  case 0xC3U:
+    return json_value_init_boolean(tag == 0xC3U);
+  case 0xCAU: {
+    if (!msgpack_take_uint(reader, 4U, &bits)) {
+      return nullptr;
+    }
+    const uint32_t narrow = (uint32_t)bits;
+    float number = 0.0F;
+    memcpy(&number, &narrow, sizeof(number));
+    return json_value_init_number((double)number);
+  }
+  case 0xCBU: {
+    if (!msgpack_take_uint(reader, 8U, &bits)) {
+      return nullptr;
+    }
+    double number = 0.0;
+    memcpy(&number, &bits, sizeof(number));
+    return json_value_init_number(number);
+  }
+  case 0xCCU:
+  case 0xCDU:
+  case 0xCEU:
+  case 0xCFU:
+    if (!msgpack_take_uint(reader, (size_t)1U << (tag - 0xCCU), &bits)) {
+      return nullptr;
+    }
+    return json_value_init_number((double)bits);
+  case 0xD0U:
+  case 0xD1U:
+  case 0xD2U:
+  case 0xD3U: {
+    const size_t width = (size_t)1U << (tag - 0xD0U);
+    if (!msgpack_take_uint(reader, width, &bits)) {
+      return nullptr;
+    }
+    // Sign-extend from width bytes.
+    const unsigned shift = 64U - 8U * (unsigned)width;
+    const int64_t number = (int64_t)(bits << shift) >> shift;
+    return json_value_init_number((double)number);
+  }
+  case 0xDCU:
+  case 0xDDU:
+    if (!msgpack_take_length(reader, tag == 0xDCU ? 2U : 4U, 0U, &length)) {
+      return nullptr;
+    }
+    return msgpack_decode_array(reader, length, nesting);
+  case 0xDEU:
+  case 0xDFU:
+    if (!msgpack_take_length(reader, tag == 0xDEU ? 2U : 4U, 0U, &length)) {
+      return nullptr;
+    }
+    return msgpack_decode_map(reader, length, nesting);
+  default:
+    break;
+  }
+
+  if (tag <= 0x8FU) {
+    return msgpack_decode_map(reader, tag & 0x0FU, nesting);
+  }
+  if (tag <= 0x9FU) {
+    return msgpack_decode_array(reader, tag & 0x0FU, nesting);
+  }
+  if (tag <= 0xBFU || (tag >= 0xD9U && tag <= 0xDBU)) {
+    reader->pos -= 1U;
+    const uint8_t *bytes = msgpack_take_string(reader, &length);
+    return bytes == nullptr
+               ? nullptr
+               : json_value_init_string_with_len((const char *)bytes, length);
+  }
+  // 0xC1 is never used; bin and ext have no JSON counterpart.
+  return nullptr;
+}
+
+JSON_Value *jsonrpc_msgpack_decode(const uint8_t *data, size_t len) {
+  if (data == nullptr || len == 0U) {
+    return nullptr;
+  }
+  msgpack_reader_t reader = {.data = data, .len = len, .pos = 0U};
+  JSON_Value *value = msgpack_decode_value(&reader, 0U);
+  if (value != nullptr && reader.pos != len) {
+    json_value_free(value);
+    return nullptr;
+  }
+  return value;
+}
+
+[[nodiscard]]
+static bool msgpack_put(JSON_Output_Sink *sink, const uint8_t *bytes,
+                        size_t count) {
+  if (sink->cap - sink->len < count &&
+      (sink->grow == nullptr || !sink->grow(sink, count) ||
+       sink->data == nullptr || sink->cap - sink->len < count)) {
+    return false;
+  }
+  memcpy(sink->data + sink->len, bytes, count);
+  sink->len += count;
+  return true;
+}
+
+// Write tag followed by value as a width-byte big-endian field.
+[[nodiscard]]
+static bool msgpack_put_tagged(JSON_Output_Sink *sink, uint8_t tag,
+                               uint64_t value, size_t width) {
+  uint8_t bytes[9];
+  bytes[0] = tag;
+  for (size_t i = 0U; i < width; ++i) {
+    bytes[width - i] = (uint8_t)(value >> (8U * i));
+  }
+  return msgpack_put(sink, bytes, width + 1U);
+}
+
+/**
+ * @brief Write the header of a str, array or map of length items: the fix
+ * form (fix_tag | length) below fix_limit, else the narrowest of the 8, 16
+ * and 32-bit forms whose tags start at wide_tag (strings only have an 8-bit
+ * form, so arrays and maps pass has_8bit false).
+ */
+[[nodiscard]]
+static bool msgpack_put_length(JSON_Output_Sink *sink, uint8_t fix_tag,
+                               size_t fix_limit, uint8_t wide_tag,
+                               bool has_8bit, size_t length) {
+  if (length < fix_limit) {
+    const uint8_t tag = (uint8_t)(fix_tag | length);
+    return msgpack_put(sink, &tag, 1U);
+  }
+  if (has_8bit) {
+    if (length <= UINT8_MAX) {
+      return msgpack_put_tagged(sink, wide_tag, length, 1U);
+    }
+    wide_tag += 1U;
+  }
+  if (length <= UINT16_MAX) {
+    return msgpack_put_tagged(sink, wide_tag, length, 2U);
+  }
+  if (length <= UINT32_MAX) {
+    return msgpack_put_tagged(sink, wide_tag + 1U, length, 4U);
+  }
+  return false;
+}
+
+[[nodiscard]]
+static bool msgpack_put_integer(JSON_Output_Sink *sink, int64_t number) {
+  if (number >= 0) {
+    const uint64_t value = (uint64_t)number;
+    if (value <= 0x7FU) {
+      const uint8_t tag = (uint8_t)value;
+      return msgpack_put(sink, &tag, 1U);
+    }
+    return value <= UINT8_MAX    ? msgpack_put_tagged(sink, 0xCCU, value, 1U)
+           : value <= UINT16_MAX ? msgpack_put_tagged(sink, 0xCDU, value, 2U)
+           : value <= UINT32_MAX ? msgpack_put_tagged(sink, 0xCEU, value, 4U)
+                                 : msgpack_put_tagged(sink, 0xCFU, value, 8U);
+  }
+  const uint64_t bits = (uint64_t)number;
+  if (number >= -32) {
+    const uint8_t tag = (uint8_t)bits;
+    return msgpack_put(sink, &tag, 1U);
+  }
+  return number >= INT8_MIN    ? msgpack_put_tagged(sink, 0xD0U, bits, 1U)
+         : number >= INT16_MIN ? msgpack_put_tagged(sink, 0xD1U, bits, 2U)
+         : number >= INT32_MIN ? msgpack_put_tagged(sink, 0xD2U, bits, 4U)
+                               : msgpack_put_tagged(sink, 0xD3U, bits, 8U);
+}
+
+[[nodiscard]]
+static bool msgpack_put_number(JSON_Output_Sink *sink, double number) {
+  // -0.0 stays a float so it survives the round trip.
+  if (number >= -0x1p63 && number < 0x1p63 &&
+      (double)(int64_t)number == number &&
+      !(number == 0.0 && signbit(number))) {
+    return msgpack_put_integer(sink, (int64_t)number);
+  }
+  if (number >= -FLT_MAX && number <= FLT_MAX &&
+      (double)(float)number == number) {
+    const float narrow = (float)number;
+    uint32_t bits = 0U;
+    memcpy(&bits, &narrow, sizeof(bits));
+    return msgpack_put_tagged(sink, 0xCAU, bits, 4U);
+  }
+  uint64_t bits = 0U;
+  memcpy(&bits, &number, sizeof(bits));
+  return msgpack_put_tagged(sink, 0xCBU, bits, 8U);
+}
+
+[[nodiscard]]
+static bool msgpack_encode_value(const JSON_Value *value,
+                                 JSON_Output_Sink *sink) {
+  switch (json_value_get_type(value)) {
+  case JSONNull: {
+    const uint8_t tag = 0xC0U;
+    return msgpack_put(sink, &tag, 1U);
+  }
+  case JSONBoolean: {
+    const uint8_t tag = json_value_get_boolean(value) == 1 ? 0xC3U : 0xC2U;
+    return msgpack_put(sink, &tag, 1U);
+  }
+  case JSONNumber:
+    return msgpack_put_number(sink, json_value_get_number(value));
+  case JSONString: {
+    const size_t len = json_value_get_string_len(value);
+    return msgpack_put_length(sink, 0xA0U, 32U, 0xD9U, true, len) &&
+           msgpack_put(sink, (const uint8_t *)json_value_get_string(value),
+                       len);
+  }
+  case JSONArray: {
+    const JSON_Array *array = json_value_get_array(value);
+    const size_t count = json_array_get_count(array);
+    if (!msgpack_put_length(sink, 0x90U, 16U, 0xDCU, false, count)) {
+      return false;
+    }
+    for (size_t i = 0U; i < count; ++i) {
+      if (!msgpack_encode_value(json_array_get_value(array, i), sink)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  case JSONObject: {
+    const JSON_Object *object = json_value_get_object(value);
+    const size_t count = json_object_get_count(object);
+    if (!msgpack_put_length(sink, 0x80U, 16U, 0xDEU, false, count)) {
+      return false;
+    }
+    for (size_t i = 0U; i < count; ++i) {
+      const char *name = json_object_get_name(object, i);
+      const size_t name_len = strlen(name);
+      if (!msgpack_put_length(sink, 0xA0U, 32U, 0xD9U, true, name_len) ||
+          !msgpack_put(sink, (const uint8_t *)name, name_len) ||
+          !msgpack_encode_value(json_object_get_value_at(object, i), sink)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+bool jsonrpc_msgpack_encode(const JSON_Value *value, JSON_Output_Sink *sink) {
+  if (value == nullptr || sink == nullptr || sink->len > sink->cap ||
+      (sink->data == nullptr && sink->cap != 0U)) {
+    return false;
+  }
+  const size_t start_len = sink->len;
+  if (!msgpack_encode_value(value, sink)) {
+    sink->len = start_len;
+    return false;
+  }
+  return true;
+}
@@ -78,8 +78,14 @@ static inline size_t max_size(size_t a, size_t b) { return a > b ? a : b; }
 
 static inline void skip_char(const char **str) { ++(*str); }
 
-static inline void skip_whitespaces(const char **str) {
-  while (isspace((unsigned char)(**str))) {
+/* Reads the character under the parse cursor; the end of the input reads as
+   '\0' so length-bounded and NUL-terminated input share one code path. */
+static inline char peek_char(const char *str, const char *end) {
+  return str < end ? *str : '\0';
+}
+
+static inline void skip_whitespaces(const char **str, const char *end) {
+  while (*str < end && isspace((unsigned char)(**str))) {
     skip_char(str);
   }
 }
@@ -96,8 +102,26 @@ static inline bool is_number_invalid(double value) {
 #endif
 }
 
-static JSON_Malloc_Function parson_malloc = malloc;
-static JSON_Free_Function parson_free = free;
+static JSON_Malloc_Function parson_malloc_fun = malloc;
+static JSON_Free_Function parson_free_fun = free;
+static JSON_Malloc_Ctx_Function parson_malloc_ctx_fun = nullptr;
+static JSON_Free_Ctx_Function parson_free_ctx_fun = nullptr;
+static thread_local void *parson_allocation_context = nullptr;
+
+[[nodiscard]] static void *parson_malloc(size_t size) {
+  if (parson_malloc_ctx_fun != nullptr) {
+    return parson_malloc_ctx_fun(parson_allocation_context, size);
+  }
+  return parson_malloc_fun(size);
+}
+
+static void parson_free(void *ptr) {
+  if (parson_free_ctx_fun != nullptr) {
+    parson_free_ctx_fun(parson_allocation_context, ptr);
+    return;
+  }
+  parson_free_fun(ptr);
+}
 
 static bool parson_escape_slashes = true;
 
@@ -123,6 +147,7 @@ typedef union json_value_value {
 struct json_value_t {
   JSON_Value *parent;
   JSON_Value_Type type;
+  bool bulk_owned; /* fits in the padding after type */
   JSON_Value_Value value;
 };
 
@@ -159,6 +184,7 @@ static int num_bytes_in_utf8_sequence(unsigned char c);
 static JSON_Status verify_utf8_sequence(const unsigned char *string, int *len);
 static bool is_valid_utf8(const char *string, size_t string_len);
 static bool is_decimal(const char *string, size_t length);
+static bool is_number_char(char c);
 static unsigned long hash_string(const char *string, size_t n);
 
 /* JSON Object */
@@ -194,22 +220,28 @@ static void json_array_free(JSON_Array *array);
 static const JSON_String *json_value_get_string_desc(const JSON_Value *value);
 
 /* Parser */
-static JSON_Status skip_quotes(const char **string);
-static JSON_Status parse_utf16(const char **unprocessed, char **processed);
+static JSON_Status skip_quotes(const char **string, const char *end);
+static JSON_Status parse_utf16(const char **unprocessed, const char *end,
+                               char **processed);
 [[nodiscard]] static char *process_string(const char *input, size_t input_len,
                                           size_t *output_len);
 [[nodiscard]] static char *get_quoted_string(const char **string,
+                                             const char *end,
                                              size_t *output_string_len);
-[[nodiscard]] static JSON_Value *parse_object_value(const char **string,
-                                                    size_t nesting);
-[[nodiscard]] static JSON_Value *parse_array_value(const char **string,
-                                                   size_t nesting);
-[[nodiscard]] static JSON_Value *parse_string_value(const char **string);
-[[nodiscard]] static JSON_Value *parse_boolean_value(const char **string);
-[[nodiscard]] static JSON_Value *parse_number_value(const char **string);
-[[nodiscard]] static JSON_Value *parse_null_value(const char **string);
+[[nodiscard]] static JSON_Value *
+parse_object_value(const char **string, const char *end, size_t nesting);
+[[nodiscard]] static JSON_Value *
+parse_array_value(const char **string, const char *end, size_t nesting);
+[[nodiscard]] static JSON_Value *parse_string_value(const char **string,
+                                                    const char *end);
+[[nodiscard]] static JSON_Value *parse_boolean_value(const char **string,
+                                                     const char *end);
+[[nodiscard]] static JSON_Value *parse_number_value(const char **string,
+                                                    const char *end);
+[[nodiscard]] static JSON_Value *parse_null_value(const char **string,
+                                                  const char *end);
 [[nodiscard]] static JSON_Value *parse_value(const char **string,
-                                             size_t nesting);
+                                             const char *end, size_t nesting);
 
 /* Serialization */
 static int json_serialize_to_buffer_r(const JSON_Value *value, char *buf,
@@ -823,17 +855,17 @@ static void json_array_free(JSON_Array *array) {
 }
 
 /* Parser */
-static JSON_Status skip_quotes(const char **string) {
-  if (**string != '\"') {
+static JSON_Status skip_quotes(const char **string, const char *end) {
+  if (peek_char(*string, end) != '\"') {
     return JSONFailure;
   }
   skip_char(string);
-  while (**string != '\"') {
-    if (**string == '\0') {
+  while (peek_char(*string, end) != '\"') {
+    if (peek_char(*string, end) == '\0') {
       return JSONFailure;
     } else if (**string == '\\') {
       skip_char(string);
-      if (**string == '\0') {
+      if (peek_char(*string, end) == '\0') {
         return JSONFailure;
       }
     }
@@ -843,11 +875,16 @@ static JSON_Status skip_quotes(const char **string) {
   return JSONSuccess;
 }
 
-static JSON_Status parse_utf16(const char **unprocessed, char **processed) {
+static JSON_Status parse_utf16(const char **unprocessed, const char *end,
+                               char **processed) {
   unsigned int cp, lead, trail;
   char *processed_ptr = *processed;
   const char *unprocessed_ptr = *unprocessed;
   JSON_Status status = JSONFailure;
+  /* "u" plus four hex digits must lie inside the quoted string */
+  if (end - unprocessed_ptr < 5) {
+    return JSONFailure;
+  }
   unprocessed_ptr++; /* skips u */
   status = parse_utf16_hex(unprocessed_ptr, &cp);
   if (status != JSONSuccess) {
@@ -869,6 +906,9 @@ static JSON_Status parse_utf16(const char **unprocessed, char **processed) {
     lead = cp;
     unprocessed_ptr += 4; /* should always be within the buffer, otherwise
                              previous sscanf would fail */
+    if (end - unprocessed_ptr < 6) { /* "\\u" plus four hex digits */
+      return JSONFailure;
+    }
     if (*unprocessed_ptr++ != '\\' || *unprocessed_ptr++ != 'u') {
       return JSONFailure;
     }
@@ -935,7 +975,8 @@ Example: "\u006Corem ipsum" -> lorem ipsum */
         *output_ptr = '\t';
         break;
       case 'u':
-        if (parse_utf16(&input_ptr, &output_ptr) != JSONSuccess) {
+        if (parse_utf16(&input_ptr, input + input_len, &output_ptr) !=
+            JSONSuccess) {
           goto error;
         }
         break;
@@ -971,10 +1012,11 @@ error:
 /* Return processed contents of a string between quotes and
    skips passed argument to a matching quote. */
 [[nodiscard]] static char *get_quoted_string(const char **string,
+                                             const char *end,
                                              size_t *output_string_len) {
   const char *string_start = *string;
   size_t input_string_len = 0;
-  JSON_Status status = skip_quotes(string);
+  JSON_Status status = skip_quotes(string, end);
   if (status != JSONSuccess) {
     return nullptr;
   }
@@ -983,21 +1025,21 @@ error:
 }
 
 [[nodiscard]] static JSON_Value *parse_value(const char **string,
-                                             size_t nesting) {
+                                             const char *end, size_t nesting) {
   if (nesting > max_nesting) {
     return nullptr;
   }
-  skip_whitespaces(string);
-  switch (**string) {
+  skip_whitespaces(string, end);
+  switch (peek_char(*string, end)) {
   case '{':
-    return parse_object_value(string, nesting + 1);
+    return parse_object_value(string, end, nesting + 1);
   case '[':
-    return parse_array_value(string, nesting + 1);
+    return parse_array_value(string, end, nesting + 1);
   case '\"':
-    return parse_string_value(string);
+    return parse_string_value(string, end);
   case 'f':
   case 't':
-    return parse_boolean_value(string);
+    return parse_boolean_value(string, end);
   case '-':
   case '0':
   case '1':
@@ -1009,16 +1051,16 @@ error:
   case '7':
   case '8':
   case '9':
-    return parse_number_value(string);
+    return parse_number_value(string, end);
   case 'n':
-    return parse_null_value(string);
+    return parse_null_value(string, end);
   default:
     return nullptr;
   }
 }
 
-[[nodiscard]] static JSON_Value *parse_object_value(const char **string,
-                                                    size_t nesting) {
+[[nodiscard]] static JSON_Value *
+parse_object_value(const char **string, const char *end, size_t nesting) {
   JSON_Status status = JSONFailure;
   JSON_Value *output_value = nullptr, *new_value = nullptr;
   JSON_Object *output_object = nullptr;
@@ -1028,20 +1070,20 @@ error:
   if (output_value == nullptr) {
     return nullptr;
   }
-  if (**string != '{') {
+  if (peek_char(*string, end) != '{') {
     json_value_free(output_value);
     return nullptr;
   }
   output_object = json_value_get_object(output_value);
   skip_char(string);
-  skip_whitespaces(string);
-  if (**string == '}') { /* empty object */
+  skip_whitespaces(string, end);
+  if (peek_char(*string, end) == '}') { /* empty object */
     skip_char(string);
     return output_value;
   }
-  while (**string != '\0') {
+  while (peek_char(*string, end) != '\0') {
     size_t key_len = 0;
-    new_key = get_quoted_string(string, &key_len);
+    new_key = get_quoted_string(string, end, &key_len);
     /* We do not support key names with embedded \0 chars */
     if (new_key == nullptr) {
       json_value_free(output_value);
@@ -1052,14 +1094,14 @@ error:
       json_value_free(output_value);
       return nullptr;
     }
-    skip_whitespaces(string);
-    if (**string != ':') {
+    skip_whitespaces(string, end);
+    if (peek_char(*string, end) != ':') {
       parson_free(new_key);
       json_value_free(output_value);
       return nullptr;
     }
     skip_char(string);
-    new_value = parse_value(string, nesting);
+    new_value = parse_value(string, end, nesting);
     if (new_value == nullptr) {
       parson_free(new_key);
       json_value_free(output_value);
@@ -1072,18 +1114,18 @@ error:
       json_value_free(output_value);
       return nullptr;
     }
-    skip_whitespaces(string);
-    if (**string != ',') {
+    skip_whitespaces(string, end);
+    if (peek_char(*string, end) != ',') {
       break;
     }
     skip_char(string);
-    skip_whitespaces(string);
-    if (**string == '}') {
+    skip_whitespaces(string, end);
+    if (peek_char(*string, end) == '}') {
       break;
     }
   }
-  skip_whitespaces(string);
-  if (**string != '}') {
+  skip_whitespaces(string, end);
+  if (peek_char(*string, end) != '}') {
     json_value_free(output_value);
     return nullptr;
   }
@@ -1091,27 +1133,27 @@ error:
   return output_value;
 }
 
-[[nodiscard]] static JSON_Value *parse_array_value(const char **string,
-                                                   size_t nesting) {
+[[nodiscard]] static JSON_Value *
+parse_array_value(const char **string, const char *end, size_t nesting) {
   JSON_Value *output_value = nullptr, *new_array_value = nullptr;
   JSON_Array *output_array = nullptr;
   output_value = json_value_init_array();
   if (output_value == nullptr) {
     return nullptr;
   }
-  if (**string != '[') {
+  if (peek_char(*string, end) != '[') {
     json_value_free(output_value);
     return nullptr;
   }
   output_array = json_value_get_array(output_value);
   skip_char(string);
-  skip_whitespaces(string);
-  if (**string == ']') { /* empty array */
+  skip_whitespaces(string, end);
+  if (peek_char(*string, end) == ']') { /* empty array */
     skip_char(string);
     return output_value;
   }
-  while (**string != '\0') {
-    new_array_value = parse_value(string, nesting);
+  while (peek_char(*string, end) != '\0') {
+    new_array_value = parse_value(string, end, nesting);
     if (new_array_value == nullptr) {
       json_value_free(output_value);
       return nullptr;
@@ -1121,18 +1163,18 @@ error:
       json_value_free(output_value);
       return nullptr;
     }
-    skip_whitespaces(string);
-    if (**string != ',') {
+    skip_whitespaces(string, end);
+    if (peek_char(*string, end) != ',') {
       break;
     }
     skip_char(string);
-    skip_whitespaces(string);
-    if (**string == ']') {
+    skip_whitespaces(string, end);
+    if (peek_char(*string, end) == ']') {
       break;
     }
   }
-  skip_whitespaces(string);
-  if (**string != ']' || /* Trim array after parsing is over */
+  skip_whitespaces(string, end);
+  if (peek_char(*string, end) != ']' || /* Trim array after parsing is over */
       json_array_resize(output_array, json_array_get_count(output_array)) !=
           JSONSuccess) {
     json_value_free(output_value);
@@ -1142,10 +1184,11 @@ error:
   return output_value;
 }
 
-[[nodiscard]] static JSON_Value *parse_string_value(const char **string) {
+[[nodiscard]] static JSON_Value *parse_string_value(const char **string,
+                                                    const char *end) {
   JSON_Value *value = nullptr;
   size_t new_string_len = 0;
-  char *new_string = get_quoted_string(string, &new_string_len);
+  char *new_string = get_quoted_string(string, end, &new_string_len);
   if (new_string == nullptr) {
     return nullptr;
   }
@@ -1157,37 +1200,94 @@ error:
   return value;
 }
 
-[[nodiscard]] static JSON_Value *parse_boolean_value(const char **string) {
+[[nodiscard]] static JSON_Value *parse_boolean_value(const char **string,
+                                                     const char *end) {
   constexpr size_t true_token_size = sizeof("true") - 1;
   constexpr size_t false_token_size = sizeof("false") - 1;
-  if (strncmp("true", *string, true_token_size) == 0) {
+  const size_t available = (size_t)(end - *string);
+  if (available >= true_token_size &&
+      memcmp("true", *string, true_token_size) == 0) {
     *string += true_token_size;
     return json_value_init_boolean(true);
-  } else if (strncmp("false", *string, false_token_size) == 0) {
+  } else if (available >= false_token_size &&
+             memcmp("false", *string, false_token_size) == 0) {
     *string += false_token_size;
     return json_value_init_boolean(false);
   }
   return nullptr;
 }
 
-[[nodiscard]] static JSON_Value *parse_number_value(const char **string) {
-  char *end;
-  double number = 0;
-  errno = 0;
-  number = strtod(*string, &end);
-  if (errno == ERANGE && (number <= -HUGE_VAL || number >= HUGE_VAL)) {
+static bool is_number_char(char c) {
+  switch (c) {
+  case '+':
+  case '-':
+  case '.':
+  case 'e':
+  case 'E':
+  case 'x':
+  case 'X':
+    return true;
+  default:
+    return c >= '0' && c <= '9';
+  }
+}
+
+[[nodiscard]] static JSON_Value *parse_number_value(const char **string,
+                                                    const char *end) {
+  const size_t available = (size_t)(end - *string);
+  size_t token_len = 0;
+  bool hex = false;
+  while (token_len < available && is_number_char((*string)[token_len])) {
+    hex = hex || (*string)[token_len] == 'x' || (*string)[token_len] == 'X';
+    token_len++;
+  }
+  /* With a digit first (after an optional minus) and no 'x', strtod reads
+     the decimal form only, whose characters all belong to the token, so it
+     never looks past the character that ended the token. */
+  const size_t first_digit = (*string)[0] == '-' ? 1 : 0;
+  if (hex || first_digit >= token_len || (*string)[first_digit] < '0' ||
+      (*string)[first_digit] > '9') {
     return nullptr;
   }
-  if ((errno && errno != ERANGE) || !is_decimal(*string, end - *string)) {
+  /* Only a token running right up to end has no character after it to stop
+     strtod; that one is parsed from a NUL-terminated copy. */
+  char small_token[64];
+  char *copy = nullptr;
+  const char *token = *string;
+  if (token_len == available) {
+    copy = token_len < sizeof(small_token)
+               ? small_token
+               : (char *)parson_malloc(token_len + 1);
+    if (copy == nullptr) {
+      return nullptr;
+    }
+    memcpy(copy, *string, token_len);
+    copy[token_len] = '\0';
+    token = copy;
+  }
+  char *token_end = nullptr;
+  errno = 0;
+  const double number = strtod(token, &token_end);
+  const size_t consumed = (size_t)(token_end - token);
+  const bool valid =
+      !(errno == ERANGE && (number <= -HUGE_VAL || number >= HUGE_VAL)) &&
+      !(errno && errno != ERANGE) && consumed > 0 &&
+      is_decimal(token, consumed);
+  if (copy != nullptr && copy != small_token) {
+    parson_free(copy);
+  }
+  if (!valid) {
     return nullptr;
   }
-  *string = end;
+  *string += consumed;
   return json_value_init_number(number);
 }
 
-[[nodiscard]] static JSON_Value *parse_null_value(const char **string) {
+[[nodiscard]] static JSON_Value *parse_null_value(const char **string,
+                                                  const char *end) {
   constexpr size_t token_size = sizeof("null") - 1;
-  if (strncmp("null", *string, token_size) == 0) {
+  if ((size_t)(end - *string) >= token_size &&
+      memcmp("null", *string, token_size) == 0) {
     *string += token_size;
     return json_value_init_null();
   }
@@ -1508,6 +1608,147 @@ static int json_serialize_string(const char *string, size_t len, char *buf) {
   return out.written_total;
 }
 
+[[nodiscard]] static bool sink_ensure(JSON_Output_Sink *sink, size_t min_free) {
+  if (sink->cap - sink->len >= min_free) {
+    return true;
+  }
+  if (sink->grow == nullptr || !sink->grow(sink, min_free)) {
+    return false;
+  }
+  return sink->data != nullptr && sink->cap >= sink->len &&
+         sink->cap - sink->len >= min_free;
+}
+
+[[nodiscard]] static bool sink_append(JSON_Output_Sink *sink,
+                                      const char *literal, size_t len) {
+  if (!sink_ensure(sink, len)) {
+    return false;
+  }
+  memcpy(sink->data + sink->len, literal, len);
+  sink->len += len;
+  return true;
+}
+
+[[nodiscard]] static bool sink_append_string(JSON_Output_Sink *sink,
+                                             const char *string, size_t len) {
+  /* Every input byte expands to at most 6 output bytes ("\u00XX"); add the
+     quotes and the NUL that json_serialize_string always writes. When that
+     bound does not already fit, size the string exactly instead of growing the
+     sink by the worst case. */
+  size_t needed = 0;
+  if (len <= (SIZE_MAX - 3) / 6) {
+    needed = len * 6 + 3;
+  }
+  if (needed == 0 || sink->cap - sink->len < needed) {
+    const int exact = json_serialize_string(string, len, nullptr);
+    if (exact < 0) {
+      return false;
+    }
+    needed = (size_t)exact + 1;
+  }
+  if (!sink_ensure(sink, needed)) {
+    return false;
+  }
+  const int written =
+      json_serialize_string(string, len, sink->data + sink->len);
+  if (written < 0) {
+    return false;
+  }
+  sink->len += (size_t)written;
+  return true;
+}
+
+[[nodiscard]] static bool json_serialize_to_sink_r(const JSON_Value *value,
+                                                   JSON_Output_Sink *sink) {
+  switch (json_value_get_type(value)) {
+  case JSONArray: {
+    const JSON_Array *array = json_value_get_array(value);
+    const size_t count = json_array_get_count(array);
+    if (!sink_append(sink, "[", 1)) {
+      return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+      if (i > 0 && !sink_append(sink, ",", 1)) {
+        return false;
+      }
+      if (!json_serialize_to_sink_r(json_array_get_value(array, i), sink)) {
+        return false;
+      }
+    }
+    return sink_append(sink, "]", 1);
+  }
+  case JSONObject: {
+    const JSON_Object *object = json_value_get_object(value);
+    const size_t count = json_object_get_count(object);
+    if (!sink_append(sink, "{", 1)) {
+      return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+      const char *key = json_object_get_name(object, i);
+      if (key == nullptr) {
+        return false;
+      }
+      if (i > 0 && !sink_append(sink, ",", 1)) {
+        return false;
+      }
+      /* We do not support key names with embedded \0 chars */
+      if (!sink_append_string(sink, key, strlen(key)) ||
+          !sink_append(sink, ":", 1)) {
+        return false;
+      }
+      if (!json_serialize_to_sink_r(json_object_get_value_at(object, i),
+                                    sink)) {
+        return false;
+      }
+    }
+    return sink_append(sink, "}", 1);
+  }
+  case JSONString: {
+    const char *string = json_value_get_string(value);
+    if (string == nullptr) {
+      return false;
+    }
+    return sink_append_string(sink, string, json_value_get_string_len(value));
+  }
+  case JSONBoolean: {
+    const JSON_Boolean boolean_value = json_value_get_boolean(value);
+    if (boolean_value == JSONBooleanError) {
+      return false;
+    }
+    return boolean_value == JSONBooleanTrue ? sink_append(sink, "true", 4)
+                                            : sink_append(sink, "false", 5);
+  }
+  case JSONNumber: {
+    /* +1 for the NUL written by snprintf */
+    if (!sink_ensure(sink, parson_num_buf_size + 1)) {
+      return false;
+    }
+    const double num = json_value_get_number(value);
+    char *cursor = sink->data + sink->len;
+    int written = -1;
+    if (parson_number_serialization_function) {
+      written = parson_number_serialization_function(num, cursor);
+    } else {
+      const char *float_format = parson_float_format
+                                     ? parson_float_format
+                                     : parson_default_float_format;
+      written = parson_sprintf(cursor, parson_num_buf_size, float_format, num);
+    }
+    if (written < 0 || (size_t)written >= parson_num_buf_size) {
+      return false;
+    }
+    sink->len += (size_t)written;
+    return true;
+  }
+  case JSONNull:
+    return sink_append(sink, "null", 4);
+  case JSONError:
+    return false;
+  default:
+    return false;
+  }
+}
+
 /* Parser API */
 JSON_Value *json_parse_file(const char *filename) {
   char *file_contents = read_file(filename);
@@ -1538,7 +1779,32 @@ JSON_Value *json_parse_string(const char *string) {
   if (string[0] == '\xEF' && string[1] == '\xBB' && string[2] == '\xBF') {
     string = string + 3; /* Support for UTF-8 BOM */
   }
-  return parse_value((const char **)&string, 0);
+  return parse_value((const char **)&string, string + strlen(string), 0);
+}
+
+JSON_Value *json_parse_string_with_len(const char *string, size_t len) {
+  JSON_Value *result = nullptr;
+  const char *end = nullptr;
+  if (string == nullptr) {
+    return nullptr;
+  }
+  end = string + len;
+  if (len >= 3 && string[0] == '\xEF' && string[1] == '\xBB' &&
+      string[2] == '\xBF') {
+    string = string + 3; /* Support for UTF-8 BOM */
+  }
+  result = parse_value(&string, end, 0);
+  if (result == nullptr) {
+    return nullptr;
+  }
+  /* The whole input must be consumed; an embedded '\0' stops the parser
+     early and lands here too. */
+  skip_whitespaces(&string, end);
+  if (string != end) {
+    json_value_free(result);
+    return nullptr;
+  }
+  return result;
 }
 
 JSON_Value *json_parse_string_with_comments(const char *string) {
@@ -1554,7 +1820,10 @@ JSON_Value *json_parse_string_with_comments(const char *string) {
   remove_comments(string_mutable_copy, "/*", "*/");
   remove_comments(string_mutable_copy, "//", "\n");
   string_mutable_copy_ptr = string_mutable_copy;
-  result = parse_value((const char **)&string_mutable_copy_ptr, 0);
+  const char *string_mutable_copy_end =
+      string_mutable_copy + strlen(string_mutable_copy);
+  result = parse_value((const char **)&string_mutable_copy_ptr,
+                       string_mutable_copy_end, 0);
   parson_free(string_mutable_copy);
   return result;
 }
@@ -1771,6 +2040,9 @@ JSON_Value *json_value_get_parent(const JSON_Value *value) {
 }
 
 void json_value_free(JSON_Value *value) {
+  if (value != nullptr && value->bulk_owned) {
+    return;
+  }
   switch (json_value_get_type(value)) {
   case JSONObject:
     json_object_free(value->value.object);
@@ -1787,6 +2059,17 @@ void json_value_free(JSON_Value *value) {
   parson_free(value);
 }
 
+void json_value_set_bulk_owned(JSON_Value *value, bool bulk_owned) {
+  if (value == nullptr) {
+    return;
+  }
+  value->bulk_owned = bulk_owned;
+}
+
+bool json_value_is_bulk_owned(const JSON_Value *value) {
+  return value != nullptr && value->bulk_owned;
+}
+
 JSON_Value *json_value_init_object() {
   auto new_value = (JSON_Value *)parson_calloc(1, sizeof(JSON_Value));
   if (new_value == nullptr) {
@@ -2036,6 +2319,20 @@ char *json_serialize_to_string(const JSON_Value *value) {
   return buf;
 }
 
+JSON_Status json_serialize_to_sink(const JSON_Value *value,
+                                   JSON_Output_Sink *sink, size_t reserve) {
+  if (value == nullptr || sink == nullptr || sink->len > sink->cap ||
+      (sink->data == nullptr && sink->cap != 0)) {
+    return JSONFailure;
+  }
+  const size_t start_len = sink->len;
+  if (!json_serialize_to_sink_r(value, sink) || !sink_ensure(sink, reserve)) {
+    sink->len = start_len;
+    return JSONFailure;
+  }
+  return JSONSuccess;
+}
+
 size_t json_serialization_size_pretty(const JSON_Value *value) {
   char
       num_buf[parson_num_buf_size]; /* recursively allocating buffer on stack is
@@ -2677,10 +2974,29 @@ void json_set_allocation_functions(JSON_Malloc_Function malloc_fun,
   if (malloc_fun == nullptr || free_fun == nullptr) {
     return;
   }
-  parson_malloc = malloc_fun;
-  parson_free = free_fun;
+  parson_malloc_fun = malloc_fun;
+  parson_free_fun = free_fun;
+  parson_malloc_ctx_fun = nullptr;
+  parson_free_ctx_fun = nullptr;
 }
 
+void json_set_allocation_functions_with_context(
+    JSON_Malloc_Ctx_Function malloc_fun, JSON_Free_Ctx_Function free_fun) {
+  if (malloc_fun == nullptr || free_fun == nullptr) {
+    return;
+  }
+  parson_malloc_ctx_fun = malloc_fun;
+  parson_free_ctx_fun = free_fun;
+}
+
+void *json_set_allocation_context(void *ctx) {
+  void *prev = parson_allocation_context;
+  parson_allocation_context = ctx;
+  return prev;
+}
+
+void *json_get_allocation_context() { return parson_allocation_context; }
+
 void json_set_escape_slashes(bool escape_slashes) {
   parson_escape_slashes = escape_slashes;
 }
@@ -0,0 +1,93 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "jsonrpc/pool.h"
+
+bool jsonrpc_pool_init(jsonrpc_pool_t *pool, size_t high_water,
+                       size_t low_water, jsonrpc_pool_release_t release) {
+  if (pool == nullptr) {
+    return false;
+  }
+  *pool = (jsonrpc_pool_t){0};
+  pool->release = release;
+  if (high_water == 0U) {
+    return true;
+  }
+
+  pool->items = (void **)calloc(high_water, sizeof(void *));
+  if (pool->items == nullptr) {
+    return false;
+  }
+  pool->high_water = high_water;
+  pool->low_water = low_water < high_water ? low_water : high_water;
+  return true;
+}
+
+void *jsonrpc_pool_get(jsonrpc_pool_t *pool) {
+  if (pool == nullptr) {
+    return nullptr;
+  }
+  pool->gets_since_trim += 1U;
+  if (pool->count == 0U) {
+    pool->misses += 1U;
+    return nullptr;
+  }
+  pool->hits += 1U;
+  pool->count -= 1U;
+  return pool->items[pool->count];
+}
+
+static void jsonrpc_pool_release(jsonrpc_pool_t *pool, void *item) {
+  if (pool->release != nullptr) {
+    pool->release(item);
+  } else {
+    free(item);
+  }
+}
+
+void jsonrpc_pool_put(jsonrpc_pool_t *pool, void *item) {
+  if (item == nullptr) {
+    return;
+  }
+  if (pool == nullptr) {
+    free(item);
+    return;
+  }
+  if (pool->count >= pool->high_water) {
+    jsonrpc_pool_release(pool, item);
+    return;
+  }
+  pool->items[pool->count] = item;
+  pool->count += 1U;
+}
+
+void jsonrpc_pool_trim(jsonrpc_pool_t *pool, size_t keep) {
+  if (pool == nullptr) {
+    return;
+  }
+  while (pool->count > keep) {
+    pool->count -= 1U;
+    jsonrpc_pool_release(pool, pool->items[pool->count]);
+    pool->trimmed += 1U;
+  }
+}
+
+void jsonrpc_pool_idle_trim(jsonrpc_pool_t *pool) {
+  if (pool == nullptr) {
+    return;
+  }
+  if (pool->gets_since_trim == 0U) {
+    jsonrpc_pool_trim(pool, pool->low_water);
+  }
+  pool->gets_since_trim = 0U;
+}
+
+void jsonrpc_pool_destroy(jsonrpc_pool_t *pool) {
+  if (pool == nullptr) {
+    return;
+  }
+  jsonrpc_pool_trim(pool, 0U);
+  free(pool->items);
+  *pool = (jsonrpc_pool_t){0};
+}
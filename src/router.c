@@ -0,0 +1,150 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "jsonrpc/router.h"
+
+constexpr size_t ROUTER_INITIAL_CAP = 16U; // power of two
+
+typedef struct {
+  char *name; // nullptr marks an empty slot
+  size_t name_len;
+  uint64_t hash;
+  jsonrpc_method_t method;
+} router_slot_t;
+
+// Open-addressing table with linear probing, kept at most half full so
+// misses stay short. Capacity is always a power of two.
+struct jsonrpc_router_s {
+  router_slot_t *slots;
+  size_t cap;
+  size_t count;
+};
+
+static uint64_t router_hash(const char *name, size_t len) {
+  // FNV-1a
+  uint64_t hash = 0xCBF2'9CE4'8422'2325ULL;
+  for (size_t i = 0U; i < len; ++i) {
+    hash ^= (uint8_t)name[i];
+    hash *= 0x0000'0100'0000'01B3ULL;
+  }
+  return hash;
+}
+
+static size_t router_probe(const router_slot_t *slots, size_t cap,
+                           const char *name, size_t name_len, uint64_t hash) {
+  const size_t mask = cap - 1U;
+  size_t index = (size_t)hash & mask;
+  while (slots[index].name != nullptr) {
+    const router_slot_t *slot = &slots[index];
+    if (slot->hash == hash && slot->name_len == name_len &&
+        memcmp(slot->name, name, name_len) == 0) {
+      return index;
+    }
+    index = (index + 1U) & mask;
+  }
+  return index;
+}
+
+[[nodiscard]] static bool router_grow(jsonrpc_router_t *router) {
+  if (router->cap > SIZE_MAX / 2U / sizeof(router_slot_t)) {
+    return false;
+  }
+  const size_t new_cap = router->cap * 2U;
+  auto new_slots = (router_slot_t *)calloc(new_cap, sizeof(router_slot_t));
+  if (new_slots == nullptr) {
+    return false;
+  }
+  for (size_t i = 0U; i < router->cap; ++i) {
+    const router_slot_t *slot = &router->slots[i];
+    if (slot->name == nullptr) {
+      continue;
+    }
+    const size_t index = router_probe(new_slots, new_cap, slot->name,
+                                      slot->name_len, slot->hash);
+    new_slots[index] = *slot;
+  }
+  free(router->slots);
+  router->slots = new_slots;
+  router->cap = new_cap;
+  return true;
+}
+
+jsonrpc_router_t *jsonrpc_router_new() {
+  auto router = (jsonrpc_router_t *)calloc(1U, sizeof(jsonrpc_router_t));
+  if (router == nullptr) {
+    return nullptr;
+  }
+  router->slots =
+      (router_slot_t *)calloc(ROUTER_INITIAL_CAP, sizeof(router_slot_t));
+  if (router->slots == nullptr) {
+    free(router);
+    return nullptr;
+  }
+  router->cap = ROUTER_INITIAL_CAP;
+  return router;
+}
+
+void jsonrpc_router_free(jsonrpc_router_t *router) {
+  if (router == nullptr) {
+    return;
+  }
+  for (size_t i = 0U; i < router->cap; ++i) {
+    free(router->slots[i].name);
+  }
+  free(router->slots);
+  free(router);
+}
+
+bool jsonrpc_router_add(jsonrpc_router_t *router, const char *method,
+                        jsonrpc_method_handler_t handler, uint32_t flags,
+                        void *user_data) {
+  if (router == nullptr || method == nullptr || handler == nullptr) {
+    return false;
+  }
+  if ((router->count + 1U) * 2U > router->cap && !router_grow(router)) {
+    return false;
+  }
+
+  const size_t name_len = strlen(method);
+  const uint64_t hash = router_hash(method, name_len);
+  const size_t index =
+      router_probe(router->slots, router->cap, method, name_len, hash);
+  if (router->slots[index].name != nullptr) {
+    return false;
+  }
+
+  auto name = (char *)calloc(name_len + 1U, sizeof(char));
+  if (name == nullptr) {
+    return false;
+  }
+  memcpy(name, method, name_len);
+
+  router->slots[index] = (router_slot_t){
+      .name = name,
+      .name_len = name_len,
+      .hash = hash,
+      .method = {.handler = handler, .flags = flags, .user_data = user_data}};
+  router->count += 1U;
+  return true;
+}
+
+const jsonrpc_method_t *jsonrpc_router_find(const jsonrpc_router_t *router,
+                                            const char *method,
+                                            size_t method_len) {
+  if (router == nullptr || method == nullptr) {
+    return nullptr;
+  }
+  const size_t index =
+      router_probe(router->slots, router->cap, method, method_len,
+                   router_hash(method, method_len));
+  if (router->slots[index].name == nullptr) {
+    return nullptr;
+  }
+  return &router->slots[index].method;
+}
+
+size_t jsonrpc_router_count(const jsonrpc_router_t *router) {
+  return router == nullptr ? 0U : router->count;
+}
@@ -1,29 +1,165 @@
+#include <errno.h>
 #include <limits.h>
 #include <signal.h>
+#include <stdatomic.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
 
 #include <uv.h>
 
+#include "jsonrpc/flow_control.h"
 #include "jsonrpc/jsonrpc.h"
+#include "jsonrpc/pool.h"
+#include "jsonrpc/router.h"
 #include "jsonrpc/server.h"
+#include "jsonrpc/timer_wheel.h"
+#include "jsonrpc/uring_server.h"
 
 constexpr size_t READ_CHUNK_MIN = 1'024;
 constexpr size_t READ_CHUNK_MAX = 4'096;
+// Size of the per-loop read slab used when reads share one buffer.
+constexpr size_t READ_SLAB_BYTES = 65'536;
 constexpr int32_t SERVER_BACKLOG = 4'096;
-static uv_loop_t *g_loop = nullptr;
-static uv_tcp_t g_server;
-static bool g_shutdown_requested = false;
+// Responses produced while handling one read are coalesced into a single
+// uv_write; a batch is flushed early once it grows past this size.
+constexpr size_t WRITE_BATCH_MAX_BYTES = 65'536U;
+constexpr uint32_t SERVER_MAX_WORKERS = 256U;
+constexpr int32_t JSONRPC_ERR_INTERNAL = -32'603;
+// Arenas that grew past this while serving a connection are destroyed rather
+// than pooled, so one large message does not pin memory in the free list.
+constexpr size_t POOL_ARENA_MAX_BYTES = 65'536U;
+// How often a loop over the memory budget pauses another connection, and
+// checks whether paused ones may resume.
+constexpr uint64_t MEMORY_CHECK_MS = 100U;
+// Connection timeouts: wheel resolution, and slots for one revolution
+// (about 100 s; later deadlines wait in their slot for more revolutions).
+constexpr uint64_t TIMEOUT_TICK_MS = 100U;
+constexpr size_t TIMEOUT_WHEEL_SLOTS = 1'024U;
+// How long a closing connection may spend draining its queued writes before
+// it is closed with them unsent.
+constexpr uint64_t CLOSE_DRAIN_MS = 2'000U;
+// How often a loop with a paused listener checks for room below
+// max_connections (connections closing on other loops do not wake it).
+constexpr uint64_t ACCEPT_RETRY_MS = 50U;
+// Sent to connections shed over max_connections before they are closed,
+// framed the way their listener frames messages.
+static const char SHED_RESPONSE[] =
+    "{\"jsonrpc\":\"2.0\",\"id\":null,\"error\":{\"code\":-32000,"
+    "\"message\":\"Server at connection limit\"}}";
+
+/**
+ * @brief One event loop plus its listener. Worker 0 runs on the thread that
+ * called start_jsonrpc_server_with_config using the default loop; the others
+ * own a private loop and thread.
+ */
+typedef struct {
+  uv_loop_t *loop;
+  uv_loop_t private_loop;
+  uv_tcp_t server;
+  uv_pipe_t pipe_server; // server_config_t.unix_path
+  bool pipe_bound;       // this worker created the socket file
+  uring_server_t *uring; // SERVER_BACKEND_IO_URING listener and connections
+  uv_async_t stop_async;
+  uv_timer_t trim_timer;
+  uv_timer_t memory_timer;
+  uv_timer_t timeout_timer; // drives timeouts, the wheel of every connection
+  jsonrpc_timer_wheel_t timeouts;
+  // Admission: accepts are counted per loop iteration and reset by
+  // accept_check. A connection left unaccepted (budget spent, or the listener
+  // paused at max_connections) stops libuv polling the listener until
+  // accept_check or accept_retry_timer takes it.
+  uv_check_t accept_check;
+  uv_timer_t accept_retry_timer;
+  uint32_t accepts_this_tick;
+  uint32_t accept_pending; // enum server_listener bits
+  bool listener_paused;
+  uv_thread_t thread;
+  uint32_t index;
+  bool loop_ready;
+  bool thread_started;
+  // Released connection state, reused by the next connection on this loop.
+  jsonrpc_pool_t ctx_pool;
+  jsonrpc_pool_t read_pool; // READ_CHUNK_MAX-byte read buffers
+  jsonrpc_pool_t arena_pool;
+  // Shared read buffer (server_config_t.shared_read_buffer), else nullptr.
+  // libuv runs each alloc/read callback pair to completion on the loop, and
+  // jsonrpc_conn_feed copies out any partial message, so all reads on the
+  // loop can land here.
+  uint8_t *read_slab;
+  // Memory accounting: every open connection, and the bytes they hold.
+  struct client_ctx_s *clients;
+  size_t client_count;
+  size_t memory_paused_count; // connections with CLIENT_PAUSE_MEMORY set
+  size_t memory_used;
+} server_worker_t;
+
+static server_worker_t *g_workers = nullptr;
+static uint32_t g_worker_count = 0U;
+static uv_mutex_t g_workers_lock;
+static uv_once_t g_workers_lock_once = UV_ONCE_INIT;
+static atomic_bool g_shutdown_requested = false;
+// Loop driven by the current thread, used to queue offloaded requests.
+static thread_local uv_loop_t *t_worker_loop = nullptr;
+// Bytes held by connections across all loops, checked against the budget
+// (server_config_t.memory_budget_bytes, 0 for none). The limits are set
+// before any worker starts.
+static atomic_size_t g_memory_used = 0U;
+static size_t g_memory_budget = 0U;
+static size_t g_memory_resume = 0U;
+// Write-queue watermarks (server_config_t.write_queue_*_bytes), 0 for none.
+static jsonrpc_watermarks_t g_write_queue = {0};
+// Totals reported by server_get_stats.
+static atomic_size_t g_connection_count = 0U;
+static atomic_size_t g_memory_paused_count = 0U;
+static atomic_size_t g_write_paused_count = 0U;
+static atomic_uint_least64_t g_write_pauses = 0U;
+static atomic_uint_least64_t g_idle_timeouts = 0U;
+static atomic_uint_least64_t g_message_timeouts = 0U;
+static atomic_uint_least64_t g_connections_shed = 0U;
+static atomic_uint_least64_t g_accept_pauses = 0U;
+// Admission control (server_config_t.max_connections etc.), 0 for none.
+static jsonrpc_admission_t g_admission = {0};
+// Connection timeouts (server_config_t.*_timeout_ms), 0 for none.
+static uint64_t g_idle_timeout_ms = 0U;
+static uint64_t g_message_timeout_ms = 0U;
+// Message framing per listener (server_config_t.tcp_framing etc.).
+static jsonrpc_framing_t g_tcp_framing = JSONRPC_FRAMING_NEWLINE;
+static jsonrpc_framing_t g_unix_framing = JSONRPC_FRAMING_NEWLINE;
+static size_t g_max_framed_message = 0U;
+static bool g_msgpack = false;
+
+/**
+ * @brief Why a connection stopped reading; it reads again once none is left.
+ */
+enum client_pause_reason {
+  CLIENT_PAUSE_MEMORY = 1U << 0,      // over the memory budget
+  CLIENT_PAUSE_WRITE_QUEUE = 1U << 1, // peer is not draining responses
+  CLIENT_PAUSE_DEFERRED = 1U << 2,    // HTTP requests held behind a deferral
+};
+
+/**
+ * @brief The listeners of a worker, as bits.
+ */
+enum server_listener {
+  SERVER_LISTENER_TCP = 1U << 0,
+  SERVER_LISTENER_PIPE = 1U << 1,
+};
 
 static void on_uv_client_closed(uv_handle_t *handle);
+static void on_accept_retry(uv_timer_t *handle);
 static void transport_close(jsonrpc_transport_t *self);
 
 static void close_handle(uv_handle_t *handle, void *arg [[maybe_unused]]) {
   if (!uv_is_closing(handle)) {
-    if (uv_handle_get_type(handle) == UV_TCP && handle->data != nullptr) {
+    const uv_handle_type type = uv_handle_get_type(handle);
+    if ((type == UV_TCP || type == UV_NAMED_PIPE) && handle->data != nullptr) {
       uv_close(handle, on_uv_client_closed);
       return;
     }
@@ -34,18 +170,46 @@ static void close_handle(uv_handle_t *handle, void *arg [[maybe_unused]]) {
 typedef struct {
   uv_write_t req;
   jsonrpc_transport_t *transport;
+  size_t start; // bytes of data[] before this are not sent
+  size_t len;
+  size_t cap;
   uint8_t data[];
 } write_ctx_t;
 
 /**
- * @brief Internal wrapper linking the protocol and libuv handle.
+ * @brief A client's TCP or Unix socket. Everything past accept only uses the
+ * uv_stream_t and uv_handle_t views.
  */
-typedef struct {
+typedef union {
+  uv_handle_t handle;
+  uv_stream_t stream;
   uv_tcp_t tcp;
+  uv_pipe_t pipe;
+} client_stream_t;
+
+/**
+ * @brief Internal wrapper linking the protocol and libuv handle.
+ */
+typedef struct client_ctx_s {
+  client_stream_t io;
+  server_worker_t *worker;
+  struct client_ctx_s *prev; // worker->clients list
+  struct client_ctx_s *next;
   jsonrpc_conn_t *rpc;
   jsonrpc_transport_t transport;
   uint8_t *read_buffer;
   size_t read_capacity;
+  write_ctx_t *pending_write; // responses not yet handed to uv_write
+  size_t write_bytes;         // handed to uv_write, not yet completed
+  size_t memory_accounted;    // this connection's share of memory_used
+  bool coalesce_writes;       // true while a read batch is being processed
+  bool shutting_down;         // closing once queued writes have drained
+  uint32_t paused_by;         // enum client_pause_reason
+  // Timeouts: the wheel entry is armed for the earlier of the two deadlines,
+  // and only moved when a partial message brings its deadline forward.
+  jsonrpc_timer_t timeout;
+  uint64_t last_activity;  // uv_now of the last read or completed write
+  jsonrpc_partial_clock_t partial; // uv_now when the partial message began
 } client_ctx_t;
 
 static jsonrpc_callbacks_t g_callbacks = {.on_open = nullptr,
@@ -57,22 +221,336 @@ void server_set_callbacks(jsonrpc_callbacks_t callbacks) {
   g_callbacks = callbacks;
 }
 
+static void workers_lock_init() { (void)uv_mutex_init(&g_workers_lock); }
+
 void server_request_shutdown() {
-  if (g_loop == nullptr) {
+  uv_once(&g_workers_lock_once, workers_lock_init);
+  uv_mutex_lock(&g_workers_lock);
+  if (g_workers != nullptr) {
+    atomic_store(&g_shutdown_requested, true);
+    for (uint32_t i = 0U; i < g_worker_count; ++i) {
+      if (g_workers[i].loop_ready) {
+        (void)uv_async_send(&g_workers[i].stop_async);
+      }
+    }
+  }
+  uv_mutex_unlock(&g_workers_lock);
+}
+
+[[nodiscard]] jsonrpc_callbacks_t server_get_callbacks() { return g_callbacks; }
+
+size_t server_memory_usage() { return atomic_load(&g_memory_used); }
+
+void server_get_stats(server_stats_t *stats) {
+  if (stats == nullptr) {
     return;
   }
+  stats->connections = atomic_load(&g_connection_count);
+  stats->memory_used = atomic_load(&g_memory_used);
+  stats->memory_budget_bytes = g_memory_budget;
+  stats->memory_paused = atomic_load(&g_memory_paused_count);
+  stats->write_queue_high_bytes = g_write_queue.high;
+  stats->write_queue_low_bytes = g_write_queue.low;
+  stats->write_paused = atomic_load(&g_write_paused_count);
+  stats->write_pauses = atomic_load(&g_write_pauses);
+  stats->idle_timeouts = atomic_load(&g_idle_timeouts);
+  stats->message_timeouts = atomic_load(&g_message_timeouts);
+  stats->max_connections = g_admission.max_connections;
+  stats->connections_shed = atomic_load(&g_connections_shed);
+  stats->accept_pauses = atomic_load(&g_accept_pauses);
+  uring_server_add_stats(stats);
+}
 
-  g_shutdown_requested = true;
-  uv_stop(g_loop);
-  uv_walk(g_loop, close_handle, nullptr);
+static void on_uv_alloc(uv_handle_t *handle, size_t suggested_size,
+                        uv_buf_t *buf);
+static void on_uv_read(uv_stream_t *stream, ssize_t nread,
+                       const uv_buf_t *buf);
+
+static void client_count_pause(client_ctx_t *ctx, uint32_t reason,
+                               bool paused) {
+  if (reason == CLIENT_PAUSE_MEMORY) {
+    if (paused) {
+      ctx->worker->memory_paused_count += 1U;
+      (void)atomic_fetch_add(&g_memory_paused_count, 1U);
+    } else {
+      ctx->worker->memory_paused_count -= 1U;
+      (void)atomic_fetch_sub(&g_memory_paused_count, 1U);
+    }
+  } else if (reason != CLIENT_PAUSE_WRITE_QUEUE) {
+    return;
+  } else if (paused) {
+    (void)atomic_fetch_add(&g_write_paused_count, 1U);
+    (void)atomic_fetch_add(&g_write_pauses, 1U);
+  } else {
+    (void)atomic_fetch_sub(&g_write_paused_count, 1U);
+  }
 }
 
-[[nodiscard]] jsonrpc_callbacks_t server_get_callbacks() { return g_callbacks; }
+static void client_pause_reads(client_ctx_t *ctx, uint32_t reason) {
+  if ((ctx->paused_by & reason) != 0U ||
+      uv_is_closing(&ctx->io.handle)) {
+    return;
+  }
+  if (ctx->paused_by == 0U) {
+    (void)uv_read_stop(&ctx->io.stream);
+  }
+  ctx->paused_by |= reason;
+  client_count_pause(ctx, reason, true);
+}
+
+static void client_resume_reads(client_ctx_t *ctx, uint32_t reason) {
+  if ((ctx->paused_by & reason) == 0U) {
+    return;
+  }
+  ctx->paused_by &= ~reason;
+  client_count_pause(ctx, reason, false);
+  if (ctx->paused_by != 0U || uv_is_closing(&ctx->io.handle) ||
+      ctx->shutting_down) {
+    return;
+  }
+  const int read_status =
+      uv_read_start(&ctx->io.stream, on_uv_alloc, on_uv_read);
+  if (read_status != 0) {
+    fprintf(stderr, "uv_read_start failed: %s\n", uv_strerror(read_status));
+    transport_close(&ctx->transport);
+  }
+}
+
+[[nodiscard]] static size_t client_memory_usage(const client_ctx_t *ctx) {
+  size_t bytes = sizeof(client_ctx_t) + ctx->read_capacity + ctx->write_bytes;
+  if (ctx->pending_write != nullptr) {
+    bytes += sizeof(write_ctx_t) + ctx->pending_write->cap;
+  }
+  return bytes + jsonrpc_conn_memory_usage(ctx->rpc);
+}
+
+static void client_set_memory(client_ctx_t *ctx, size_t bytes) {
+  server_worker_t *worker = ctx->worker;
+  if (bytes >= ctx->memory_accounted) {
+    const size_t grown = bytes - ctx->memory_accounted;
+    worker->memory_used += grown;
+    (void)atomic_fetch_add(&g_memory_used, grown);
+  } else {
+    const size_t shrunk = ctx->memory_accounted - bytes;
+    worker->memory_used -= shrunk;
+    (void)atomic_fetch_sub(&g_memory_used, shrunk);
+  }
+  ctx->memory_accounted = bytes;
+}
+
+/**
+ * @brief Stop reading for the memory budget and give back what the connection
+ * holds without using: its read buffer, an empty write batch and the idle
+ * parts of its protocol state. Pausing alone would free nothing.
+ */
+static void client_pause_for_memory(client_ctx_t *ctx) {
+  client_pause_reads(ctx, CLIENT_PAUSE_MEMORY);
+  if ((ctx->paused_by & CLIENT_PAUSE_MEMORY) == 0U) {
+    return;
+  }
+  if (ctx->read_capacity == READ_CHUNK_MAX) {
+    jsonrpc_pool_put(&ctx->worker->read_pool, ctx->read_buffer);
+  } else {
+    free(ctx->read_buffer);
+  }
+  ctx->read_buffer = nullptr;
+  ctx->read_capacity = 0U;
+  if (ctx->pending_write != nullptr && ctx->pending_write->len == 0U) {
+    free(ctx->pending_write);
+    ctx->pending_write = nullptr;
+  }
+  jsonrpc_conn_trim(ctx->rpc);
+  client_set_memory(ctx, client_memory_usage(ctx));
+}
+
+/**
+ * @brief Refresh the connection's share of the memory totals. Over budget, a
+ * connection at or above its loop's average stops reading once it is between
+ * messages, so a partial one is not held until the budget recovers; the
+ * memory timer takes care of the rest.
+ */
+static void client_account(client_ctx_t *ctx) {
+  const size_t usage = client_memory_usage(ctx);
+  client_set_memory(ctx, usage);
+  if (g_memory_budget == 0U || (ctx->paused_by & CLIENT_PAUSE_MEMORY) != 0U ||
+      atomic_load(&g_memory_used) <= g_memory_budget ||
+      jsonrpc_conn_pending_input(ctx->rpc) != 0U) {
+    return;
+  }
+  const server_worker_t *worker = ctx->worker;
+  if (usage >= worker->memory_used / worker->client_count) {
+    client_pause_for_memory(ctx);
+  }
+}
+
+/**
+ * @brief Stop reading from a peer that lets more than the high watermark of
+ * responses pile up in libuv's write queue; read again once it drains below
+ * the low watermark.
+ */
+static void client_check_write_queue(client_ctx_t *ctx) {
+  const size_t queued = uv_stream_get_write_queue_size(&ctx->io.stream);
+  switch (jsonrpc_watermarks_check(
+      &g_write_queue, queued,
+      (ctx->paused_by & CLIENT_PAUSE_WRITE_QUEUE) != 0U)) {
+  case JSONRPC_WATERMARK_PAUSE:
+    client_pause_reads(ctx, CLIENT_PAUSE_WRITE_QUEUE);
+    break;
+  case JSONRPC_WATERMARK_RESUME:
+    client_resume_reads(ctx, CLIENT_PAUSE_WRITE_QUEUE);
+    break;
+  case JSONRPC_WATERMARK_HOLD:
+    break;
+  }
+}
+
+static bool client_timeouts_enabled() {
+  return g_idle_timeout_ms != 0U || g_message_timeout_ms != 0U;
+}
+
+static void client_arm_timeout(client_ctx_t *ctx) {
+  uint64_t deadline = UINT64_MAX;
+  if (g_idle_timeout_ms != 0U) {
+    deadline = ctx->last_activity + g_idle_timeout_ms;
+  }
+  if (g_message_timeout_ms != 0U && ctx->partial.pending &&
+      ctx->partial.since + g_message_timeout_ms < deadline) {
+    deadline = ctx->partial.since + g_message_timeout_ms;
+  }
+  if (deadline == UINT64_MAX) {
+    jsonrpc_timer_wheel_cancel(&ctx->worker->timeouts, &ctx->timeout);
+  } else {
+    jsonrpc_timer_wheel_schedule(&ctx->worker->timeouts, &ctx->timeout,
+                                 deadline);
+  }
+}
+
+/**
+ * @brief Record that bytes moved on the connection. Called on every read, so
+ * it only touches the wheel when a new partial message needs an earlier
+ * deadline; a timer left early or late re-arms itself when it fires. A read
+ * that completes a message and leaves another partial one restarts the
+ * message clock.
+ */
+static void client_note_activity(client_ctx_t *ctx) {
+  if (!client_timeouts_enabled() || ctx->shutting_down) {
+    return;
+  }
+  const uint64_t now = uv_now(ctx->worker->loop);
+  ctx->last_activity = now;
+  const uint64_t completed = jsonrpc_conn_messages_completed(ctx->rpc);
+  if (!jsonrpc_partial_clock_update(&ctx->partial, now,
+                                    jsonrpc_conn_pending_input(ctx->rpc),
+                                    completed)) {
+    return;
+  }
+  if (g_message_timeout_ms != 0U &&
+      (!ctx->timeout.armed ||
+       now + g_message_timeout_ms < ctx->timeout.deadline)) {
+    client_arm_timeout(ctx);
+  }
+}
+
+static void on_client_timeout(jsonrpc_timer_t *timer) {
+  auto ctx = (client_ctx_t *)timer->data;
+  if (uv_is_closing(&ctx->io.handle)) {
+    return;
+  }
+  // The drain deadline of a closing connection passed: stop waiting for the
+  // peer to take its writes.
+  if (ctx->shutting_down) {
+    transport_close(&ctx->transport);
+    return;
+  }
+  const uint64_t now = uv_now(ctx->worker->loop);
+  // Reads paused for the budget or requests still being handled hold the
+  // connection up on our side; restart its clocks instead of closing it.
+  const bool server_side = (ctx->paused_by & CLIENT_PAUSE_MEMORY) != 0U ||
+                           jsonrpc_conn_has_deferred(ctx->rpc);
+  if (g_message_timeout_ms != 0U && ctx->partial.pending &&
+      now >= ctx->partial.since + g_message_timeout_ms) {
+    if (!server_side) {
+      (void)atomic_fetch_add(&g_message_timeouts, 1U);
+      transport_close(&ctx->transport);
+      return;
+    }
+    ctx->partial.since = now;
+  }
+  if (g_idle_timeout_ms != 0U &&
+      now >= ctx->last_activity + g_idle_timeout_ms) {
+    if (!server_side) {
+      (void)atomic_fetch_add(&g_idle_timeouts, 1U);
+      transport_close(&ctx->transport);
+      return;
+    }
+    ctx->last_activity = now;
+  }
+  client_arm_timeout(ctx);
+}
+
+static void on_timeout_tick(uv_timer_t *handle) {
+  auto worker = (server_worker_t *)handle->data;
+  (void)jsonrpc_timer_wheel_advance(&worker->timeouts, uv_now(worker->loop));
+}
+
+/**
+ * @brief Over budget, pause the heaviest connection still reading; at or
+ * below the resume mark, let every paused one read again. In between, a loop
+ * never sits with no connection reading: the lightest connection paused only
+ * for memory is resumed, so the loop keeps finishing requests and freeing
+ * memory even when other loops hold the budget.
+ */
+static void on_memory_check(uv_timer_t *handle) {
+  auto worker = (server_worker_t *)handle->data;
+  const size_t used = atomic_load(&g_memory_used);
+  if (used <= g_memory_resume) {
+    if (worker->memory_paused_count != 0U) {
+      for (client_ctx_t *ctx = worker->clients; ctx != nullptr;
+           ctx = ctx->next) {
+        client_resume_reads(ctx, CLIENT_PAUSE_MEMORY);
+      }
+    }
+    return;
+  }
+
+  size_t reading = 0U;
+  client_ctx_t *heaviest = nullptr;
+  client_ctx_t *lightest = nullptr;
+  for (client_ctx_t *ctx = worker->clients; ctx != nullptr; ctx = ctx->next) {
+    if (ctx->paused_by == 0U && !ctx->shutting_down) {
+      reading += 1U;
+      if (jsonrpc_conn_pending_input(ctx->rpc) == 0U &&
+          (heaviest == nullptr ||
+           ctx->memory_accounted > heaviest->memory_accounted)) {
+        heaviest = ctx;
+      }
+    } else if (ctx->paused_by == CLIENT_PAUSE_MEMORY &&
+               (lightest == nullptr ||
+                ctx->memory_accounted < lightest->memory_accounted)) {
+      lightest = ctx;
+    }
+  }
+  if (reading == 0U) {
+    if (lightest != nullptr) {
+      client_resume_reads(lightest, CLIENT_PAUSE_MEMORY);
+    }
+  } else if (used > g_memory_budget && reading > 1U && heaviest != nullptr) {
+    client_pause_for_memory(heaviest);
+  }
+}
 
 static void on_uv_write(uv_write_t *req, int status) {
   auto write_ctx = (write_ctx_t *)req;
   jsonrpc_transport_t *transport =
       write_ctx != nullptr ? write_ctx->transport : nullptr;
+  if (write_ctx != nullptr && transport != nullptr) {
+    // Runs before the handle's close callback, so the context is still live.
+    auto ctx = (client_ctx_t *)transport->user_data;
+    ctx->write_bytes -= sizeof(write_ctx_t) + write_ctx->cap;
+    client_account(ctx);
+    client_check_write_queue(ctx);
+    client_note_activity(ctx);
+  }
   free(write_ctx);
 
   if (status < 0 && transport != nullptr && transport->close != nullptr) {
@@ -81,36 +559,173 @@ static void on_uv_write(uv_write_t *req, int status) {
   }
 }
 
+[[nodiscard]] static bool client_flush_writes(client_ctx_t *ctx) {
+  write_ctx_t *write_ctx = ctx->pending_write;
+  if (write_ctx == nullptr) {
+    return true;
+  }
+  ctx->pending_write = nullptr;
+
+  if (uv_is_closing(&ctx->io.handle)) {
+    free(write_ctx);
+    return false;
+  }
+
+  uv_buf_t buf =
+      uv_buf_init((char *)write_ctx->data + write_ctx->start,
+                  (unsigned int)(write_ctx->len - write_ctx->start));
+  const int write_status =
+      uv_write(&write_ctx->req, &ctx->io.stream, &buf, 1, on_uv_write);
+  if (write_status != 0) {
+    fprintf(stderr, "uv_write failed: %s\n", uv_strerror(write_status));
+    free(write_ctx);
+    transport_close(&ctx->transport);
+    return false;
+  }
+  ctx->write_bytes += sizeof(write_ctx_t) + write_ctx->cap;
+  client_check_write_queue(ctx);
+  return true;
+}
+
+/**
+ * @brief Make room for min_len bytes past the committed tail of the pending
+ * batch. Growing copies the whole old buffer, so bytes written into an earlier
+ * uncommitted reservation survive.
+ */
+[[nodiscard]] static uint8_t *client_reserve_write(client_ctx_t *ctx,
+                                                   size_t min_len,
+                                                   size_t *out_cap) {
+  write_ctx_t *pending = ctx->pending_write;
+  const size_t pending_len = pending != nullptr ? pending->len : 0U;
+  if (min_len > (size_t)UINT_MAX - pending_len) {
+    return nullptr;
+  }
+
+  const size_t required = pending_len + min_len;
+  if (pending == nullptr || required > pending->cap) {
+    size_t new_cap = required;
+    if (ctx->coalesce_writes && new_cap < READ_CHUNK_MAX) {
+      new_cap = READ_CHUNK_MAX;
+    }
+    if (pending != nullptr && new_cap < pending->cap * 2U &&
+        pending->cap * 2U <= (size_t)UINT_MAX) {
+      new_cap = pending->cap * 2U;
+    }
+    if (new_cap > SIZE_MAX - sizeof(write_ctx_t)) {
+      return nullptr;
+    }
+
+    auto grown = (write_ctx_t *)calloc(1, sizeof(write_ctx_t) + new_cap);
+    if (grown == nullptr) {
+      return nullptr;
+    }
+    grown->transport = &ctx->transport;
+    grown->cap = new_cap;
+    if (pending != nullptr) {
+      memcpy(grown->data, pending->data, pending->cap);
+      grown->start = pending->start;
+      grown->len = pending->len;
+      free(pending);
+    }
+    pending = grown;
+    ctx->pending_write = grown;
+  }
+
+  *out_cap = pending->cap - pending->len;
+  return pending->data + pending->len;
+}
+
+/**
+ * @brief Commit len bytes that start skip bytes past the committed tail. The
+ * gap is closed by moving whichever side is shorter: the responses already
+ * in the batch (nothing, for the first one) or the new bytes.
+ */
+[[nodiscard]] static bool client_commit_write(client_ctx_t *ctx, size_t skip,
+                                              size_t len) {
+  write_ctx_t *pending = ctx->pending_write;
+  if (pending == nullptr || skip > pending->cap - pending->len ||
+      len > pending->cap - pending->len - skip) {
+    return false;
+  }
+  const size_t batched = pending->len - pending->start;
+  if (skip == 0U) {
+    pending->len += len;
+  } else if (batched <= len) {
+    memmove(pending->data + pending->start + skip,
+            pending->data + pending->start, batched);
+    pending->start += skip;
+    pending->len += skip + len;
+  } else {
+    memmove(pending->data + pending->len, pending->data + pending->len + skip,
+            len);
+    pending->len += len;
+  }
+
+  if (!ctx->coalesce_writes ||
+      pending->len - pending->start >= WRITE_BATCH_MAX_BYTES) {
+    return client_flush_writes(ctx);
+  }
+  return true;
+}
+
+[[nodiscard]] static uint8_t *transport_reserve(jsonrpc_transport_t *self,
+                                                size_t min_len,
+                                                size_t *out_cap) {
+  if (self == nullptr || out_cap == nullptr || min_len == 0U) {
+    return nullptr;
+  }
+  auto ctx = (client_ctx_t *)self->user_data;
+  if (ctx == nullptr || uv_is_closing(&ctx->io.handle) ||
+      ctx->shutting_down) {
+    return nullptr;
+  }
+  return client_reserve_write(ctx, min_len, out_cap);
+}
+
+[[nodiscard]] static bool transport_commit(jsonrpc_transport_t *self,
+                                           size_t skip, size_t len) {
+  if (self == nullptr || len == 0U) {
+    return false;
+  }
+  auto ctx = (client_ctx_t *)self->user_data;
+  if (ctx == nullptr || uv_is_closing(&ctx->io.handle) ||
+      ctx->shutting_down) {
+    return false;
+  }
+  if (!client_commit_write(ctx, skip, len)) {
+    transport_close(self);
+    return false;
+  }
+  return true;
+}
+
 [[nodiscard]] static bool transport_send_raw(jsonrpc_transport_t *self,
                                              const uint8_t *data, size_t len) {
   if (self == nullptr || data == nullptr || len == 0U) {
     return false;
   }
   auto ctx = (client_ctx_t *)self->user_data;
-  if (ctx == nullptr || uv_is_closing((uv_handle_t *)&ctx->tcp)) {
+  if (ctx == nullptr || uv_is_closing(&ctx->io.handle) ||
+      ctx->shutting_down) {
     return false;
   }
 
-  if (len > (size_t)UINT_MAX || len > SIZE_MAX - sizeof(write_ctx_t)) {
-    transport_close(self);
-    return false;
+  size_t cap = 0U;
+  uint8_t *region = client_reserve_write(ctx, len, &cap);
+  if (region == nullptr && ctx->pending_write != nullptr) {
+    // The batch cannot take len more bytes; send it and start a fresh one.
+    if (!client_flush_writes(ctx)) {
+      return false;
+    }
+    region = client_reserve_write(ctx, len, &cap);
   }
-  const size_t alloc_size = sizeof(write_ctx_t) + len;
-  auto write_ctx = (write_ctx_t *)calloc(1, alloc_size);
-  if (write_ctx == nullptr) {
+  if (region == nullptr) {
     transport_close(self);
     return false;
   }
-  write_ctx->transport = &ctx->transport;
-
-  memcpy(write_ctx->data, data, len);
 
-  uv_buf_t buf = uv_buf_init((char *)write_ctx->data, (unsigned int)len);
-  const int write_status =
-      uv_write(&write_ctx->req, (uv_stream_t *)&ctx->tcp, &buf, 1, on_uv_write);
-  if (write_status != 0) {
-    fprintf(stderr, "uv_write failed: %s\n", uv_strerror(write_status));
-    free(write_ctx);
+  memcpy(region, data, len);
+  if (!client_commit_write(ctx, 0U, len)) {
     transport_close(self);
     return false;
   }
@@ -128,12 +743,51 @@ static void on_uv_client_closed(uv_handle_t *handle) {
   }
 
   handle->data = nullptr;
+  server_worker_t *worker = ctx->worker;
+  jsonrpc_timer_wheel_cancel(&worker->timeouts, &ctx->timeout);
+  client_set_memory(ctx, 0U);
+  if ((ctx->paused_by & CLIENT_PAUSE_MEMORY) != 0U) {
+    client_count_pause(ctx, CLIENT_PAUSE_MEMORY, false);
+  }
+  if ((ctx->paused_by & CLIENT_PAUSE_WRITE_QUEUE) != 0U) {
+    client_count_pause(ctx, CLIENT_PAUSE_WRITE_QUEUE, false);
+  }
+  (void)atomic_fetch_sub(&g_connection_count, 1U);
+  if (ctx->prev != nullptr) {
+    ctx->prev->next = ctx->next;
+  } else {
+    worker->clients = ctx->next;
+  }
+  if (ctx->next != nullptr) {
+    ctx->next->prev = ctx->prev;
+  }
+  worker->client_count -= 1U;
   if (ctx->rpc != nullptr) {
+    Arena *arena = jsonrpc_conn_take_arena(ctx->rpc);
     jsonrpc_conn_free(ctx->rpc);
     ctx->rpc = nullptr;
+    if (arena != nullptr && arena->size > POOL_ARENA_MAX_BYTES) {
+      arena_destroy(arena);
+    } else if (arena != nullptr) {
+      jsonrpc_pool_put(&worker->arena_pool, arena);
+    }
+  }
+  free(ctx->pending_write);
+  if (ctx->read_capacity == READ_CHUNK_MAX) {
+    jsonrpc_pool_put(&worker->read_pool, ctx->read_buffer);
+  } else {
+    free(ctx->read_buffer);
+  }
+  jsonrpc_pool_put(&worker->ctx_pool, ctx);
+}
+
+static void on_uv_client_shutdown(uv_shutdown_t *req,
+                                  int status [[maybe_unused]]) {
+  uv_stream_t *stream = req->handle;
+  free(req);
+  if (!uv_is_closing((uv_handle_t *)stream)) {
+    uv_close((uv_handle_t *)stream, on_uv_client_closed);
   }
-  free(ctx->read_buffer);
-  free(ctx);
 }
 
 static void transport_close(jsonrpc_transport_t *self) {
@@ -142,9 +796,44 @@ static void transport_close(jsonrpc_transport_t *self) {
   }
 
   auto ctx = (client_ctx_t *)self->user_data;
-  if (!uv_is_closing((uv_handle_t *)&ctx->tcp)) {
-    uv_close((uv_handle_t *)&ctx->tcp, on_uv_client_closed);
+  if (uv_is_closing(&ctx->io.handle)) {
+    return;
   }
+  // A response explaining the close (an HTTP error, Connection: close) may
+  // still be queued: stop reading and let the writes drain before closing,
+  // for at most CLOSE_DRAIN_MS. A peer already behind the write-queue high
+  // mark is not waited for, nor is a second close from a failed write or a
+  // timeout.
+  if (!ctx->shutting_down) {
+    ctx->shutting_down = true;
+    (void)uv_read_stop(&ctx->io.stream);
+    if (client_flush_writes(ctx) && ctx->write_bytes != 0U &&
+        (g_write_queue.high == 0U ||
+         uv_stream_get_write_queue_size(&ctx->io.stream) <=
+             g_write_queue.high)) {
+      uv_shutdown_t *req = calloc(1U, sizeof(*req));
+      if (req != nullptr &&
+          uv_shutdown(req, &ctx->io.stream, on_uv_client_shutdown) == 0) {
+        jsonrpc_timer_wheel_schedule(&ctx->worker->timeouts, &ctx->timeout,
+                                     uv_now(ctx->worker->loop) +
+                                         CLOSE_DRAIN_MS);
+        return;
+      }
+      free(req);
+    }
+    if (uv_is_closing(&ctx->io.handle)) {
+      return;
+    }
+  }
+  uv_close(&ctx->io.handle, on_uv_client_closed);
+}
+
+static void transport_pause_reads(jsonrpc_transport_t *self) {
+  client_pause_reads((client_ctx_t *)self->user_data, CLIENT_PAUSE_DEFERRED);
+}
+
+static void transport_resume_reads(jsonrpc_transport_t *self) {
+  client_resume_reads((client_ctx_t *)self->user_data, CLIENT_PAUSE_DEFERRED);
 }
 
 static void on_uv_alloc(uv_handle_t *handle, size_t suggested_size,
@@ -155,6 +844,15 @@ static void on_uv_alloc(uv_handle_t *handle, size_t suggested_size,
     buf->len = 0U;
     return;
   }
+  if (ctx->worker->read_slab != nullptr) {
+    buf->base = (char *)ctx->worker->read_slab;
+    buf->len = (unsigned int)READ_SLAB_BYTES;
+    return;
+  }
+  if (ctx->read_buffer == nullptr && suggested_size >= READ_CHUNK_MAX) {
+    ctx->read_buffer = (uint8_t *)jsonrpc_pool_get(&ctx->worker->read_pool);
+    ctx->read_capacity = ctx->read_buffer == nullptr ? 0U : READ_CHUNK_MAX;
+  }
   if (ctx->read_buffer == nullptr) {
     size_t alloc_size = suggested_size;
     if (alloc_size < READ_CHUNK_MIN) {
@@ -190,112 +888,788 @@ static void on_uv_read(uv_stream_t *stream, ssize_t nread,
     }
 
     if (ctx->rpc != nullptr) {
+      ctx->coalesce_writes = true;
       jsonrpc_conn_feed(ctx->rpc, (uint8_t *)buf->base, (size_t)nread);
+      ctx->coalesce_writes = false;
+      (void)client_flush_writes(ctx);
+      client_account(ctx);
+      client_note_activity(ctx);
     }
   } else if (nread < 0) {
     ctx->transport.close(&ctx->transport);
   }
 }
 
-static void on_new_connection(uv_stream_t *server, int status) {
-  if (status < 0) {
-    fprintf(stderr, "on_new_connection failed: %s\n", uv_strerror(status));
+static uv_stream_t *server_worker_listener(server_worker_t *worker,
+                                           uint32_t listener) {
+  return listener == SERVER_LISTENER_PIPE ? (uv_stream_t *)&worker->pipe_server
+                                          : (uv_stream_t *)&worker->server;
+}
+
+static int client_stream_init(uv_loop_t *loop, client_stream_t *io,
+                              uint32_t listener) {
+  return listener == SERVER_LISTENER_PIPE ? uv_pipe_init(loop, &io->pipe, 0)
+                                          : uv_tcp_init(loop, &io->tcp);
+}
+
+static jsonrpc_framing_t server_listener_framing(uint32_t listener) {
+  return listener == SERVER_LISTENER_PIPE ? g_unix_framing : g_tcp_framing;
+}
+
+static void on_shed_closed(uv_handle_t *handle) { free(handle); }
+
+/**
+ * @brief Accept a connection over max_connections only to tell the peer why
+ * it is closed. The error goes out with uv_try_write: it fits any fresh
+ * socket buffer, and a peer that cannot take it is not worth a write request.
+ */
+static void server_worker_shed(server_worker_t *worker, uint32_t listener) {
+  auto io = (client_stream_t *)calloc(1, sizeof(client_stream_t));
+  if (io == nullptr || client_stream_init(worker->loop, io, listener) != 0) {
+    free(io);
+    worker->accept_pending |= listener;
     return;
   }
+  if (uv_accept(server_worker_listener(worker, listener), &io->stream) == 0) {
+    const size_t body_len = strlen(SHED_RESPONSE);
+    // A WebSocket client has not been upgraded yet and still reads HTTP.
+    jsonrpc_framing_t framing = server_listener_framing(listener);
+    if (framing == JSONRPC_FRAMING_WEBSOCKET) {
+      framing = JSONRPC_FRAMING_HTTP;
+    }
+    uint8_t header[JSONRPC_FRAME_HEADER_MAX];
+    const size_t header_len = jsonrpc_frame_header(framing, body_len, header);
+    const uv_buf_t bufs[] = {
+        uv_buf_init((char *)header, (unsigned int)header_len),
+        uv_buf_init((char *)SHED_RESPONSE, (unsigned int)body_len),
+        uv_buf_init((char *)"\n", header_len == 0U ? 1U : 0U),
+    };
+    (void)uv_try_write(&io->stream, bufs, 3U);
+    (void)atomic_fetch_add(&g_connections_shed, 1U);
+  }
+  uv_close(&io->handle, on_shed_closed);
+}
 
-  auto ctx = (client_ctx_t *)calloc(1, sizeof(client_ctx_t));
+/**
+ * @brief Set up a client for the admitted connection waiting on the listener.
+ */
+static void server_worker_admit(server_worker_t *worker, uint32_t listener) {
+  auto server = server_worker_listener(worker, listener);
+  auto ctx = (client_ctx_t *)jsonrpc_pool_get(&worker->ctx_pool);
+  if (ctx != nullptr) {
+    memset(ctx, 0, sizeof(client_ctx_t));
+  } else {
+    ctx = (client_ctx_t *)calloc(1, sizeof(client_ctx_t));
+  }
   if (ctx == nullptr) {
+    (void)atomic_fetch_sub(&g_connection_count, 1U);
+    worker->accept_pending |= listener;
     return;
   }
 
-  const int init_status = uv_tcp_init(server->loop, &ctx->tcp);
+  const int init_status = client_stream_init(worker->loop, &ctx->io, listener);
   if (init_status != 0) {
-    fprintf(stderr, "uv_tcp_init failed: %s\n", uv_strerror(init_status));
-    free(ctx);
+    fprintf(stderr, "Client handle init failed: %s\n",
+            uv_strerror(init_status));
+    jsonrpc_pool_put(&worker->ctx_pool, ctx);
+    (void)atomic_fetch_sub(&g_connection_count, 1U);
+    worker->accept_pending |= listener;
     return;
   }
-  ctx->tcp.data = ctx;
+  ctx->io.handle.data = ctx;
+  ctx->worker = worker;
+  ctx->next = worker->clients;
+  if (worker->clients != nullptr) {
+    worker->clients->prev = ctx;
+  }
+  worker->clients = ctx;
+  worker->client_count += 1U;
 
-  if (uv_accept(server, (uv_stream_t *)&ctx->tcp) == 0) {
+  if (uv_accept(server, &ctx->io.stream) == 0) {
     ctx->transport.user_data = ctx;
     ctx->transport.send_raw = transport_send_raw;
     ctx->transport.close = transport_close;
+    ctx->transport.reserve = transport_reserve;
+    ctx->transport.commit = transport_commit;
+    ctx->transport.pause_reads = transport_pause_reads;
+    ctx->transport.resume_reads = transport_resume_reads;
 
     ctx->rpc =
         jsonrpc_conn_new(ctx->transport, server_get_callbacks(), nullptr);
-    if (ctx->rpc == nullptr) {
+    const jsonrpc_framing_t framing = server_listener_framing(listener);
+    if (ctx->rpc == nullptr ||
+        !jsonrpc_conn_set_framing(ctx->rpc, framing, g_max_framed_message) ||
+        (g_msgpack && framing != JSONRPC_FRAMING_NEWLINE &&
+         !jsonrpc_conn_allow_msgpack(ctx->rpc))) {
       transport_close(&ctx->transport);
       return;
     }
+    jsonrpc_conn_set_shared_reads(ctx->rpc, worker->read_slab != nullptr);
+    Arena *arena = (Arena *)jsonrpc_pool_get(&worker->arena_pool);
+    if (arena != nullptr && !jsonrpc_conn_set_arena(ctx->rpc, arena)) {
+      jsonrpc_pool_put(&worker->arena_pool, arena);
+    }
 
     const int read_status =
-        uv_read_start((uv_stream_t *)&ctx->tcp, on_uv_alloc, on_uv_read);
+        uv_read_start(&ctx->io.stream, on_uv_alloc, on_uv_read);
     if (read_status != 0) {
       fprintf(stderr, "uv_read_start failed: %s\n", uv_strerror(read_status));
       transport_close(&ctx->transport);
+      return;
+    }
+    client_account(ctx);
+    jsonrpc_timer_init(&ctx->timeout, on_client_timeout, ctx);
+    if (client_timeouts_enabled()) {
+      ctx->last_activity = uv_now(worker->loop);
+      client_arm_timeout(ctx);
     }
   } else {
-    uv_close((uv_handle_t *)&ctx->tcp, on_uv_client_closed);
+    uv_close(&ctx->io.handle, on_uv_client_closed);
   }
 }
 
-void start_jsonrpc_server(int32_t port, jsonrpc_callbacks_t callbacks) {
-  server_set_callbacks(callbacks);
+/**
+ * @brief Take the connection waiting on the listener, or leave it queued when
+ * this iteration's accept budget is spent or the server is at
+ * max_connections in SERVER_SHED_PAUSE mode.
+ */
+static void server_worker_accept(server_worker_t *worker, uint32_t listener) {
+  const size_t open = atomic_fetch_add(&g_connection_count, 1U);
+  const jsonrpc_admit_action_t action =
+      jsonrpc_admission_check(&g_admission, worker->accepts_this_tick, open);
+  if (action != JSONRPC_ADMIT_ACCEPT) {
+    (void)atomic_fetch_sub(&g_connection_count, 1U);
+  }
+  switch (action) {
+  case JSONRPC_ADMIT_DEFER:
+    worker->accept_pending |= listener;
+    return;
+  case JSONRPC_ADMIT_SHED:
+    worker->accepts_this_tick += 1U;
+    server_worker_shed(worker, listener);
+    return;
+  case JSONRPC_ADMIT_PAUSE:
+    worker->accept_pending |= listener;
+    if (!worker->listener_paused) {
+      worker->listener_paused = true;
+      (void)atomic_fetch_add(&g_accept_pauses, 1U);
+      (void)uv_timer_start(&worker->accept_retry_timer, on_accept_retry,
+                           ACCEPT_RETRY_MS, ACCEPT_RETRY_MS);
+    }
+    return;
+  case JSONRPC_ADMIT_ACCEPT:
+    break;
+  }
+  if (worker->listener_paused) {
+    worker->listener_paused = false;
+    (void)uv_timer_stop(&worker->accept_retry_timer);
+  }
+  worker->accepts_this_tick += 1U;
+  server_worker_admit(worker, listener);
+}
 
-  // Ignore SIGPIPE so a peer hangup does not terminate the process mid-write.
-  (void)signal(SIGPIPE, SIG_IGN);
+static void server_worker_resume_accept(server_worker_t *worker) {
+  const uint32_t pending = worker->accept_pending;
+  worker->accept_pending = 0U;
+  if ((pending & SERVER_LISTENER_TCP) != 0U) {
+    server_worker_accept(worker, SERVER_LISTENER_TCP);
+  }
+  if ((pending & SERVER_LISTENER_PIPE) != 0U) {
+    server_worker_accept(worker, SERVER_LISTENER_PIPE);
+  }
+}
+
+static void on_accept_check(uv_check_t *handle) {
+  auto worker = (server_worker_t *)handle->data;
+  worker->accepts_this_tick = 0U;
+  server_worker_resume_accept(worker);
+}
+
+static void on_accept_retry(uv_timer_t *handle) {
+  server_worker_resume_accept((server_worker_t *)handle->data);
+}
+
+static void on_new_connection(uv_stream_t *server, int status) {
+  if (status < 0) {
+    fprintf(stderr, "on_new_connection failed: %s\n", uv_strerror(status));
+    return;
+  }
+  auto worker = (server_worker_t *)server->loop->data;
+  server_worker_accept(worker, server == (uv_stream_t *)&worker->pipe_server
+                                   ? SERVER_LISTENER_PIPE
+                                   : SERVER_LISTENER_TCP);
+}
+
+/**
+ * @brief A JSONRPC_METHOD_BLOCKING request running on the libuv thread pool.
+ * The handler runs in on_offload_work; on_offload_done runs back on the
+ * owning loop and completes the deferred request there.
+ */
+typedef struct {
+  uv_work_t req;
+  jsonrpc_request_handle_t *handle;
+  jsonrpc_method_t method;
+  jsonrpc_response_t response;
+  bool handled;
+} offload_job_t;
+
+static void on_offload_work(uv_work_t *req) {
+  auto job = (offload_job_t *)req;
+  // Parson allocations here come from the heap: the connection arena is only
+  // ever current on the loop thread.
+  job->handled = job->method.handler(
+      nullptr, jsonrpc_request_handle_params(job->handle), &job->response,
+      job->method.user_data);
+}
+
+static void on_offload_done(uv_work_t *req, int status) {
+  auto job = (offload_job_t *)req;
+  if (status != 0) {
+    job->handled = true;
+    job->response.error_code = JSONRPC_ERR_INTERNAL;
+    job->response.error_message = "Request cancelled";
+  }
+  (void)jsonrpc_request_complete_response(job->handle, job->handled,
+                                          &job->response);
+  free(job);
+}
+
+static bool server_offload_request(jsonrpc_conn_t *conn [[maybe_unused]],
+                                   const jsonrpc_method_t *method,
+                                   jsonrpc_request_handle_t *handle) {
+  if (t_worker_loop == nullptr) {
+    return false;
+  }
+  auto job = (offload_job_t *)calloc(1, sizeof(offload_job_t));
+  if (job == nullptr) {
+    return false;
+  }
+  job->handle = handle;
+  job->method = *method;
+  const int status =
+      uv_queue_work(t_worker_loop, &job->req, on_offload_work, on_offload_done);
+  if (status != 0) {
+    fprintf(stderr, "uv_queue_work failed: %s\n", uv_strerror(status));
+    free(job);
+    return false;
+  }
+  return true;
+}
+
+static void pool_release_arena(void *item) { arena_destroy((Arena *)item); }
+
+static void on_pool_trim(uv_timer_t *handle) {
+  auto worker = (server_worker_t *)handle->data;
+  jsonrpc_pool_idle_trim(&worker->ctx_pool);
+  jsonrpc_pool_idle_trim(&worker->read_pool);
+  jsonrpc_pool_idle_trim(&worker->arena_pool);
+}
+
+[[nodiscard]] static bool server_worker_init_pools(
+    server_worker_t *worker, const server_config_t *config) {
+  const size_t high = config->pool_high_water;
+  const size_t low = config->pool_low_water;
+  if (!jsonrpc_pool_init(&worker->ctx_pool, high, low, nullptr) ||
+      !jsonrpc_pool_init(&worker->read_pool, high, low, nullptr) ||
+      !jsonrpc_pool_init(&worker->arena_pool, high, low, pool_release_arena)) {
+    fprintf(stderr, "Failed to allocate connection pools.\n");
+    return false;
+  }
+  if (high == 0U || config->pool_trim_ms == 0U) {
+    return true;
+  }
+
+  const int timer_status = uv_timer_init(worker->loop, &worker->trim_timer);
+  if (timer_status != 0) {
+    fprintf(stderr, "uv_timer_init failed: %s\n", uv_strerror(timer_status));
+    return false;
+  }
+  worker->trim_timer.data = worker;
+  const int start_status =
+      uv_timer_start(&worker->trim_timer, on_pool_trim, config->pool_trim_ms,
+                     config->pool_trim_ms);
+  if (start_status != 0) {
+    fprintf(stderr, "uv_timer_start failed: %s\n", uv_strerror(start_status));
+    return false;
+  }
+  // The trim timer alone must not keep the loop running.
+  uv_unref((uv_handle_t *)&worker->trim_timer);
+  return true;
+}
+
+[[nodiscard]] static bool server_worker_init_admission(
+    server_worker_t *worker) {
+  const int check_status = uv_check_init(worker->loop, &worker->accept_check);
+  if (check_status != 0) {
+    fprintf(stderr, "uv_check_init failed: %s\n", uv_strerror(check_status));
+    return false;
+  }
+  worker->accept_check.data = worker;
+  const int start_status =
+      uv_check_start(&worker->accept_check, on_accept_check);
+  if (start_status != 0) {
+    fprintf(stderr, "uv_check_start failed: %s\n", uv_strerror(start_status));
+    return false;
+  }
+  uv_unref((uv_handle_t *)&worker->accept_check);
+
+  const int timer_status =
+      uv_timer_init(worker->loop, &worker->accept_retry_timer);
+  if (timer_status != 0) {
+    fprintf(stderr, "uv_timer_init failed: %s\n", uv_strerror(timer_status));
+    return false;
+  }
+  worker->accept_retry_timer.data = worker;
+  uv_unref((uv_handle_t *)&worker->accept_retry_timer);
+  return true;
+}
 
-  g_shutdown_requested = false;
-  g_loop = uv_default_loop();
-  if (g_loop == nullptr) {
-    fprintf(stderr, "uv_default_loop failed.\n");
+static void on_worker_stop(uv_async_t *handle) {
+  auto worker = (server_worker_t *)handle->data;
+  if (worker == nullptr || worker->loop == nullptr) {
     return;
   }
+  // Unpublish the stop handle first, as in server_worker_close, so a
+  // concurrent server_request_shutdown never signals it while it closes.
+  uv_mutex_lock(&g_workers_lock);
+  worker->loop_ready = false;
+  uv_mutex_unlock(&g_workers_lock);
+  uv_stop(worker->loop);
+  uv_walk(worker->loop, close_handle, nullptr);
+}
 
-  int run_status = 0;
-  const int tcp_status = uv_tcp_init(g_loop, &g_server);
+[[nodiscard]] static bool server_worker_listen(server_worker_t *worker,
+                                               const struct sockaddr *addr,
+                                               bool reuse_port) {
+  const int tcp_status =
+      uv_tcp_init_ex(worker->loop, &worker->server, addr->sa_family);
   if (tcp_status != 0) {
     fprintf(stderr, "uv_tcp_init failed: %s\n", uv_strerror(tcp_status));
-    goto cleanup_loop;
+    return false;
   }
 
-  struct sockaddr_in addr;
-  const int addr_status = uv_ip4_addr("0.0.0.0", (int)port, &addr);
-  if (addr_status != 0) {
-    fprintf(stderr, "uv_ip4_addr failed: %s\n", uv_strerror(addr_status));
-    goto cleanup_loop;
+  if (reuse_port) {
+#ifdef SO_REUSEPORT
+    uv_os_fd_t fd;
+    const int fileno_status = uv_fileno((uv_handle_t *)&worker->server, &fd);
+    if (fileno_status != 0) {
+      fprintf(stderr, "uv_fileno failed: %s\n", uv_strerror(fileno_status));
+      return false;
+    }
+    const int enable = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) !=
+        0) {
+      perror("setsockopt(SO_REUSEPORT) failed");
+      return false;
+    }
+#else
+    fprintf(stderr, "SO_REUSEPORT is not supported on this platform.\n");
+    return false;
+#endif
   }
-  const int bind_status =
-      uv_tcp_bind(&g_server, (const struct sockaddr *)&addr, 0);
+
+  const int bind_status = uv_tcp_bind(&worker->server, addr, 0);
   if (bind_status != 0) {
     fprintf(stderr, "uv_tcp_bind failed: %s\n", uv_strerror(bind_status));
-    goto cleanup_loop;
+    return false;
   }
 
-  const int listen_status = uv_listen((uv_stream_t *)&g_server,
+  const int listen_status = uv_listen((uv_stream_t *)&worker->server,
                                       (int)SERVER_BACKLOG, on_new_connection);
   if (listen_status != 0) {
     fprintf(stderr, "uv_listen failed: %s\n", uv_strerror(listen_status));
-    goto cleanup_loop;
+    return false;
   }
+  return true;
+}
 
-  run_status = uv_run(g_loop, UV_RUN_DEFAULT);
-  if (g_shutdown_requested) {
-    // Drain close callbacks to free contexts before exit.
-    run_status = uv_run(g_loop, UV_RUN_DEFAULT);
+/**
+ * @brief Listen on the Unix socket path. The first worker binds it; the others
+ * pass the bound socket's fd and listen on a duplicate of it (Linux has no
+ * SO_REUSEPORT for Unix sockets), so every loop accepts from one queue.
+ */
+/**
+ * @brief Remove a socket file left behind by a previous run, which would make
+ * bind fail. A probe connect tells it apart from one a running server still
+ * accepts on; only a refused probe marks it stale.
+ * @return false if another server is listening on path.
+ */
+[[nodiscard]] static bool server_clear_stale_socket(const char *path) {
+  struct stat info;
+  if (stat(path, &info) != 0 || !S_ISSOCK(info.st_mode)) {
+    return true;
+  }
+  const int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (probe < 0) {
+    perror("socket failed");
+    return false;
+  }
+  struct sockaddr_un addr = {.sun_family = AF_UNIX};
+  // The path length is checked before any worker starts.
+  memcpy(addr.sun_path, path, strlen(path));
+  const int connect_status =
+      connect(probe, (const struct sockaddr *)&addr, sizeof(addr));
+  const int connect_error = errno;
+  (void)close(probe);
+  if (connect_status == 0) {
+    fprintf(stderr, "%s is in use by another server.\n", path);
+    return false;
+  }
+  if (connect_error == ECONNREFUSED) {
+    (void)unlink(path);
+  }
+  return true;
+}
+
+[[nodiscard]] static bool server_worker_listen_pipe(server_worker_t *worker,
+                                                    const char *path,
+                                                    uv_os_fd_t shared_fd) {
+  const int init_status = uv_pipe_init(worker->loop, &worker->pipe_server, 0);
+  if (init_status != 0) {
+    fprintf(stderr, "uv_pipe_init failed: %s\n", uv_strerror(init_status));
+    return false;
+  }
+
+  if (shared_fd < 0) {
+    if (!server_clear_stale_socket(path)) {
+      return false;
+    }
+    const int bind_status = uv_pipe_bind(&worker->pipe_server, path);
+    if (bind_status != 0) {
+      fprintf(stderr, "uv_pipe_bind(%s) failed: %s\n", path,
+              uv_strerror(bind_status));
+      return false;
+    }
+    worker->pipe_bound = true;
+  } else {
+    const int fd = dup(shared_fd);
+    if (fd < 0) {
+      perror("dup failed");
+      return false;
+    }
+    const int open_status = uv_pipe_open(&worker->pipe_server, fd);
+    if (open_status != 0) {
+      fprintf(stderr, "uv_pipe_open failed: %s\n", uv_strerror(open_status));
+      (void)close(fd);
+      return false;
+    }
+  }
+
+  const int listen_status =
+      uv_listen((uv_stream_t *)&worker->pipe_server, (int)SERVER_BACKLOG,
+                on_new_connection);
+  if (listen_status != 0) {
+    fprintf(stderr, "uv_listen(%s) failed: %s\n", path,
+            uv_strerror(listen_status));
+    return false;
+  }
+  return true;
+}
+
+[[nodiscard]] static bool server_worker_init(server_worker_t *worker,
+                                             uint32_t index,
+                                             const server_config_t *config,
+                                             const struct sockaddr *addr,
+                                             bool reuse_port,
+                                             uv_os_fd_t pipe_fd) {
+  worker->index = index;
+  if (index == 0U) {
+    worker->loop = uv_default_loop();
+    if (worker->loop == nullptr) {
+      fprintf(stderr, "uv_default_loop failed.\n");
+      return false;
+    }
+  } else {
+    const int loop_status = uv_loop_init(&worker->private_loop);
+    if (loop_status != 0) {
+      fprintf(stderr, "uv_loop_init failed: %s\n", uv_strerror(loop_status));
+      return false;
+    }
+    worker->loop = &worker->private_loop;
+  }
+
+  const int async_status =
+      uv_async_init(worker->loop, &worker->stop_async, on_worker_stop);
+  if (async_status != 0) {
+    fprintf(stderr, "uv_async_init failed: %s\n", uv_strerror(async_status));
+    return false;
+  }
+  worker->stop_async.data = worker;
+  worker->loop_ready = true;
+  worker->loop->data = worker;
+
+  if (!server_worker_init_pools(worker, config)) {
+    return false;
+  }
+  if (g_memory_budget != 0U) {
+    const int timer_status = uv_timer_init(worker->loop, &worker->memory_timer);
+    if (timer_status != 0) {
+      fprintf(stderr, "uv_timer_init failed: %s\n", uv_strerror(timer_status));
+      return false;
+    }
+    worker->memory_timer.data = worker;
+    const int start_status =
+        uv_timer_start(&worker->memory_timer, on_memory_check,
+                       MEMORY_CHECK_MS, MEMORY_CHECK_MS);
+    if (start_status != 0) {
+      fprintf(stderr, "uv_timer_start failed: %s\n", uv_strerror(start_status));
+      return false;
+    }
+    uv_unref((uv_handle_t *)&worker->memory_timer);
+  }
+  // The wheel also bounds the drain of closing connections, so every loop
+  // has one even with the timeouts off.
+  if (!jsonrpc_timer_wheel_init(&worker->timeouts, TIMEOUT_WHEEL_SLOTS,
+                                TIMEOUT_TICK_MS, uv_now(worker->loop))) {
+    fprintf(stderr, "Failed to allocate the timeout wheel.\n");
+    return false;
   }
+  const int timer_status =
+      uv_timer_init(worker->loop, &worker->timeout_timer);
+  if (timer_status != 0) {
+    fprintf(stderr, "uv_timer_init failed: %s\n", uv_strerror(timer_status));
+    return false;
+  }
+  worker->timeout_timer.data = worker;
+  const int start_status =
+      uv_timer_start(&worker->timeout_timer, on_timeout_tick,
+                     TIMEOUT_TICK_MS, TIMEOUT_TICK_MS);
+  if (start_status != 0) {
+    fprintf(stderr, "uv_timer_start failed: %s\n", uv_strerror(start_status));
+    return false;
+  }
+  uv_unref((uv_handle_t *)&worker->timeout_timer);
+  if (config->shared_read_buffer) {
+    worker->read_slab = (uint8_t *)calloc(READ_SLAB_BYTES, sizeof(uint8_t));
+    if (worker->read_slab == nullptr) {
+      fprintf(stderr, "Failed to allocate the read slab.\n");
+      return false;
+    }
+  }
+  if (!server_worker_init_admission(worker)) {
+    return false;
+  }
+  if (config->backend == SERVER_BACKEND_IO_URING) {
+    worker->uring =
+        uring_server_start(worker->loop, addr, reuse_port, g_tcp_framing,
+                           g_max_framed_message, g_msgpack, g_write_queue);
+    return worker->uring != nullptr;
+  }
+  if (config->listen_tcp && !server_worker_listen(worker, addr, reuse_port)) {
+    return false;
+  }
+  return config->unix_path == nullptr ||
+         server_worker_listen_pipe(worker, config->unix_path, pipe_fd);
+}
 
-cleanup_loop:
-  uv_walk(g_loop, close_handle, nullptr);
-  (void)uv_run(g_loop, UV_RUN_DEFAULT);
+static void server_worker_close(server_worker_t *worker) {
+  if (worker->loop == nullptr) {
+    return;
+  }
 
-  const int loop_status = uv_loop_close(g_loop);
+  // Unpublish the stop handle before it is closed so server_request_shutdown
+  // never signals a handle that is being torn down.
+  uv_mutex_lock(&g_workers_lock);
+  worker->loop_ready = false;
+  uv_mutex_unlock(&g_workers_lock);
+
+  uv_walk(worker->loop, close_handle, nullptr);
+  (void)uv_run(worker->loop, UV_RUN_DEFAULT);
+  uring_server_destroy(worker->uring);
+  worker->uring = nullptr;
+
+  // Every connection has closed now, so the pools hold all that is left.
+  jsonrpc_pool_destroy(&worker->ctx_pool);
+  jsonrpc_pool_destroy(&worker->read_pool);
+  jsonrpc_pool_destroy(&worker->arena_pool);
+  jsonrpc_timer_wheel_destroy(&worker->timeouts);
+  free(worker->read_slab);
+  worker->read_slab = nullptr;
+
+  const int loop_status = uv_loop_close(worker->loop);
   if (loop_status != 0) {
     fprintf(stderr, "uv_loop_close failed: %s\n", uv_strerror(loop_status));
   }
-  g_loop = nullptr;
+  worker->loop->data = nullptr;
+  worker->loop = nullptr;
+}
+
+static void server_worker_run(server_worker_t *worker) {
+  t_worker_loop = worker->loop;
+  int run_status = uv_run(worker->loop, UV_RUN_DEFAULT);
+  if (atomic_load(&g_shutdown_requested)) {
+    // Drain close callbacks to free contexts before exit.
+    run_status = uv_run(worker->loop, UV_RUN_DEFAULT);
+  }
+
+  server_worker_close(worker);
+  t_worker_loop = nullptr;
 
   if (run_status != 0) {
     fprintf(stderr, "uv_run exited with active handles (%d).\n", run_status);
   }
 }
+
+static void server_worker_thread(void *arg) {
+  server_worker_run((server_worker_t *)arg);
+}
+
+void server_config_init(server_config_t *config) {
+  if (config == nullptr) {
+    return;
+  }
+  config->port = 8'080;
+  config->workers = 1U;
+  config->pool_high_water = 1'024U;
+  config->pool_low_water = 64U;
+  config->pool_trim_ms = 10'000U;
+  config->shared_read_buffer = false;
+  config->memory_budget_bytes = 0U;
+  config->memory_resume_bytes = 0U;
+  config->write_queue_high_bytes = 1'048'576U;
+  config->write_queue_low_bytes = 262'144U;
+  config->idle_timeout_ms = 300'000U;
+  config->message_timeout_ms = 30'000U;
+  config->max_connections = 0U;
+  config->shed_mode = SERVER_SHED_REJECT;
+  config->accepts_per_tick = 64U;
+  config->listen_tcp = true;
+  config->unix_path = nullptr;
+  config->backend = SERVER_BACKEND_LIBUV;
+  config->tcp_framing = JSONRPC_FRAMING_NEWLINE;
+  config->unix_framing = JSONRPC_FRAMING_NEWLINE;
+  config->max_framed_message_bytes = 1'048'576U;
+  config->msgpack = false;
+}
+
+void start_jsonrpc_server_with_config(const server_config_t *config,
+                                      jsonrpc_callbacks_t callbacks) {
+  if (config == nullptr) {
+    return;
+  }
+  if (callbacks.offload == nullptr) {
+    callbacks.offload = server_offload_request;
+  }
+  server_set_callbacks(callbacks);
+
+  // Ignore SIGPIPE so a peer hangup does not terminate the process mid-write.
+  (void)signal(SIGPIPE, SIG_IGN);
+
+  const uint32_t worker_count = config->workers == 0U ? 1U : config->workers;
+  if (worker_count > SERVER_MAX_WORKERS) {
+    fprintf(stderr, "Too many workers (%u, max %u).\n", worker_count,
+            SERVER_MAX_WORKERS);
+    return;
+  }
+
+  if (!config->listen_tcp && config->unix_path == nullptr) {
+    fprintf(stderr, "No listener configured (TCP off and no Unix path).\n");
+    return;
+  }
+  constexpr size_t unix_path_max = sizeof(((struct sockaddr_un *)0)->sun_path);
+  if (config->unix_path != nullptr &&
+      strlen(config->unix_path) >= unix_path_max) {
+    fprintf(stderr, "Unix socket path too long: %s\n", config->unix_path);
+    return;
+  }
+  if (config->backend == SERVER_BACKEND_IO_URING &&
+      (!config->listen_tcp || config->unix_path != nullptr)) {
+    fprintf(stderr, "The io_uring backend serves TCP only.\n");
+    return;
+  }
+
+  struct sockaddr_in addr;
+  const int addr_status = uv_ip4_addr("0.0.0.0", (int)config->port, &addr);
+  if (addr_status != 0) {
+    fprintf(stderr, "uv_ip4_addr failed: %s\n", uv_strerror(addr_status));
+    return;
+  }
+
+  auto workers =
+      (server_worker_t *)calloc(worker_count, sizeof(server_worker_t));
+  if (workers == nullptr) {
+    fprintf(stderr, "Failed to allocate %u workers.\n", worker_count);
+    return;
+  }
+
+  uv_once(&g_workers_lock_once, workers_lock_init);
+  atomic_store(&g_shutdown_requested, false);
+  g_memory_budget = config->memory_budget_bytes;
+  g_memory_resume = config->memory_resume_bytes != 0U &&
+                            config->memory_resume_bytes < g_memory_budget
+                        ? config->memory_resume_bytes
+                        : g_memory_budget / 4U * 3U;
+  g_write_queue = jsonrpc_watermarks_make(config->write_queue_high_bytes,
+                                          config->write_queue_low_bytes);
+  g_idle_timeout_ms = config->idle_timeout_ms;
+  g_message_timeout_ms = config->message_timeout_ms;
+  g_admission = (jsonrpc_admission_t){
+      .max_connections = config->max_connections,
+      .accepts_per_tick = config->accepts_per_tick,
+      .pause_at_limit = config->shed_mode == SERVER_SHED_PAUSE};
+  g_tcp_framing = config->tcp_framing;
+  g_unix_framing = config->unix_framing;
+  g_max_framed_message = config->max_framed_message_bytes;
+  g_msgpack = config->msgpack;
+
+  // Loops and listeners are set up here, before any worker thread exists, so
+  // a bind failure on any of them aborts startup as a whole.
+  bool ready = true;
+  uv_os_fd_t pipe_fd = -1;
+  for (uint32_t i = 0U; i < worker_count && ready; ++i) {
+    ready = server_worker_init(&workers[i], i, config,
+                               (const struct sockaddr *)&addr,
+                               worker_count > 1U, pipe_fd);
+    if (ready && i == 0U && config->unix_path != nullptr) {
+      ready = uv_fileno((const uv_handle_t *)&workers[0].pipe_server,
+                        &pipe_fd) == 0;
+    }
+  }
+
+  uv_mutex_lock(&g_workers_lock);
+  g_workers = workers;
+  g_worker_count = worker_count;
+  uv_mutex_unlock(&g_workers_lock);
+
+  for (uint32_t i = 1U; i < worker_count && ready; ++i) {
+    const int thread_status =
+        uv_thread_create(&workers[i].thread, server_worker_thread, &workers[i]);
+    if (thread_status != 0) {
+      fprintf(stderr, "uv_thread_create failed: %s\n",
+              uv_strerror(thread_status));
+      ready = false;
+      break;
+    }
+    workers[i].thread_started = true;
+  }
+
+  if (ready) {
+    server_worker_run(&workers[0]);
+  }
+
+  // Worker 0 returning (or a failed startup) takes the other loops down too.
+  server_request_shutdown();
+  for (uint32_t i = 0U; i < worker_count; ++i) {
+    if (workers[i].thread_started) {
+      (void)uv_thread_join(&workers[i].thread);
+    } else {
+      server_worker_close(&workers[i]);
+    }
+  }
+
+  uv_mutex_lock(&g_workers_lock);
+  g_workers = nullptr;
+  g_worker_count = 0U;
+  uv_mutex_unlock(&g_workers_lock);
+  if (workers[0].pipe_bound) {
+    (void)unlink(config->unix_path);
+  }
+  free(workers);
+}
+
+void start_jsonrpc_server(int32_t port, jsonrpc_callbacks_t callbacks) {
+  server_config_t config;
+  server_config_init(&config);
+  config.port = port;
+  start_jsonrpc_server_with_config(&config, callbacks);
+}
@@ -0,0 +1,147 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "jsonrpc/timer_wheel.h"
+
+bool jsonrpc_timer_wheel_init(jsonrpc_timer_wheel_t *wheel, size_t slot_count,
+                              uint64_t tick_ms, uint64_t now_ms) {
+  if (wheel == nullptr) {
+    return false;
+  }
+  *wheel = (jsonrpc_timer_wheel_t){0};
+  if (slot_count == 0U || slot_count > SIZE_MAX / 2U / sizeof(void *) ||
+      tick_ms == 0U) {
+    return false;
+  }
+  size_t slots = 1U;
+  while (slots < slot_count) {
+    slots <<= 1U;
+  }
+
+  wheel->slots = (jsonrpc_timer_t **)calloc(slots, sizeof(jsonrpc_timer_t *));
+  if (wheel->slots == nullptr) {
+    return false;
+  }
+  wheel->slot_count = slots;
+  wheel->tick_ms = tick_ms;
+  wheel->tick = now_ms / tick_ms;
+  return true;
+}
+
+void jsonrpc_timer_init(jsonrpc_timer_t *timer, jsonrpc_timer_cb_t callback,
+                        void *data) {
+  if (timer == nullptr) {
+    return;
+  }
+  *timer = (jsonrpc_timer_t){0};
+  timer->callback = callback;
+  timer->data = data;
+}
+
+static jsonrpc_timer_t **jsonrpc_timer_wheel_slot(jsonrpc_timer_wheel_t *wheel,
+                                                  uint64_t tick) {
+  return &wheel->slots[tick & (uint64_t)(wheel->slot_count - 1U)];
+}
+
+void jsonrpc_timer_wheel_cancel(jsonrpc_timer_wheel_t *wheel,
+                                jsonrpc_timer_t *timer) {
+  if (wheel == nullptr || timer == nullptr || !timer->armed) {
+    return;
+  }
+  if (wheel->cursor == timer) {
+    wheel->cursor = timer->next;
+  }
+  if (timer->prev != nullptr) {
+    timer->prev->next = timer->next;
+  } else {
+    *jsonrpc_timer_wheel_slot(wheel, timer->deadline_tick) = timer->next;
+  }
+  if (timer->next != nullptr) {
+    timer->next->prev = timer->prev;
+  }
+  timer->prev = nullptr;
+  timer->next = nullptr;
+  timer->armed = false;
+  wheel->armed -= 1U;
+}
+
+void jsonrpc_timer_wheel_schedule(jsonrpc_timer_wheel_t *wheel,
+                                  jsonrpc_timer_t *timer,
+                                  uint64_t deadline_ms) {
+  if (wheel == nullptr || wheel->slots == nullptr || timer == nullptr) {
+    return;
+  }
+  jsonrpc_timer_wheel_cancel(wheel, timer);
+
+  uint64_t tick = deadline_ms / wheel->tick_ms;
+  if (deadline_ms % wheel->tick_ms != 0U) {
+    tick += 1U;
+  }
+  if (tick <= wheel->tick) {
+    tick = wheel->tick + 1U;
+  }
+  timer->deadline = deadline_ms;
+  timer->deadline_tick = tick;
+
+  jsonrpc_timer_t **slot = jsonrpc_timer_wheel_slot(wheel, tick);
+  timer->prev = nullptr;
+  timer->next = *slot;
+  if (*slot != nullptr) {
+    (*slot)->prev = timer;
+  }
+  *slot = timer;
+  timer->armed = true;
+  wheel->armed += 1U;
+}
+
+size_t jsonrpc_timer_wheel_advance(jsonrpc_timer_wheel_t *wheel,
+                                   uint64_t now_ms) {
+  if (wheel == nullptr || wheel->slots == nullptr) {
+    return 0U;
+  }
+  const uint64_t target = now_ms / wheel->tick_ms;
+  if (target > wheel->tick && target - wheel->tick > wheel->slot_count) {
+    // Visiting each slot once covers every tick that was skipped.
+    wheel->tick = target - wheel->slot_count;
+  }
+
+  size_t fired = 0U;
+  while (wheel->tick < target) {
+    wheel->tick += 1U;
+    // Callbacks may arm or cancel timers; new ones go to the head of their
+    // slot with a later tick, and cancelling the next one moves the cursor.
+    jsonrpc_timer_t *timer = *jsonrpc_timer_wheel_slot(wheel, wheel->tick);
+    while (timer != nullptr) {
+      wheel->cursor = timer->next;
+      if (timer->deadline_tick <= wheel->tick) {
+        jsonrpc_timer_wheel_cancel(wheel, timer);
+        wheel->expired += 1U;
+        fired += 1U;
+        if (timer->callback != nullptr) {
+          timer->callback(timer);
+        }
+      }
+      timer = wheel->cursor;
+    }
+    wheel->cursor = nullptr;
+  }
+  return fired;
+}
+
+void jsonrpc_timer_wheel_destroy(jsonrpc_timer_wheel_t *wheel) {
+  if (wheel == nullptr) {
+    return;
+  }
+  for (size_t i = 0U; i < wheel->slot_count; ++i) {
+    jsonrpc_timer_t *timer = wheel->slots[i];
+    while (timer != nullptr) {
+      jsonrpc_timer_t *next = timer->next;
+      *timer = (jsonrpc_timer_t){.callback = timer->callback,
+                                 .data = timer->data};
+      timer = next;
+    }
+  }
+  free(wheel->slots);
+  *wheel = (jsonrpc_timer_wheel_t){0};
+}
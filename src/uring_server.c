@@ -0,0 +1,918 @@
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "jsonrpc/flow_control.h"
+#include "jsonrpc/jsonrpc.h"
+#include "jsonrpc/uring_server.h"
+
+static atomic_size_t g_uring_connections = 0U;
+static atomic_size_t g_uring_write_paused = 0U;
+static atomic_uint_least64_t g_uring_write_pauses = 0U;
+static atomic_uint_least64_t g_uring_enters = 0U;
+static atomic_uint_least64_t g_uring_sqes = 0U;
+
+void uring_server_add_stats(server_stats_t *stats) {
+  if (stats == nullptr) {
+    return;
+  }
+  stats->connections += atomic_load(&g_uring_connections);
+  stats->write_paused += atomic_load(&g_uring_write_paused);
+  stats->write_pauses += atomic_load(&g_uring_write_pauses);
+  stats->uring_enters = atomic_load(&g_uring_enters);
+  stats->uring_sqes = atomic_load(&g_uring_sqes);
+}
+
+#if defined(__linux__)
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+constexpr unsigned URING_ENTRIES = 4'096U;
+// Provided receive buffers: a power of two, shared by every connection of
+// the ring; each is handed back right after its bytes are fed.
+constexpr unsigned URING_RECV_BUFFERS = 1'024U;
+constexpr size_t URING_RECV_BUFFER_BYTES = 4'096U;
+constexpr uint16_t URING_BUFFER_GROUP = 0U;
+constexpr int URING_BACKLOG = 4'096;
+constexpr size_t URING_SEND_MIN_BYTES = 4'096U;
+
+// Operation kinds, kept in the low bits of user_data next to the connection.
+enum uring_op {
+  URING_OP_ACCEPT = 0U,
+  URING_OP_RECV = 1U,
+  URING_OP_SEND = 2U,
+  URING_OP_CANCEL = 3U,
+};
+constexpr uint64_t URING_OP_MASK = 3U;
+
+// Why a connection's recv is left unarmed; it reads again once none is left.
+enum uring_pause_reason {
+  URING_PAUSE_DEFERRED = 1U << 0,    // HTTP requests held behind a deferral
+  URING_PAUSE_WRITE_QUEUE = 1U << 1, // peer is not draining responses
+};
+
+typedef struct uring_conn_s {
+  struct uring_server_s *server;
+  struct uring_conn_s *prev; // server->conns list
+  struct uring_conn_s *next;
+  struct uring_conn_s *flush_next; // server->flush_head list
+  int fd;
+  jsonrpc_conn_t *rpc;
+  jsonrpc_transport_t transport;
+  // Responses queued since the last send, and the bytes of the send in
+  // flight; the two buffers swap when a send is submitted.
+  uint8_t *pending;
+  size_t pending_off; // queued bytes start here
+  size_t pending_len;
+  size_t pending_cap;
+  uint8_t *sending;
+  size_t sending_len;
+  size_t sending_off;
+  size_t sending_cap;
+  bool recv_armed;
+  uint32_t paused_by; // enum uring_pause_reason
+  bool send_inflight;
+  bool flush_queued;
+  bool draining; // closing once the queued responses have been sent
+  bool closing;
+} uring_conn_t;
+
+typedef struct {
+  int fd;
+  void *sq_map;
+  size_t sq_map_len;
+  void *cq_map;
+  size_t cq_map_len;
+  struct io_uring_sqe *sqes;
+  size_t sqes_len;
+  unsigned *sq_head;
+  unsigned *sq_tail;
+  unsigned *sq_flags;
+  unsigned sq_mask;
+  unsigned sq_entries;
+  unsigned sq_local_tail; // entries prepared, published on submit
+  unsigned *cq_head;
+  unsigned *cq_tail;
+  unsigned cq_mask;
+  struct io_uring_cqe *cqes;
+  struct io_uring_buf_ring *buf_ring;
+  size_t buf_ring_len;
+  uint8_t *buffers;
+  uint16_t buf_tail;
+  bool buf_ring_registered;
+  size_t inflight; // operations whose final completion is outstanding
+} uring_ring_t;
+
+struct uring_server_s {
+  uring_ring_t ring;
+  uv_poll_t poll;
+  uv_prepare_t prepare;
+  int listen_fd;
+  jsonrpc_framing_t framing;
+  size_t max_message_bytes;
+  bool msgpack;
+  jsonrpc_watermarks_t write_queue; // on the unsent responses
+  bool accept_armed;
+  bool accept_blocked; // out of descriptors; retried when a connection closes
+  uring_conn_t *conns;
+  uring_conn_t *flush_head;
+};
+
+static int uring_setup(unsigned entries, struct io_uring_params *params) {
+  return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                       unsigned flags) {
+  return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags,
+                      nullptr, 0);
+}
+
+static int uring_register(int fd, unsigned opcode, void *arg,
+                          unsigned nr_args) {
+  return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static void uring_ring_release(uring_ring_t *ring) {
+  if (ring->fd >= 0) {
+    (void)close(ring->fd);
+  }
+  if (ring->sqes != nullptr) {
+    (void)munmap(ring->sqes, ring->sqes_len);
+  }
+  if (ring->cq_map != nullptr && ring->cq_map != ring->sq_map) {
+    (void)munmap(ring->cq_map, ring->cq_map_len);
+  }
+  if (ring->sq_map != nullptr) {
+    (void)munmap(ring->sq_map, ring->sq_map_len);
+  }
+  if (ring->buf_ring != nullptr) {
+    (void)munmap(ring->buf_ring, ring->buf_ring_len);
+  }
+  free(ring->buffers);
+  *ring = (uring_ring_t){.fd = -1};
+}
+
+static void uring_recycle_buffer(uring_ring_t *ring, uint16_t bid) {
+  // Only addr/len/bid are written: the ring tail overlays bufs[0].resv.
+  struct io_uring_buf *buf =
+      &ring->buf_ring->bufs[ring->buf_tail & (URING_RECV_BUFFERS - 1U)];
+  buf->addr = (uint64_t)(uintptr_t)(ring->buffers +
+                                    (size_t)bid * URING_RECV_BUFFER_BYTES);
+  buf->len = (uint32_t)URING_RECV_BUFFER_BYTES;
+  buf->bid = bid;
+  ring->buf_tail += 1U;
+  __atomic_store_n(&ring->buf_ring->tail, ring->buf_tail, __ATOMIC_RELEASE);
+}
+
+[[nodiscard]] static bool uring_ring_init(uring_ring_t *ring) {
+  *ring = (uring_ring_t){.fd = -1};
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring->fd = uring_setup(URING_ENTRIES, &params);
+  if (ring->fd < 0) {
+    perror("io_uring_setup failed");
+    return false;
+  }
+  if ((params.features & IORING_FEAT_NODROP) == 0U) {
+    fprintf(stderr, "io_uring backend needs a newer kernel (no NODROP).\n");
+    uring_ring_release(ring);
+    return false;
+  }
+
+  ring->sq_map_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cq_map_len =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0U;
+  if (single_mmap) {
+    if (ring->cq_map_len > ring->sq_map_len) {
+      ring->sq_map_len = ring->cq_map_len;
+    }
+    ring->cq_map_len = ring->sq_map_len;
+  }
+  void *sq_map = mmap(nullptr, ring->sq_map_len, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  if (sq_map == MAP_FAILED) {
+    perror("io_uring SQ mmap failed");
+    uring_ring_release(ring);
+    return false;
+  }
+  ring->sq_map = sq_map;
+  if (single_mmap) {
+    ring->cq_map = sq_map;
+  } else {
+    void *cq_map =
+        mmap(nullptr, ring->cq_map_len, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    if (cq_map == MAP_FAILED) {
+      perror("io_uring CQ mmap failed");
+      uring_ring_release(ring);
+      return false;
+    }
+    ring->cq_map = cq_map;
+  }
+  ring->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+  void *sqes = mmap(nullptr, ring->sqes_len, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    perror("io_uring SQE mmap failed");
+    uring_ring_release(ring);
+    return false;
+  }
+  ring->sqes = (struct io_uring_sqe *)sqes;
+
+  auto sq = (uint8_t *)ring->sq_map;
+  ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+  ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+  ring->sq_flags = (unsigned *)(sq + params.sq_off.flags);
+  ring->sq_mask = *(unsigned *)(sq + params.sq_off.ring_mask);
+  ring->sq_entries = *(unsigned *)(sq + params.sq_off.ring_entries);
+  ring->sq_local_tail = *ring->sq_tail;
+  // SQEs are used in ring order, so the index array is the identity.
+  auto array = (unsigned *)(sq + params.sq_off.array);
+  for (unsigned i = 0U; i < ring->sq_entries; ++i) {
+    array[i] = i;
+  }
+  auto cq = (uint8_t *)ring->cq_map;
+  ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+  ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+  ring->cq_mask = *(unsigned *)(cq + params.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+  ring->buf_ring_len = URING_RECV_BUFFERS * sizeof(struct io_uring_buf);
+  void *buf_ring = mmap(nullptr, ring->buf_ring_len, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  ring->buffers =
+      (uint8_t *)calloc(URING_RECV_BUFFERS, URING_RECV_BUFFER_BYTES);
+  if (buf_ring == MAP_FAILED || ring->buffers == nullptr) {
+    fprintf(stderr, "Failed to allocate io_uring receive buffers.\n");
+    if (buf_ring != MAP_FAILED) {
+      (void)munmap(buf_ring, ring->buf_ring_len);
+    }
+    uring_ring_release(ring);
+    return false;
+  }
+  ring->buf_ring = (struct io_uring_buf_ring *)buf_ring;
+  struct io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = (uint64_t)(uintptr_t)buf_ring;
+  reg.ring_entries = URING_RECV_BUFFERS;
+  reg.bgid = URING_BUFFER_GROUP;
+  if (uring_register(ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1U) != 0) {
+    perror("io_uring provided buffer ring unavailable");
+    uring_ring_release(ring);
+    return false;
+  }
+  for (unsigned i = 0U; i < URING_RECV_BUFFERS; ++i) {
+    uring_recycle_buffer(ring, (uint16_t)i);
+  }
+  return true;
+}
+
+/**
+ * @brief Publish prepared SQEs and enter the kernel once for all of them,
+ * optionally waiting for wait_nr completions.
+ */
+static void uring_submit(uring_ring_t *ring, unsigned wait_nr) {
+  __atomic_store_n(ring->sq_tail, ring->sq_local_tail, __ATOMIC_RELEASE);
+  const unsigned to_submit =
+      ring->sq_local_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+  const bool overflow =
+      (__atomic_load_n(ring->sq_flags, __ATOMIC_RELAXED) &
+       IORING_SQ_CQ_OVERFLOW) != 0U;
+  if (to_submit == 0U && wait_nr == 0U && !overflow) {
+    return;
+  }
+  const unsigned flags =
+      wait_nr != 0U || overflow ? IORING_ENTER_GETEVENTS : 0U;
+  int status = 0;
+  do {
+    status = uring_enter(ring->fd, to_submit, wait_nr, flags);
+  } while (status < 0 && errno == EINTR);
+  (void)atomic_fetch_add(&g_uring_enters, 1U);
+  (void)atomic_fetch_add(&g_uring_sqes, to_submit);
+  if (status < 0 && errno != EAGAIN && errno != EBUSY) {
+    perror("io_uring_enter failed");
+  }
+}
+
+[[nodiscard]] static struct io_uring_sqe *uring_get_sqe(uring_ring_t *ring) {
+  if (ring->sq_local_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >=
+      ring->sq_entries) {
+    uring_submit(ring, 0U);
+    if (ring->sq_local_tail -
+            __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >=
+        ring->sq_entries) {
+      return nullptr;
+    }
+  }
+  struct io_uring_sqe *sqe = &ring->sqes[ring->sq_local_tail & ring->sq_mask];
+  memset(sqe, 0, sizeof(*sqe));
+  ring->sq_local_tail += 1U;
+  ring->inflight += 1U;
+  return sqe;
+}
+
+static uint64_t uring_user_data(const uring_conn_t *conn, enum uring_op op) {
+  return (uint64_t)(uintptr_t)conn | (uint64_t)op;
+}
+
+static void uring_arm_accept(uring_server_t *server) {
+  struct io_uring_sqe *sqe = uring_get_sqe(&server->ring);
+  if (sqe == nullptr) {
+    return;
+  }
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = server->listen_fd;
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+  sqe->accept_flags = SOCK_CLOEXEC;
+  sqe->user_data = uring_user_data(nullptr, URING_OP_ACCEPT);
+  server->accept_armed = true;
+}
+
+[[nodiscard]] static bool uring_arm_recv(uring_conn_t *conn) {
+  struct io_uring_sqe *sqe = uring_get_sqe(&conn->server->ring);
+  if (sqe == nullptr) {
+    return false;
+  }
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = conn->fd;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = URING_BUFFER_GROUP;
+  sqe->user_data = uring_user_data(conn, URING_OP_RECV);
+  conn->recv_armed = true;
+  return true;
+}
+
+[[nodiscard]] static bool uring_arm_send(uring_conn_t *conn) {
+  struct io_uring_sqe *sqe = uring_get_sqe(&conn->server->ring);
+  if (sqe == nullptr) {
+    return false;
+  }
+  sqe->opcode = IORING_OP_SEND;
+  sqe->fd = conn->fd;
+  sqe->addr = (uint64_t)(uintptr_t)(conn->sending + conn->sending_off);
+  sqe->len = (uint32_t)(conn->sending_len - conn->sending_off);
+  sqe->msg_flags = MSG_NOSIGNAL;
+  sqe->user_data = uring_user_data(conn, URING_OP_SEND);
+  conn->send_inflight = true;
+  return true;
+}
+
+static void uring_queue_flush(uring_conn_t *conn);
+
+static void uring_conn_close(uring_conn_t *conn) {
+  if (conn->closing) {
+    return;
+  }
+  conn->closing = true;
+  // Ends the multishot recv and any send in flight; the connection is
+  // released once both have completed. With neither armed (reads paused, no
+  // send) no completion would come, so the flush pass at the end of this
+  // iteration releases it, after the caller is done with it.
+  (void)shutdown(conn->fd, SHUT_RDWR);
+  uring_queue_flush(conn);
+}
+
+static void uring_conn_release(uring_conn_t *conn) {
+  if (!conn->closing || conn->recv_armed || conn->send_inflight ||
+      conn->flush_queued) {
+    return;
+  }
+  uring_server_t *server = conn->server;
+  if (conn->prev != nullptr) {
+    conn->prev->next = conn->next;
+  } else {
+    server->conns = conn->next;
+  }
+  if (conn->next != nullptr) {
+    conn->next->prev = conn->prev;
+  }
+  (void)atomic_fetch_sub(&g_uring_connections, 1U);
+  if ((conn->paused_by & URING_PAUSE_WRITE_QUEUE) != 0U) {
+    (void)atomic_fetch_sub(&g_uring_write_paused, 1U);
+  }
+  jsonrpc_conn_free(conn->rpc);
+  (void)close(conn->fd);
+  free(conn->pending);
+  free(conn->sending);
+  free(conn);
+  if (server->accept_blocked && server->listen_fd >= 0) {
+    server->accept_blocked = false;
+    uring_arm_accept(server);
+  }
+}
+
+static void uring_queue_flush(uring_conn_t *conn) {
+  if (conn->flush_queued) {
+    return;
+  }
+  conn->flush_queued = true;
+  conn->flush_next = conn->server->flush_head;
+  conn->server->flush_head = conn;
+}
+
+// Cancels the multishot recv; buffers it completes before the cancel lands
+// are still fed, and resuming arms a new one.
+static void uring_conn_pause_reads(uring_conn_t *conn, uint32_t reason) {
+  if ((conn->paused_by & reason) != 0U) {
+    return;
+  }
+  const bool reading = conn->paused_by == 0U;
+  conn->paused_by |= reason;
+  if (reason == URING_PAUSE_WRITE_QUEUE) {
+    (void)atomic_fetch_add(&g_uring_write_paused, 1U);
+    (void)atomic_fetch_add(&g_uring_write_pauses, 1U);
+  }
+  struct io_uring_sqe *sqe = reading && conn->recv_armed
+                                 ? uring_get_sqe(&conn->server->ring)
+                                 : nullptr;
+  if (sqe != nullptr) {
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = uring_user_data(conn, URING_OP_RECV);
+    sqe->user_data = uring_user_data(conn, URING_OP_CANCEL);
+  }
+}
+
+static void uring_conn_resume_reads(uring_conn_t *conn, uint32_t reason) {
+  if ((conn->paused_by & reason) == 0U) {
+    return;
+  }
+  conn->paused_by &= ~reason;
+  if (reason == URING_PAUSE_WRITE_QUEUE) {
+    (void)atomic_fetch_sub(&g_uring_write_paused, 1U);
+  }
+  if (conn->paused_by == 0U && !conn->recv_armed && !conn->closing &&
+      !conn->draining && !uring_arm_recv(conn)) {
+    uring_conn_close(conn);
+  }
+}
+
+/**
+ * @brief Stop reading from a peer that lets more than the high watermark of
+ * responses pile up unsent; read again once they drain below the low one.
+ */
+static void uring_conn_check_write_queue(uring_conn_t *conn) {
+  const size_t queued =
+      conn->pending_len - conn->pending_off + conn->sending_len;
+  switch (jsonrpc_watermarks_check(
+      &conn->server->write_queue, queued,
+      (conn->paused_by & URING_PAUSE_WRITE_QUEUE) != 0U)) {
+  case JSONRPC_WATERMARK_PAUSE:
+    uring_conn_pause_reads(conn, URING_PAUSE_WRITE_QUEUE);
+    break;
+  case JSONRPC_WATERMARK_RESUME:
+    uring_conn_resume_reads(conn, URING_PAUSE_WRITE_QUEUE);
+    break;
+  case JSONRPC_WATERMARK_HOLD:
+    break;
+  }
+}
+
+/**
+ * @brief Make room for len more bytes after the queued responses, keeping
+ * everything already written (including an earlier reservation).
+ */
+[[nodiscard]] static bool uring_conn_reserve(uring_conn_t *conn, size_t len) {
+  if (len <= conn->pending_cap - conn->pending_len) {
+    return true;
+  }
+  size_t cap = conn->pending_cap == 0U ? URING_SEND_MIN_BYTES
+                                       : conn->pending_cap;
+  while (cap - conn->pending_len < len) {
+    if (cap > SIZE_MAX / 2U) {
+      return false;
+    }
+    cap *= 2U;
+  }
+  auto grown = (uint8_t *)calloc(cap, sizeof(uint8_t));
+  if (grown == nullptr) {
+    return false;
+  }
+  if (conn->pending != nullptr) {
+    memcpy(grown, conn->pending, conn->pending_cap);
+  }
+  free(conn->pending);
+  conn->pending = grown;
+  conn->pending_cap = cap;
+  return true;
+}
+
+static uint8_t *uring_transport_reserve(jsonrpc_transport_t *self,
+                                        size_t min_len, size_t *out_cap) {
+  auto conn = (uring_conn_t *)self->user_data;
+  if (conn == nullptr || conn->closing || conn->draining ||
+      out_cap == nullptr || !uring_conn_reserve(conn, min_len)) {
+    return nullptr;
+  }
+  *out_cap = conn->pending_cap - conn->pending_len;
+  return conn->pending + conn->pending_len;
+}
+
+// A skipped gap is closed by moving whichever side is shorter: the responses
+// already queued (nothing, for the first one) or the new bytes.
+[[nodiscard]] static bool uring_transport_commit(jsonrpc_transport_t *self,
+                                                 size_t skip, size_t len) {
+  auto conn = (uring_conn_t *)self->user_data;
+  if (conn == nullptr || conn->closing || conn->draining || len == 0U ||
+      skip > conn->pending_cap - conn->pending_len ||
+      len > conn->pending_cap - conn->pending_len - skip) {
+    return false;
+  }
+  const size_t queued = conn->pending_len - conn->pending_off;
+  if (skip == 0U) {
+    conn->pending_len += len;
+  } else if (queued <= len) {
+    memmove(conn->pending + conn->pending_off + skip,
+            conn->pending + conn->pending_off, queued);
+    conn->pending_off += skip;
+    conn->pending_len += skip + len;
+  } else {
+    memmove(conn->pending + conn->pending_len,
+            conn->pending + conn->pending_len + skip, len);
+    conn->pending_len += len;
+  }
+  uring_queue_flush(conn);
+  uring_conn_check_write_queue(conn);
+  return true;
+}
+
+[[nodiscard]] static bool uring_transport_send_raw(jsonrpc_transport_t *self,
+                                                   const uint8_t *data,
+                                                   size_t len) {
+  auto conn = (uring_conn_t *)self->user_data;
+  if (conn == nullptr || conn->closing || conn->draining || data == nullptr ||
+      len == 0U) {
+    return false;
+  }
+  if (!uring_conn_reserve(conn, len)) {
+    uring_conn_close(conn);
+    return false;
+  }
+  memcpy(conn->pending + conn->pending_len, data, len);
+  conn->pending_len += len;
+  uring_queue_flush(conn);
+  uring_conn_check_write_queue(conn);
+  return true;
+}
+
+static void uring_transport_pause_reads(jsonrpc_transport_t *self) {
+  auto conn = (uring_conn_t *)self->user_data;
+  if (conn != nullptr) {
+    uring_conn_pause_reads(conn, URING_PAUSE_DEFERRED);
+  }
+}
+
+static void uring_transport_resume_reads(jsonrpc_transport_t *self) {
+  auto conn = (uring_conn_t *)self->user_data;
+  if (conn != nullptr) {
+    uring_conn_resume_reads(conn, URING_PAUSE_DEFERRED);
+  }
+}
+
+static void uring_transport_close(jsonrpc_transport_t *self) {
+  auto conn = (uring_conn_t *)self->user_data;
+  if (conn == nullptr) {
+    return;
+  }
+  // A response explaining the close may still be queued: stop reading and
+  // close once it has been sent. A second close does not wait.
+  if (conn->draining || conn->closing ||
+      (conn->pending_len == 0U && conn->sending_len == 0U)) {
+    uring_conn_close(conn);
+    return;
+  }
+  conn->draining = true;
+  (void)shutdown(conn->fd, SHUT_RD);
+}
+
+/**
+ * @brief Turn every connection's queued responses into one send SQE; they go
+ * to the kernel together with the next submission.
+ */
+static void uring_flush_sends(uring_server_t *server) {
+  while (server->flush_head != nullptr) {
+    uring_conn_t *conn = server->flush_head;
+    server->flush_head = conn->flush_next;
+    conn->flush_next = nullptr;
+    conn->flush_queued = false;
+    if (!conn->closing && !conn->send_inflight && conn->pending_len != 0U) {
+      uint8_t *sending = conn->sending;
+      const size_t sending_cap = conn->sending_cap;
+      conn->sending = conn->pending;
+      conn->sending_cap = conn->pending_cap;
+      conn->sending_len = conn->pending_len;
+      conn->sending_off = conn->pending_off;
+      conn->pending = sending;
+      conn->pending_cap = sending_cap;
+      conn->pending_off = 0U;
+      conn->pending_len = 0U;
+      if (!uring_arm_send(conn)) {
+        uring_conn_close(conn);
+      }
+    }
+    uring_conn_release(conn);
+  }
+}
+
+static void uring_on_accept(uring_server_t *server, int fd) {
+  auto conn = (uring_conn_t *)calloc(1U, sizeof(uring_conn_t));
+  if (conn == nullptr) {
+    (void)close(fd);
+    return;
+  }
+  conn->server = server;
+  conn->fd = fd;
+  conn->transport.user_data = conn;
+  conn->transport.send_raw = uring_transport_send_raw;
+  conn->transport.close = uring_transport_close;
+  conn->transport.reserve = uring_transport_reserve;
+  conn->transport.commit = uring_transport_commit;
+  conn->transport.pause_reads = uring_transport_pause_reads;
+  conn->transport.resume_reads = uring_transport_resume_reads;
+  conn->next = server->conns;
+  if (server->conns != nullptr) {
+    server->conns->prev = conn;
+  }
+  server->conns = conn;
+  (void)atomic_fetch_add(&g_uring_connections, 1U);
+
+  conn->rpc =
+      jsonrpc_conn_new(conn->transport, server_get_callbacks(), nullptr);
+  if (conn->rpc == nullptr ||
+      !jsonrpc_conn_set_framing(conn->rpc, server->framing,
+                                server->max_message_bytes) ||
+      (server->msgpack && !jsonrpc_conn_allow_msgpack(conn->rpc)) ||
+      !uring_arm_recv(conn)) {
+    uring_conn_close(conn);
+    uring_conn_release(conn);
+  }
+}
+
+static void uring_handle_cqe(uring_server_t *server,
+                             const struct io_uring_cqe *cqe) {
+  const bool more = (cqe->flags & IORING_CQE_F_MORE) != 0U;
+  if (!more) {
+    server->ring.inflight -= 1U;
+  }
+  auto conn = (uring_conn_t *)(uintptr_t)(cqe->user_data & ~URING_OP_MASK);
+  switch ((enum uring_op)(cqe->user_data & URING_OP_MASK)) {
+  case URING_OP_ACCEPT:
+    if (cqe->res >= 0) {
+      uring_on_accept(server, cqe->res);
+    } else if (cqe->res != -ECANCELED) {
+      fprintf(stderr, "io_uring accept failed: %s\n", strerror(-cqe->res));
+    }
+    if (!more) {
+      server->accept_armed = false;
+      if (cqe->res == -EMFILE || cqe->res == -ENFILE) {
+        server->accept_blocked = true;
+      } else if (cqe->res != -ECANCELED && server->listen_fd >= 0) {
+        uring_arm_accept(server);
+      }
+    }
+    return;
+  case URING_OP_RECV:
+    if ((cqe->flags & IORING_CQE_F_BUFFER) != 0U) {
+      const auto bid = (uint16_t)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+      if (cqe->res > 0 && !conn->closing && !conn->draining) {
+        jsonrpc_conn_feed(conn->rpc,
+                          server->ring.buffers +
+                              (size_t)bid * URING_RECV_BUFFER_BYTES,
+                          (size_t)cqe->res);
+      }
+      uring_recycle_buffer(&server->ring, bid);
+    }
+    if (!more) {
+      conn->recv_armed = false;
+      // Out of provided buffers ends the multishot recv; it is simply
+      // re-armed, the buffers being returned as soon as they are fed. So is
+      // a recv cancelled by a pause that has already been lifted.
+      if (conn->draining && !conn->closing) {
+        break; // the last send closes the connection
+      }
+      if (conn->paused_by != 0U && !conn->closing) {
+        break; // resuming re-arms it, and sees any end of stream then
+      }
+      if (conn->closing ||
+          (cqe->res <= 0 && cqe->res != -ENOBUFS && cqe->res != -ECANCELED) ||
+          !uring_arm_recv(conn)) {
+        uring_conn_close(conn);
+      }
+    }
+    break;
+  case URING_OP_SEND:
+    conn->send_inflight = false;
+    if (cqe->res < 0) {
+      uring_conn_close(conn);
+      break;
+    }
+    conn->sending_off += (size_t)cqe->res;
+    if (conn->sending_off < conn->sending_len) {
+      if (conn->closing || !uring_arm_send(conn)) {
+        uring_conn_close(conn);
+      }
+      break;
+    }
+    conn->sending_len = 0U;
+    conn->sending_off = 0U;
+    uring_conn_check_write_queue(conn);
+    if (conn->pending_len != 0U) {
+      uring_queue_flush(conn);
+    } else if (conn->draining) {
+      uring_conn_close(conn);
+    }
+    break;
+  case URING_OP_CANCEL:
+    return;
+  }
+  uring_conn_release(conn);
+}
+
+static void uring_reap(uring_server_t *server) {
+  uring_ring_t *ring = &server->ring;
+  unsigned head = *ring->cq_head;
+  unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+  while (head != tail) {
+    while (head != tail) {
+      // Copied out so callbacks never see a slot the kernel may reuse.
+      const struct io_uring_cqe cqe = ring->cqes[head & ring->cq_mask];
+      head += 1U;
+      __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+      uring_handle_cqe(server, &cqe);
+    }
+    tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+  }
+}
+
+static void on_uring_ready(uv_poll_t *handle, int status,
+                           int events [[maybe_unused]]) {
+  auto server = (uring_server_t *)handle->data;
+  if (status < 0) {
+    fprintf(stderr, "io_uring poll failed: %s\n", uv_strerror(status));
+    return;
+  }
+  uring_reap(server);
+  uring_flush_sends(server);
+  uring_submit(&server->ring, 0U);
+}
+
+// Responses can also be queued outside on_uring_ready (offloaded requests
+// completing on the loop), so each iteration ends with one submission.
+static void on_uring_prepare(uv_prepare_t *handle) {
+  auto server = (uring_server_t *)handle->data;
+  uring_flush_sends(server);
+  uring_submit(&server->ring, 0U);
+}
+
+static void on_uring_abandoned(uv_handle_t *handle) { free(handle->data); }
+
+[[nodiscard]] static int uring_listen(const struct sockaddr *addr,
+                                      bool reuse_port) {
+  const int fd = socket(addr->sa_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    perror("socket failed");
+    return -1;
+  }
+  const int enable = 1;
+  if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) != 0 ||
+      (reuse_port && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enable,
+                                sizeof(enable)) != 0)) {
+    perror("setsockopt failed");
+    (void)close(fd);
+    return -1;
+  }
+  const socklen_t addr_len = addr->sa_family == AF_INET6
+                                 ? (socklen_t)sizeof(struct sockaddr_in6)
+                                 : (socklen_t)sizeof(struct sockaddr_in);
+  if (bind(fd, addr, addr_len) != 0 || listen(fd, URING_BACKLOG) != 0) {
+    perror("io_uring listener bind/listen failed");
+    (void)close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+uring_server_t *uring_server_start(uv_loop_t *loop,
+                                   const struct sockaddr *addr,
+                                   bool reuse_port, jsonrpc_framing_t framing,
+                                   size_t max_message_bytes, bool msgpack,
+                                   jsonrpc_watermarks_t write_queue) {
+  if (loop == nullptr || addr == nullptr) {
+    return nullptr;
+  }
+  auto server = (uring_server_t *)calloc(1U, sizeof(uring_server_t));
+  if (server == nullptr) {
+    return nullptr;
+  }
+  server->listen_fd = -1;
+  server->framing = framing;
+  server->max_message_bytes = max_message_bytes;
+  server->msgpack = msgpack && framing != JSONRPC_FRAMING_NEWLINE;
+  server->write_queue = write_queue;
+  if (!uring_ring_init(&server->ring)) {
+    free(server);
+    return nullptr;
+  }
+  server->listen_fd = uring_listen(addr, reuse_port);
+  if (server->listen_fd < 0) {
+    uring_ring_release(&server->ring);
+    free(server);
+    return nullptr;
+  }
+
+  const int poll_status = uv_poll_init(loop, &server->poll, server->ring.fd);
+  if (poll_status != 0) {
+    fprintf(stderr, "uv_poll_init failed: %s\n", uv_strerror(poll_status));
+    (void)close(server->listen_fd);
+    uring_ring_release(&server->ring);
+    free(server);
+    return nullptr;
+  }
+  server->poll.data = server;
+  (void)uv_prepare_init(loop, &server->prepare);
+  server->prepare.data = server;
+  const int start_status =
+      uv_poll_start(&server->poll, UV_READABLE, on_uring_ready);
+  if (start_status != 0 ||
+      uv_prepare_start(&server->prepare, on_uring_prepare) != 0) {
+    fprintf(stderr, "Failed to start io_uring polling.\n");
+    // Close callbacks run in order, so the server outlives both handles.
+    uv_close((uv_handle_t *)&server->prepare, nullptr);
+    uv_close((uv_handle_t *)&server->poll, on_uring_abandoned);
+    (void)close(server->listen_fd);
+    uring_ring_release(&server->ring);
+    return nullptr;
+  }
+  uv_unref((uv_handle_t *)&server->prepare);
+
+  uring_arm_accept(server);
+  uring_submit(&server->ring, 0U);
+  return server;
+}
+
+void uring_server_destroy(uring_server_t *server) {
+  if (server == nullptr) {
+    return;
+  }
+  uring_ring_t *ring = &server->ring;
+  if (server->listen_fd >= 0) {
+    (void)close(server->listen_fd);
+    server->listen_fd = -1;
+  }
+  for (uring_conn_t *conn = server->conns; conn != nullptr; conn = conn->next) {
+    uring_conn_close(conn);
+  }
+  // Wait out everything in flight (the kernel may still be reading send
+  // buffers) before any memory is released.
+  struct io_uring_sqe *sqe = ring->inflight != 0U ? uring_get_sqe(ring)
+                                                  : nullptr;
+  if (sqe != nullptr) {
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY | IORING_ASYNC_CANCEL_ALL;
+    sqe->user_data = uring_user_data(nullptr, URING_OP_CANCEL);
+  }
+  while (ring->inflight != 0U) {
+    uring_flush_sends(server);
+    uring_submit(ring, 1U);
+    uring_reap(server);
+  }
+  uring_flush_sends(server);
+  while (server->conns != nullptr) {
+    uring_conn_t *conn = server->conns;
+    conn->recv_armed = false;
+    conn->send_inflight = false;
+    uring_conn_release(conn);
+  }
+  uring_ring_release(ring);
+  free(server);
+}
+
+#else
+
+uring_server_t *
+uring_server_start(uv_loop_t *loop [[maybe_unused]],
+                   const struct sockaddr *addr [[maybe_unused]],
+                   bool reuse_port [[maybe_unused]],
+                   jsonrpc_framing_t framing [[maybe_unused]],
+                   size_t max_message_bytes [[maybe_unused]],
+                   bool msgpack [[maybe_unused]],
+                   jsonrpc_watermarks_t write_queue [[maybe_unused]]) {
+  fprintf(stderr, "The io_uring backend is only available on Linux.\n");
+  return nullptr;
+}
+
+void uring_server_destroy(uring_server_t *server [[maybe_unused]]) {}
+
+#endif
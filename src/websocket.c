@@ -0,0 +1,220 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "jsonrpc/websocket.h"
+
+jsonrpc_ws_status_t jsonrpc_ws_parse_frame(const uint8_t *data, size_t len,
+                                           jsonrpc_ws_frame_t *frame) {
+  if (len < 2U) {
+    return JSONRPC_WS_INCOMPLETE;
+  }
+  const auto opcode = (jsonrpc_ws_opcode_t)(data[0] & 0x0FU);
+  const bool fin = (data[0] & 0x80U) != 0U;
+  const size_t length7 = data[1] & 0x7FU;
+  switch (opcode) {
+  case JSONRPC_WS_CONTINUATION:
+  case JSONRPC_WS_TEXT:
+  case JSONRPC_WS_BINARY:
+    break;
+  case JSONRPC_WS_CLOSE:
+  case JSONRPC_WS_PING:
+  case JSONRPC_WS_PONG:
+    if (!fin || length7 > JSONRPC_WS_CONTROL_MAX) {
+      return JSONRPC_WS_INVALID;
+    }
+    break;
+  default:
+    return JSONRPC_WS_INVALID;
+  }
+  if ((data[0] & 0x70U) != 0U || (data[1] & 0x80U) == 0U) {
+    return JSONRPC_WS_INVALID;
+  }
+
+  const size_t length_bytes = length7 == 127U ? 8U : length7 == 126U ? 2U : 0U;
+  const size_t header_len = 2U + length_bytes + 4U;
+  if (len < header_len) {
+    return JSONRPC_WS_INCOMPLETE;
+  }
+  uint64_t payload_len = length_bytes == 0U ? length7 : 0U;
+  for (size_t i = 0U; i < length_bytes; ++i) {
+    payload_len = payload_len << 8U | data[2U + i];
+  }
+  if ((payload_len >> 63U) != 0U || payload_len > SIZE_MAX) {
+    return JSONRPC_WS_INVALID;
+  }
+  frame->header_len = header_len;
+  frame->payload_len = (size_t)payload_len;
+  memcpy(frame->mask, data + 2U + length_bytes, sizeof(frame->mask));
+  frame->opcode = opcode;
+  frame->fin = fin;
+  return JSONRPC_WS_READY;
+}
+
+size_t jsonrpc_ws_frame_header(jsonrpc_ws_opcode_t opcode, size_t payload_len,
+                               uint8_t *out) {
+  out[0] = (uint8_t)(0x80U | (unsigned)opcode);
+  if (payload_len < 126U) {
+    out[1] = (uint8_t)payload_len;
+    return 2U;
+  }
+  if (payload_len <= UINT16_MAX) {
+    out[1] = 126U;
+    out[2] = (uint8_t)(payload_len >> 8U);
+    out[3] = (uint8_t)payload_len;
+    return 4U;
+  }
+  out[1] = 127U;
+  const auto wide = (uint64_t)payload_len;
+  for (size_t i = 0U; i < 8U; ++i) {
+    out[2U + i] = (uint8_t)(wide >> (56U - 8U * i));
+  }
+  return JSONRPC_WS_SEND_HEADER_MAX;
+}
+
+// Every unmask loop below works from a key already rotated so that key[0]
+// applies to src[0]; steps that are multiples of 4 keep it aligned.
+static void ws_unmask_scalar(uint8_t *dst, const uint8_t *src, size_t len,
+                             const uint8_t key[4]) {
+  for (size_t i = 0U; i < len; ++i) {
+    dst[i] = src[i] ^ key[i & 3U];
+  }
+}
+
+#if defined(__SSE2__)
+static void ws_unmask_sse2(uint8_t *dst, const uint8_t *src, size_t len,
+                           const uint8_t key[4]) {
+  int32_t word = 0;
+  memcpy(&word, key, sizeof(word));
+  const __m128i mask = _mm_set1_epi32(word);
+  size_t i = 0U;
+  for (; i + 16U <= len; i += 16U) {
+    const __m128i chunk = _mm_loadu_si128((const __m128i *)(src + i));
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(chunk, mask));
+  }
+  ws_unmask_scalar(dst + i, src + i, len - i, key);
+}
+#endif
+
+#if defined(__SSE2__) && defined(__x86_64__)
+#define JSONRPC_UNMASK_AVX2 1
+[[gnu::target("avx2")]]
+static void ws_unmask_avx2(uint8_t *dst, const uint8_t *src, size_t len,
+                           const uint8_t key[4]) {
+  int32_t word = 0;
+  memcpy(&word, key, sizeof(word));
+  const __m256i mask = _mm256_set1_epi32(word);
+  size_t i = 0U;
+  for (; i + 32U <= len; i += 32U) {
+    const __m256i chunk = _mm256_loadu_si256((const __m256i *)(src + i));
+    _mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(chunk, mask));
+  }
+  ws_unmask_sse2(dst + i, src + i, len - i, key);
+}
+#endif
+
+void jsonrpc_ws_unmask(uint8_t *dst, const uint8_t *src, size_t len,
+                       const uint8_t mask[4], size_t offset) {
+  const uint8_t key[4] = {mask[offset & 3U], mask[(offset + 1U) & 3U],
+                          mask[(offset + 2U) & 3U], mask[(offset + 3U) & 3U]};
+#if defined(JSONRPC_UNMASK_AVX2)
+  if (len >= 32U && __builtin_cpu_supports("avx2")) {
+    ws_unmask_avx2(dst, src, len, key);
+    return;
+  }
+#endif
+#if defined(__SSE2__)
+  ws_unmask_sse2(dst, src, len, key);
+#else
+  ws_unmask_scalar(dst, src, len, key);
+#endif
+}
+
+static uint32_t ws_rotl(uint32_t value, unsigned bits) {
+  return value << bits | value >> (32U - bits);
+}
+
+static void ws_sha1_block(uint32_t state[5], const uint8_t block[64]) {
+  uint32_t w[80];
+  for (size_t i = 0U; i < 16U; ++i) {
+    w[i] = (uint32_t)block[4U * i] << 24U |
+           (uint32_t)block[4U * i + 1U] << 16U |
+           (uint32_t)block[4U * i + 2U] << 8U | (uint32_t)block[4U * i + 3U];
+  }
+  for (size_t i = 16U; i < 80U; ++i) {
+    w[i] = ws_rotl(w[i - 3U] ^ w[i - 8U] ^ w[i - 14U] ^ w[i - 16U], 1U);
+  }
+  uint32_t a = state[0];
+  uint32_t b = state[1];
+  uint32_t c = state[2];
+  uint32_t d = state[3];
+  uint32_t e = state[4];
+  for (size_t i = 0U; i < 80U; ++i) {
+    uint32_t f = 0U;
+    uint32_t k = 0U;
+    if (i < 20U) {
+      f = (b & c) | (~b & d);
+      k = 0x5A82'7999U;
+    } else if (i < 40U) {
+      f = b ^ c ^ d;
+      k = 0x6ED9'EBA1U;
+    } else if (i < 60U) {
+      f = (b & c) | (b & d) | (c & d);
+      k = 0x8F1B'BCDCU;
+    } else {
+      f = b ^ c ^ d;
+      k = 0xCA62'C1D6U;
+    }
+    const uint32_t next = ws_rotl(a, 5U) + f + e + k + w[i];
+    e = d;
+    d = c;
+    c = ws_rotl(b, 30U);
+    b = a;
+    a = next;
+  }
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+}
+
+void jsonrpc_ws_accept_key(const uint8_t key[JSONRPC_WS_KEY_LEN],
+                           uint8_t out[JSONRPC_WS_ACCEPT_LEN]) {
+  static const char guid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+  static const char base64[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  // Key and GUID make 60 bytes, so the padded message is two blocks.
+  constexpr size_t message_len = JSONRPC_WS_KEY_LEN + sizeof(guid) - 1U;
+  uint8_t blocks[128] = {0};
+  memcpy(blocks, key, JSONRPC_WS_KEY_LEN);
+  memcpy(blocks + JSONRPC_WS_KEY_LEN, guid, sizeof(guid) - 1U);
+  blocks[message_len] = 0x80U;
+  const uint64_t bits = (uint64_t)message_len * 8U;
+  for (size_t i = 0U; i < 8U; ++i) {
+    blocks[sizeof(blocks) - 1U - i] = (uint8_t)(bits >> (8U * i));
+  }
+  uint32_t state[5] = {0x6745'2301U, 0xEFCD'AB89U, 0x98BA'DCFEU, 0x1032'5476U,
+                       0xC3D2'E1F0U};
+  ws_sha1_block(state, blocks);
+  ws_sha1_block(state, blocks + 64U);
+
+  uint8_t digest[21] = {0}; // one spare zero byte for the last base64 group
+  for (size_t i = 0U; i < 20U; ++i) {
+    digest[i] = (uint8_t)(state[i / 4U] >> (24U - 8U * (i % 4U)));
+  }
+  for (size_t i = 0U, o = 0U; i < 21U; i += 3U, o += 4U) {
+    const uint32_t group = (uint32_t)digest[i] << 16U |
+                           (uint32_t)digest[i + 1U] << 8U | digest[i + 2U];
+    out[o] = (uint8_t)base64[group >> 18U];
+    out[o + 1U] = (uint8_t)base64[(group >> 12U) & 0x3FU];
+    out[o + 2U] = (uint8_t)base64[(group >> 6U) & 0x3FU];
+    out[o + 3U] = o + 3U == JSONRPC_WS_ACCEPT_LEN - 1U
+                      ? (uint8_t)'='
+                      : (uint8_t)base64[group & 0x3FU];
+  }
+}
@@ -2,9 +2,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <threads.h>
 
 #include "jsonrpc/arena.h"
+#include "jsonrpc/flow_control.h"
 #include "jsonrpc/jsonrpc.h"
+#include "jsonrpc/msgpack.h"
+#include "jsonrpc/pool.h"
+#include "jsonrpc/router.h"
+#include "jsonrpc/timer_wheel.h"
+#include "jsonrpc/websocket.h"
 
 constexpr int32_t JSONRPC_ERR_PARSE = -32'700;
 constexpr int32_t JSONRPC_ERR_INVALID_REQUEST = -32'600;
@@ -18,9 +25,17 @@ constexpr size_t JSONRPC_MAX_BUFFER_BYTES = 131'072U;
 
 typedef struct {
   char *messages[TEST_MAX_MESSAGES];
+  size_t message_lens[TEST_MAX_MESSAGES];
   size_t message_count;
   bool fail_send;
   size_t close_calls;
+  uint8_t *reserve_buffer;
+  size_t reserve_cap;
+  size_t reserve_calls;
+  size_t commit_calls;
+  size_t last_commit_skip;
+  size_t pause_calls;
+  bool reads_paused;
 } test_transport_state_t;
 
 typedef struct {
@@ -54,10 +69,19 @@ static void test_transport_state_reset(test_transport_state_t *state) {
   for (size_t i = 0U; i < state->message_count; ++i) {
     free(state->messages[i]);
     state->messages[i] = nullptr;
+    state->message_lens[i] = 0U;
   }
   state->message_count = 0U;
   state->fail_send = false;
   state->close_calls = 0U;
+  free(state->reserve_buffer);
+  state->reserve_buffer = nullptr;
+  state->reserve_cap = 0U;
+  state->reserve_calls = 0U;
+  state->commit_calls = 0U;
+  state->last_commit_skip = 0U;
+  state->pause_calls = 0U;
+  state->reads_paused = false;
 }
 
 static bool test_send_raw(jsonrpc_transport_t *self, const uint8_t *data,
@@ -84,10 +108,49 @@ static bool test_send_raw(jsonrpc_transport_t *self, const uint8_t *data,
   memcpy(copy, data, len);
   copy[len] = '\0';
   state->messages[state->message_count] = copy;
+  state->message_lens[state->message_count] = len;
   state->message_count += 1U;
   return true;
 }
 
+static uint8_t *test_reserve(jsonrpc_transport_t *self, size_t min_len,
+                             size_t *out_cap) {
+  if (self == nullptr || self->user_data == nullptr || out_cap == nullptr) {
+    return nullptr;
+  }
+  auto state = (test_transport_state_t *)self->user_data;
+  state->reserve_calls += 1U;
+  if (min_len > state->reserve_cap) {
+    // Grow in small steps so the serializer has to ask more than once.
+    const size_t new_cap = min_len + 8U;
+    auto grown = (uint8_t *)calloc(new_cap, sizeof(uint8_t));
+    if (grown == nullptr) {
+      return nullptr;
+    }
+    if (state->reserve_buffer != nullptr) {
+      memcpy(grown, state->reserve_buffer, state->reserve_cap);
+    }
+    free(state->reserve_buffer);
+    state->reserve_buffer = grown;
+    state->reserve_cap = new_cap;
+  }
+  *out_cap = state->reserve_cap;
+  return state->reserve_buffer;
+}
+
+static bool test_commit(jsonrpc_transport_t *self, size_t skip, size_t len) {
+  if (self == nullptr || self->user_data == nullptr) {
+    return false;
+  }
+  auto state = (test_transport_state_t *)self->user_data;
+  if (skip > state->reserve_cap || len > state->reserve_cap - skip) {
+    return false;
+  }
+  state->commit_calls += 1U;
+  state->last_commit_skip = skip;
+  return test_send_raw(self, state->reserve_buffer + skip, len);
+}
+
 static void test_close(jsonrpc_transport_t *self) {
   if (self == nullptr || self->user_data == nullptr) {
     return;
@@ -96,6 +159,17 @@ static void test_close(jsonrpc_transport_t *self) {
   state->close_calls += 1U;
 }
 
+static void test_pause_reads(jsonrpc_transport_t *self) {
+  auto state = (test_transport_state_t *)self->user_data;
+  state->pause_calls += 1U;
+  state->reads_paused = true;
+}
+
+static void test_resume_reads(jsonrpc_transport_t *self) {
+  auto state = (test_transport_state_t *)self->user_data;
+  state->reads_paused = false;
+}
+
 static void on_open(jsonrpc_conn_t *conn) {
   auto context = (test_context_t *)jsonrpc_conn_get_context(conn);
   if (context == nullptr || context != g_active_test_context) {
@@ -171,7 +245,9 @@ static void on_notification(jsonrpc_conn_t *conn, const char *method,
 
   jsonrpc_transport_t transport = {.user_data = &context->transport_state,
                                    .send_raw = test_send_raw,
-                                   .close = test_close};
+                                   .close = test_close,
+                                   .pause_reads = test_pause_reads,
+                                   .resume_reads = test_resume_reads};
 
   jsonrpc_callbacks_t callbacks = {.on_open = on_open,
                                    .on_close = on_close,
@@ -188,7 +264,9 @@ test_conn_new_with_callbacks(test_context_t *context, jsonrpc_callbacks_t callba
   }
   jsonrpc_transport_t transport = {.user_data = &context->transport_state,
                                    .send_raw = test_send_raw,
-                                   .close = test_close};
+                                   .close = test_close,
+                                   .pause_reads = test_pause_reads,
+                                   .resume_reads = test_resume_reads};
   return jsonrpc_conn_new(transport, callbacks, context);
 }
 
@@ -580,6 +658,375 @@ static bool test_framing_and_embedded_nul_parse_error() {
   return true;
 }
 
+static bool test_pipelined_messages_split_across_feeds() {
+  test_context_t context = {0};
+  g_active_test_context = &context;
+  auto conn = test_conn_new(&context);
+  ASSERT_TRUE(conn != nullptr);
+
+  // Padded requests fed in chunks that end mid-message, so the inbound
+  // buffer both advances its read cursor and compacts partial tails.
+  constexpr size_t message_count = 30U;
+  constexpr size_t chunk_len = 700U;
+  char stream[message_count * 256U];
+  size_t stream_len = 0U;
+  for (size_t i = 0U; i < message_count; ++i) {
+    const int written =
+        snprintf(stream + stream_len, sizeof(stream) - stream_len,
+                 "{\"jsonrpc\":\"2.0\",\"id\":%zu,\"method\":\"ping\"%*s}\n",
+                 i, (int)(i * 7U), "");
+    ASSERT_TRUE(written > 0 && (size_t)written < sizeof(stream) - stream_len);
+    stream_len += (size_t)written;
+  }
+  for (size_t offset = 0U; offset < stream_len; offset += chunk_len) {
+    const size_t remaining = stream_len - offset;
+    jsonrpc_conn_feed(conn, (const uint8_t *)stream + offset,
+                      remaining < chunk_len ? remaining : chunk_len);
+  }
+
+  ASSERT_TRUE(context.transport_state.message_count == message_count);
+  for (size_t i = 0U; i < message_count; ++i) {
+    auto response = test_parse_sent_json(&context.transport_state, i);
+    ASSERT_TRUE(response != nullptr);
+    ASSERT_TRUE(json_object_get_number(json_value_get_object(response), "id") ==
+                (double)i);
+    json_value_free(response);
+  }
+
+  jsonrpc_conn_free(conn);
+  test_transport_state_reset(&context.transport_state);
+  g_active_test_context = nullptr;
+  return true;
+}
+
+static bool test_framing_scan_resumes_across_feeds() {
+  test_context_t context = {0};
+  g_active_test_context = &context;
+  auto conn = test_conn_new(&context);
+  ASSERT_TRUE(conn != nullptr);
+
+  // A NUL seen in an earlier feed must still fail its line, and must not leak
+  // into the next one. Short feeds keep the scanner resuming mid-line.
+  char with_nul[] = "{\"jsonrpc\":\"2.0\",\"id\":21,\"method\":\"ping\"}"
+                    "                                        X\n";
+  with_nul[strlen(with_nul) - 2U] = '\0';
+  const size_t with_nul_len = sizeof(with_nul) - 1U;
+  const char *ping = "{\"jsonrpc\":\"2.0\",\"id\":22,\"method\":\"ping\"}"
+                     "                                                  \n";
+  for (size_t offset = 0U; offset < with_nul_len; offset += 7U) {
+    const size_t remaining = with_nul_len - offset;
+    jsonrpc_conn_feed(conn, (const uint8_t *)with_nul + offset,
+                      remaining < 7U ? remaining : 7U);
+  }
+  for (size_t offset = 0U; ping[offset] != '\0'; ++offset) {
+    jsonrpc_conn_feed(conn, (const uint8_t *)ping + offset, 1U);
+  }
+
+  ASSERT_TRUE(context.transport_state.message_count == 2U);
+  auto parse_err = test_parse_sent_json(&context.transport_state, 0U);
+  ASSERT_TRUE(parse_err != nullptr);
+  auto error_obj = json_object_get_object(json_value_get_object(parse_err), "error");
+  ASSERT_TRUE((int32_t)json_object_get_number(error_obj, "code") ==
+              JSONRPC_ERR_PARSE);
+  json_value_free(parse_err);
+
+  auto ok = test_parse_sent_json(&context.transport_state, 1U);
+  ASSERT_TRUE(ok != nullptr);
+  ASSERT_TRUE(json_object_get_number(json_value_get_object(ok), "id") == 22.0);
+  json_value_free(ok);
+
+  jsonrpc_conn_free(conn);
+  test_transport_state_reset(&context.transport_state);
+  g_active_test_context = nullptr;
+  return true;
+}
+
+// Decode one length-prefixed response sent on the test transport.
+[[nodiscard]] static JSON_Value *
+test_parse_length_prefixed(const test_transport_state_t *state, size_t index) {
+  if (index >= state->message_count || state->message_lens[index] < 4U) {
+    return nullptr;
+  }
+  const auto bytes = (const uint8_t *)state->messages[index];
+  const size_t body_len = (size_t)bytes[0] << 24U | (size_t)bytes[1] << 16U |
+                          (size_t)bytes[2] << 8U | (size_t)bytes[3];
+  if (body_len != state->message_lens[index] - 4U) {
+    return nullptr;
+  }
+  return json_parse_string_with_len(state->messages[index] + 4U, body_len);
+}
+
+static bool test_length_prefix_framing() {
+  test_context_t context = {0};
+  g_active_test_context = &context;
+  auto conn = test_conn_new(&context);
+  ASSERT_TRUE(conn != nullptr);
+  constexpr size_t max_message = 200'000U;
+  ASSERT_TRUE(jsonrpc_conn_set_framing(conn, JSONRPC_FRAMING_LENGTH_PREFIX,
+                                       max_message));
+
+  // A ping, an empty frame, a ping padded past the newline limit, and one
+  // with a raw NUL in a string, fed in chunks that split headers and bodies.
+  const size_t big_len = JSONRPC_MAX_MESSAGE_BYTES * 2U;
+  const size_t stream_cap = big_len + 256U;
+  auto stream = (uint8_t *)calloc(stream_cap, sizeof(uint8_t));
+  ASSERT_TRUE(stream != nullptr);
+  size_t stream_len = 0U;
+  static const char with_nul[] =
+      "{\"jsonrpc\":\"2.0\",\"id\":\"a\0b\",\"method\":\"ping\"}";
+  const char *bodies[] = {
+      "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"ping\"}",
+      "",
+      nullptr,
+      with_nul,
+  };
+  const size_t body_lens[] = {strlen(bodies[0]), 0U, big_len,
+                              sizeof(with_nul) - 1U};
+  for (size_t i = 0U; i < 4U; ++i) {
+    const size_t header_len = jsonrpc_frame_header(
+        JSONRPC_FRAMING_LENGTH_PREFIX, body_lens[i], stream + stream_len);
+    ASSERT_TRUE(header_len == 4U);
+    stream_len += header_len;
+    if (bodies[i] != nullptr) {
+      memcpy(stream + stream_len, bodies[i], body_lens[i]);
+    } else {
+      const char *head = "{\"jsonrpc\":\"2.0\",\"id\":2,\"method\":\"ping\"";
+      memset(stream + stream_len, ' ', big_len);
+      memcpy(stream + stream_len, head, strlen(head));
+      stream[stream_len + big_len - 1U] = '}';
+    }
+    stream_len += body_lens[i];
+  }
+  constexpr size_t chunk_len = 4'099U;
+  for (size_t offset = 0U; offset < stream_len; offset += chunk_len) {
+    const size_t remaining = stream_len - offset;
+    jsonrpc_conn_feed(conn, stream + offset,
+                      remaining < chunk_len ? remaining : chunk_len);
+    if (offset == chunk_len * 2U) {
+      // Mid-way through the big frame its whole buffer is already there.
+      ASSERT_TRUE(jsonrpc_conn_pending_input(conn) != 0U);
+      ASSERT_TRUE(jsonrpc_conn_memory_usage(conn) > big_len);
+    }
+  }
+  ASSERT_TRUE(jsonrpc_conn_pending_input(conn) == 0U);
+
+  ASSERT_TRUE(context.transport_state.message_count == 3U);
+  const double ids[] = {1.0, 2.0};
+  for (size_t i = 0U; i < 2U; ++i) {
+    auto response = test_parse_length_prefixed(&context.transport_state, i);
+    ASSERT_TRUE(response != nullptr);
+    auto response_obj = json_value_get_object(response);
+    ASSERT_TRUE(json_object_get_number(response_obj, "id") == ids[i]);
+    ASSERT_TRUE(strcmp(json_object_get_string(response_obj, "result"),
+                       "pong") == 0);
+    json_value_free(response);
+  }
+  auto parse_err = test_parse_length_prefixed(&context.transport_state, 2U);
+  ASSERT_TRUE(parse_err != nullptr);
+  auto error_obj =
+      json_object_get_object(json_value_get_object(parse_err), "error");
+  ASSERT_TRUE((int32_t)json_object_get_number(error_obj, "code") ==
+              JSONRPC_ERR_PARSE);
+  json_value_free(parse_err);
+  ASSERT_TRUE(context.transport_state.close_calls == 0U);
+
+  // A header announcing more than the limit is refused before any payload.
+  uint8_t header[JSONRPC_FRAME_HEADER_MAX];
+  ASSERT_TRUE(jsonrpc_frame_header(JSONRPC_FRAMING_LENGTH_PREFIX,
+                                   max_message + 1U, header) == 4U);
+  jsonrpc_conn_feed(conn, header, 4U);
+  ASSERT_TRUE(context.transport_state.close_calls >= 1U);
+  ASSERT_TRUE(context.transport_state.message_count == 4U);
+  auto too_large = test_parse_length_prefixed(&context.transport_state, 3U);
+  ASSERT_TRUE(too_large != nullptr);
+  error_obj = json_object_get_object(json_value_get_object(too_large), "error");
+  ASSERT_TRUE(strcmp(json_object_get_string(error_obj, "message"),
+                     "Request too large") == 0);
+  json_value_free(too_large);
+
+  free(stream);
+  jsonrpc_conn_free(conn);
+  test_transport_state_reset(&context.transport_state);
+  g_active_test_context = nullptr;
+  return true;
+}
+
+static bool test_content_length_framing() {
+  test_context_t context = {0};
+  g_active_test_context = &context;
+  jsonrpc_transport_t transport = {.user_data = &context.transport_state,
+                                   .send_raw = test_send_raw,
+                                   .close = test_close,
+                                   .reserve = test_reserve,
+                                   .commit = test_commit};
+  jsonrpc_callbacks_t callbacks = {.on_open = on_open,
+                                   .on_close = on_close,
+                                   .on_request = on_request,
+                                   .on_notification = on_notification};
+  auto conn = jsonrpc_conn_new(transport, callbacks, &context);
+  ASSERT_TRUE(conn != nullptr);
+  ASSERT_TRUE(
+      jsonrpc_conn_set_framing(conn, JSONRPC_FRAMING_CONTENT_LENGTH, 0U));
+
+  // Header names are case-insensitive and other headers are skipped. Fed a
+  // byte at a time so the header block arrives in pieces.
+  const char *stream =
+      "Content-Length: 41\r\n\r\n"
+      "{\"jsonrpc\":\"2.0\",\"id\":41,\"method\":\"ping\"}"
+      "content-type: application/vscode-jsonrpc; charset=utf-8\r\n"
+      "content-length:\t41 \r\n\r\n"
+      "{\"jsonrpc\":\"2.0\",\"id\":42,\"method\":\"ping\"}";
+  for (size_t offset = 0U; stream[offset] != '\0'; ++offset) {
+    jsonrpc_conn_feed(conn, (const uint8_t *)stream + offset, 1U);
+  }
+  ASSERT_TRUE(context.transport_state.message_count == 2U);
+  // The header is shorter than the room left for it: the commit skips the
+  // unused part instead of moving the body.
+  ASSERT_TRUE(context.transport_state.commit_calls == 2U);
+  ASSERT_TRUE(context.transport_state.last_commit_skip != 0U);
+  for (size_t i = 0U; i < 2U; ++i) {
+    const char *message = context.transport_state.messages[i];
+    const char *body = strstr(message, "\r\n\r\n");
+    ASSERT_TRUE(body != nullptr);
+    body += 4U;
+    char expected[JSONRPC_FRAME_HEADER_MAX + 1U] = {0};
+    ASSERT_TRUE(jsonrpc_frame_header(JSONRPC_FRAMING_CONTENT_LENGTH,
+                                     strlen(body), (uint8_t *)expected) ==
+                (size_t)(body - message));
+    ASSERT_TRUE(strncmp(message, expected, (size_t)(body - message)) == 0);
+    auto response = json_parse_string(body);
+    ASSERT_TRUE(response != nullptr);
+    ASSERT_TRUE(json_object_get_number(json_value_get_object(response),
+                                       "id") == 41.0 + (double)i);
+    json_value_free(response);
+  }
+
+  // A header block without Content-Length cannot be framed.
+  const char *bad = "Content-Type: text/plain\r\n\r\n{}";
+  jsonrpc_conn_feed(conn, (const uint8_t *)bad, strlen(bad));
+  ASSERT_TRUE(context.transport_state.close_calls >= 1U);
+  ASSERT_TRUE(context.transport_state.message_count == 3U);
+  ASSERT_TRUE(strstr(context.transport_state.messages[2],
+                     "Invalid frame header") != nullptr);
+
+  jsonrpc_conn_free(conn);
+  test_transport_state_reset(&context.transport_state);
+  g_active_test_context = nullptr;
+  return true;
+}
+
+// Append a masked client frame (payload under 126 bytes) to out.
+static size_t test_append_ws_frame(uint8_t *out, jsonrpc_ws_opcode_t opcode,
+                                   bool fin, const char *payload) {
+  const size_t len = strlen(payload);
+  const uint8_t mask[4] = {0x12U, 0x34U, 0x56U, 0x78U};
+  out[0] = (uint8_t)((fin ? 0x80U : 0U) | (unsigned)opcode);
+  out[1] = (uint8_t)(0x80U | len);
+  memcpy(out + 2U, mask, sizeof(mask));
+  for (size_t i = 0U; i < len; ++i) {
+    out[6U + i] = (uint8_t)payload[i] ^ mask[i % 4U];
+  }
+  return 6U + len;
+}
+
+static bool test_websocket_framing() {
+  // RFC 6455 section 1.3.
+  uint8_t accept[JSONRPC_WS_ACCEPT_LEN] = {0};
+  jsonrpc_ws_accept_key((const uint8_t *)"dGhlIHNhbXBsZSBub25jZQ==", accept);
+  ASSERT_TRUE(memcmp(accept, "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=",
+                     JSONRPC_WS_ACCEPT_LEN) == 0);
+
+  // The vector loops agree with a byte-wise XOR at every length and offset.
+  uint8_t source[100];
+  uint8_t unmasked[100];
+  const uint8_t mask[4] = {0xA1U, 0xB2U, 0xC3U, 0xD4U};
+  for (size_t i = 0U; i < sizeof(source); ++i) {
+    source[i] = (uint8_t)(i * 7U);
+  }
+  for (size_t offset = 0U; offset < 4U; ++offset) {
+    for (size_t len = 0U; len <= sizeof(source); ++len) {
+      jsonrpc_ws_unmask(unmasked, source, len, mask, offset);
+      for (size_t i = 0U; i < len; ++i) {
+        ASSERT_TRUE(unmasked[i] == (source[i] ^ mask[(offset + i) % 4U]));
+      }
+    }
+  }
+
+  test_context_t context = {0};
+  g_active_test_context = &context;
+  jsonrpc_callbacks_t callbacks = {.on_open = on_open,
+                                   .on_close = on_close,
+                                   .on_request = on_request,
+                                   .on_notification = on_notification};
+  auto conn = test_conn_new_with_callbacks(&context, callbacks);
+  ASSERT_TRUE(conn != nullptr);
+  ASSERT_TRUE(jsonrpc_conn_set_framing(conn, JSONRPC_FRAMING_WEBSOCKET, 0U));
+  ASSERT_TRUE(!jsonrpc_conn_send_notification(conn, "early", nullptr));
+  const test_transport_state_t *sent = &context.transport_state;
+
+  // The handshake arrives a byte at a time.
+  const char *upgrade = "GET /ws HTTP/1.1\r\nHost: test\r\n"
+                        "Upgrade: WebSocket\r\n"
+                        "Connection: keep-alive, Upgrade\r\n"
+                        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                        "Sec-WebSocket-Version: 13\r\n\r\n";
+  for (size_t offset = 0U; upgrade[offset] != '\0'; ++offset) {
+    jsonrpc_conn_feed(conn, (const uint8_t *)upgrade + offset, 1U);
+  }
+  ASSERT_TRUE(sent->message_count == 1U);
+  ASSERT_TRUE(strncmp(sent->messages[0], "HTTP/1.1 101 Switching Protocols",
+                      32U) == 0);
+  ASSERT_TRUE(strstr(sent->messages[0], "Sec-WebSocket-Accept: "
+                                        "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n") !=
+              nullptr);
+
+  // A fragmented message with a ping between its fragments, split at odd
+  // points: the ping is answered at once, the message once it is whole.
+  uint8_t frames[256];
+  size_t frames_len = 0U;
+  frames_len += test_append_ws_frame(frames + frames_len, JSONRPC_WS_TEXT,
+                                     false, "{\"jsonrpc\":\"2.0\",");
+  frames_len +=
+      test_append_ws_frame(frames + frames_len, JSONRPC_WS_PING, true, "hi");
+  frames_len += test_append_ws_frame(frames + frames_len,
+                                     JSONRPC_WS_CONTINUATION, true,
+                                     "\"id\":5,\"method\":\"ping\"}");
+  for (size_t offset = 0U; offset < frames_len; offset += 5U) {
+    const size_t len = frames_len - offset < 5U ? frames_len - offset : 5U;
+    jsonrpc_conn_feed(conn, frames + offset, len);
+  }
+  ASSERT_TRUE(sent->message_count == 3U);
+  ASSERT_TRUE(sent->message_lens[1] == 4U &&
+              memcmp(sent->messages[1], "\x8A\x02hi", 4U) == 0);
+  const char *response = sent->messages[2];
+  ASSERT_TRUE((uint8_t)response[0] == 0x81U &&
+              (size_t)(uint8_t)response[1] == sent->message_lens[2] - 2U);
+  ASSERT_TRUE(strstr(response + 2, "\"id\":5") != nullptr);
+
+  // Server push goes out as a text frame of its own.
+  auto params = json_parse_string("{\"tick\":1}");
+  ASSERT_TRUE(jsonrpc_conn_send_notification(conn, "tick", params));
+  ASSERT_TRUE(sent->message_count == 4U);
+  ASSERT_TRUE((uint8_t)sent->messages[3][0] == 0x81U);
+  ASSERT_TRUE(strcmp(sent->messages[3] + 2,
+                     "{\"jsonrpc\":\"2.0\",\"method\":\"tick\","
+                     "\"params\":{\"tick\":1}}") == 0);
+
+  // A continuation with no message open is a protocol error (1002).
+  frames_len = test_append_ws_frame(frames, JSONRPC_WS_CONTINUATION, true,
+                                    "{}");
+  jsonrpc_conn_feed(conn, frames, frames_len);
+  ASSERT_TRUE(sent->message_count == 5U);
+  ASSERT_TRUE(sent->message_lens[4] == 4U &&
+              memcmp(sent->messages[4], "\x88\x02\x03\xEA", 4U) == 0);
+  ASSERT_TRUE(context.transport_state.close_calls == 1U);
+
+  jsonrpc_conn_free(conn);
+  test_transport_state_reset(&context.transport_state);
+  g_active_test_context = nullptr;
+  return true;
+}
+
 static bool test_request_too_large_closes_connection() {
   test_context_t context = {0};
   g_active_test_context = &context;
@@ -794,6 +1241,1375 @@ static bool test_arena_api_paths() {
   return true;
 }
 
+static bool test_chained_arena_grows_and_settles() {
+  auto arena = arena_create_chained(64U);
+  ASSERT_TRUE(arena != nullptr);
+
+  // Outgrow the first block several times; earlier allocations stay intact.
+  uint8_t *first = arena_alloc(arena, 16U);
+  ASSERT_TRUE(first != nullptr);
+  memset(first, 0xAB, 16U);
+  for (size_t i = 0; i < 100U; i++) {
+    auto bytes = (uint8_t *)arena_alloc(arena, 32U);
+    ASSERT_TRUE(bytes != nullptr);
+    memset(bytes, (int)i, 32U);
+  }
+  ASSERT_TRUE(first[0] == 0xAB && first[15] == 0xAB);
+  ASSERT_TRUE(arena->retired != nullptr);
+  ASSERT_TRUE(arena_alloc_aligned(arena, 1'000U, 64U) != nullptr);
+  ASSERT_TRUE(arena_alloc(arena, SIZE_MAX) == nullptr);
+
+  // Clearing keeps only the largest block, which then fits the same workload.
+  arena_clear(arena);
+  ASSERT_TRUE(arena->retired == nullptr);
+  ASSERT_TRUE(arena->index == 0U);
+  const Arena_Block *kept = arena->block;
+  for (size_t i = 0; i < 100U; i++) {
+    ASSERT_TRUE(arena_alloc(arena, 32U) != nullptr);
+  }
+  ASSERT_TRUE(arena->block == kept);
+  ASSERT_TRUE(arena->retired == nullptr);
+
+  arena_destroy(arena);
+  ASSERT_TRUE(arena_create_chained(0U) == nullptr);
+  return true;
+}
+
+static size_t g_pool_released = 0U;
+
+static void test_pool_release(void *item) {
+  g_pool_released += 1U;
+  free(item);
+}
+
+static bool test_pool_watermarks_and_trim() {
+  g_pool_released = 0U;
+  jsonrpc_pool_t pool;
+  ASSERT_TRUE(jsonrpc_pool_init(&pool, 4U, 1U, test_pool_release));
+  ASSERT_TRUE(jsonrpc_pool_get(&pool) == nullptr);
+
+  void *items[6];
+  for (size_t i = 0U; i < 6U; ++i) {
+    items[i] = calloc(1U, 16U);
+    ASSERT_TRUE(items[i] != nullptr);
+  }
+  // Past the high watermark, put releases instead of keeping.
+  for (size_t i = 0U; i < 6U; ++i) {
+    jsonrpc_pool_put(&pool, items[i]);
+  }
+  ASSERT_TRUE(pool.count == 4U);
+  ASSERT_TRUE(g_pool_released == 2U);
+  ASSERT_TRUE(jsonrpc_pool_get(&pool) == items[3]);
+  jsonrpc_pool_put(&pool, items[3]);
+
+  // Reuse since the last tick postpones the trim; an idle tick trims to low.
+  jsonrpc_pool_idle_trim(&pool);
+  ASSERT_TRUE(pool.count == 4U);
+  jsonrpc_pool_idle_trim(&pool);
+  ASSERT_TRUE(pool.count == 1U);
+  ASSERT_TRUE(pool.trimmed == 3U);
+  jsonrpc_pool_destroy(&pool);
+  ASSERT_TRUE(g_pool_released == 6U);
+
+  // A high watermark of 0 keeps nothing.
+  ASSERT_TRUE(jsonrpc_pool_init(&pool, 0U, 0U, test_pool_release));
+  jsonrpc_pool_put(&pool, calloc(1U, 16U));
+  ASSERT_TRUE(pool.count == 0U && g_pool_released == 7U);
+  jsonrpc_pool_destroy(&pool);
+
+  // Connections hand their arena back for reuse.
+  test_context_t context = {0};
+  g_active_test_context = &context;
+  auto conn = test_conn_new(&context);
+  ASSERT_TRUE(conn != nullptr);
+  auto arena = arena_create_chained(256U);
+  ASSERT_TRUE(arena != nullptr);
+  ASSERT_TRUE(jsonrpc_conn_set_arena(conn, arena));
+  ASSERT_TRUE(!jsonrpc_conn_set_arena(conn, arena));
+  const char *request = "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"ping\"}\n";
+  jsonrpc_conn_feed(conn, (const uint8_t *)request, strlen(request));
+  ASSERT_TRUE(context.transport_state.message_count == 1U);
+  ASSERT_TRUE(jsonrpc_conn_take_arena(conn) == arena);
+  ASSERT_TRUE(arena->index == 0U);
+  ASSERT_TRUE(jsonrpc_conn_take_arena(conn) == nullptr);
+  jsonrpc_conn_free(conn);
+  arena_destroy(arena);
+  test_transport_state_reset(&context.transport_state);
+  g_active_test_context = nullptr;
+  return true;
+}
+
+static bool test_feed_through_reused_slab() {
+  test_context_t context = {0};
+  g_active_test_context = &context;
+  auto conn = test_conn_new(&context);
+  ASSERT_TRUE(conn != nullptr);
+
+  // With a shared read buffer every feed comes from the same slab, which is
+  // overwritten as soon as the call returns: complete messages must be parsed
+  // from it in place and an unterminated tail kept only as a copy.
+  jsonrpc_conn_set_shared_reads(conn, true);
+  const char stream[] = "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"ping\"}\n"
+                        "{\"jsonrpc\":\"2.0\",\"id\":2,\"method\":\"ping\"}\n"
+                        "{\"jsonrpc\":\"2.0\",\"id\":3,\"method\":\"ping\"}\n";
+  constexpr size_t chunk_len = 50U;
+  const size_t stream_len = sizeof(stream) - 1U;
+  uint8_t slab[chunk_len];
+  for (size_t offset = 0U; offset < stream_len; offset += chunk_len) {
+    const size_t remaining = stream_len - offset;
+    const size_t len = remaining < chunk_len ? remaining : chunk_len;
+    memcpy(slab, stream + offset, len);
+    jsonrpc_conn_feed(conn, slab, len);
+    memset(slab, '}', sizeof(slab));
+  }
+
+  ASSERT_TRUE(context.transport_state.message_count == 3U);
+  for (size_t i = 0U; i < 3U; ++i) {
+    auto response = test_parse_sent_json(&context.transport_state, i);
+    ASSERT_TRUE(response != nullptr);
+    ASSERT_TRUE(json_object_get_number(json_value_get_object(response), "id") ==
+                (double)(i + 1U));
+    json_value_free(response);
+  }
+
+  jsonrpc_conn_free(conn);
+  test_transport_state_reset(&context.transport_state);
+  g_active_test_context = nullptr;
+  return true;
+}
+
+static bool test_conn_memory_accounting() {
+  test_context_t context = {0};
+  g_active_test_context = &context;
+  auto conn = test_conn_new(&context);
+  ASSERT_TRUE(conn != nullptr);
+
+  // A partial message is buffered and counted until it completes; with shared
+  // reads the drained inbound buffer is then freed and no longer counted.
+  jsonrpc_conn_set_shared_reads(conn, true);
+  const char *head = "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"ping\"}\n"
+                     "{\"jsonrpc\":\"2.0\",\"id\":2,";
+  const char *tail = "\"method\":\"ping\"}\n";
+  const size_t partial_len = strlen(strchr(head, '\n') + 1);
+  jsonrpc_conn_feed(conn, (const uint8_t *)head, strlen(head));
+  ASSERT_TRUE(context.transport_state.message_count == 1U);
+  ASSERT_TRUE(jsonrpc_conn_pending_input(conn) == partial_len);
+  const size_t buffering_usage = jsonrpc_conn_memory_usage(conn);
+
+  jsonrpc_conn_feed(conn, (const uint8_t *)tail, strlen(tail));
+  ASSERT_TRUE(context.transport_state.message_count == 2U);
+  ASSERT_TRUE(jsonrpc_conn_pending_input(conn) == 0U);
+  const size_t drained_usage = jsonrpc_conn_memory_usage(conn);
+  ASSERT_TRUE(drained_usage + partial_len <= buffering_usage);
+
+  // Otherwise the buffer is kept for the next partial message.
+  jsonrpc_conn_set_shared_reads(conn, false);
+  jsonrpc_conn_feed(conn, (const uint8_t *)head, strlen(head));
+  jsonrpc_conn_feed(conn, (const uint8_t *)tail, strlen(tail));
+  ASSERT_TRUE(context.transport_state.message_count == 4U);
+  ASSERT_TRUE(jsonrpc_conn_pending_input(conn) == 0U);
+  ASSERT_TRUE(jsonrpc_conn_memory_usage(conn) >= drained_usage + partial_len);
+
+  // Trimming drops the idle buffers and an arena grown by a large message;
+  // the next message allocates them again.
+  char large[16'384];
+  size_t large_len = (size_t)snprintf(
+      large, sizeof(large), "{\"jsonrpc\":\"2.0\",\"id\":3,\"method\":"
+                            "\"ping\",\"params\":[0");
+  while (large_len < sizeof(large) - 16U) {
+    memcpy(large + large_len, ",0", 2U);
+    large_len += 2U;
+  }
+  memcpy(large + large_len, "]}\n", 3U);
+  large_len += 3U;
+  jsonrpc_conn_feed(conn, (const uint8_t *)large, large_len);
+  ASSERT_TRUE(context.transport_state.message_count == 5U);
+  const size_t grown_usage = jsonrpc_conn_memory_usage(conn);
+  jsonrpc_conn_trim(conn);
+  ASSERT_TRUE(jsonrpc_conn_memory_usage(conn) + sizeof(large) <= grown_usage);
+  jsonrpc_conn_feed(conn, (const uint8_t *)head, strlen(head));
+  jsonrpc_conn_feed(conn, (const uint8_t *)tail, strlen(tail));
+  ASSERT_TRUE(context.transport_state.message_count == 7U);
+
+  jsonrpc_conn_free(conn);
+  test_transport_state_reset(&context.transport_state);
+  g_active_test_context = nullptr;
+  return true;
+}
+
+static size_t g_timer_fired = 0U;
+static jsonrpc_timer_wheel_t *g_timer_wheel = nullptr;
+
+static void test_timer_fired(jsonrpc_timer_t *timer) {
+  g_timer_fired += 1U;
+  // Timers carrying a peer cancel it from their callback.
+  if (timer->data != nullptr) {
+    jsonrpc_timer_wheel_cancel(g_timer_wheel, (jsonrpc_timer_t *)timer->data);
+  }
+}
+
+static bool test_timer_wheel_expiry_and_rounds() {
+  g_timer_fired = 0U;
+  jsonrpc_timer_wheel_t wheel;
+  g_timer_wheel = &wheel;
+  ASSERT_TRUE(!jsonrpc_timer_wheel_init(&wheel, 8U, 0U, 0U));
+  // 6 slots round up to 8; ticks are 10 ms, so one revolution is 80 ms.
+  ASSERT_TRUE(jsonrpc_timer_wheel_init(&wheel, 6U, 10U, 1'000U));
+  ASSERT_TRUE(wheel.slot_count == 8U);
+
+  jsonrpc_timer_t soon;
+  jsonrpc_timer_t far;
+  jsonrpc_timer_t past;
+  jsonrpc_timer_init(&soon, test_timer_fired, nullptr);
+  jsonrpc_timer_init(&far, test_timer_fired, nullptr);
+  jsonrpc_timer_init(&past, test_timer_fired, nullptr);
+  jsonrpc_timer_wheel_schedule(&wheel, &soon, 1'025U);
+  // Same slot as soon, one revolution later.
+  jsonrpc_timer_wheel_schedule(&wheel, &far, 1'105U);
+  jsonrpc_timer_wheel_schedule(&wheel, &past, 900U);
+  ASSERT_TRUE(wheel.armed == 3U);
+
+  // Never early: a deadline inside a tick waits for the tick's end.
+  ASSERT_TRUE(jsonrpc_timer_wheel_advance(&wheel, 1'020U) == 1U);
+  ASSERT_TRUE(!past.armed && soon.armed);
+  ASSERT_TRUE(jsonrpc_timer_wheel_advance(&wheel, 1'030U) == 1U);
+  ASSERT_TRUE(!soon.armed && far.armed);
+  // Rescheduling moves the timer; cancelling disarms it.
+  jsonrpc_timer_wheel_schedule(&wheel, &soon, 1'050U);
+  jsonrpc_timer_wheel_cancel(&wheel, &soon);
+  ASSERT_TRUE(!soon.armed && wheel.armed == 1U);
+  ASSERT_TRUE(jsonrpc_timer_wheel_advance(&wheel, 1'100U) == 0U);
+  // A jump of several revolutions still expires it exactly once.
+  ASSERT_TRUE(jsonrpc_timer_wheel_advance(&wheel, 2'000U) == 1U);
+  ASSERT_TRUE(g_timer_fired == 3U && wheel.armed == 0U);
+
+  // A callback may cancel the next timer of the slot being expired.
+  jsonrpc_timer_t first;
+  jsonrpc_timer_t second;
+  jsonrpc_timer_init(&second, test_timer_fired, nullptr);
+  jsonrpc_timer_init(&first, test_timer_fired, &second);
+  jsonrpc_timer_wheel_schedule(&wheel, &second, 2'010U);
+  jsonrpc_timer_wheel_schedule(&wheel, &first, 2'010U);
+  ASSERT_TRUE(jsonrpc_timer_wheel_advance(&wheel, 2'010U) == 1U);
+  ASSERT_TRUE(!second.armed && g_timer_fired == 4U);
+
+  jsonrpc_timer_wheel_schedule(&wheel, &far, 5'000U);
+  jsonrpc_timer_wheel_destroy(&wheel);
+  ASSERT_TRUE(!far.armed && far.callback == test_timer_fired);
+  g_timer_wheel = nullptr;
+  return true;
+}
+
+static bool test_write_queue_watermarks() {
+  // The low mark defaults to a quarter of high when it is not below it.
+  const jsonrpc_watermarks_t defaulted = jsonrpc_watermarks_make(1'000U, 0U);
+  ASSERT_TRUE(defaulted.low == 0U);
+  const jsonrpc_watermarks_t clamped = jsonrpc_watermarks_make(1'000U, 2'000U);
+  ASSERT_TRUE(clamped.low == 250U);
+  const jsonrpc_watermarks_t marks = jsonrpc_watermarks_make(1'000U, 400U);
+
+  // Running: only crossing high pauses.
+  ASSERT_TRUE(jsonrpc_watermarks_check(&marks, 0U, false) ==
+              JSONRPC_WATERMARK_HOLD);
+  ASSERT_TRUE(jsonrpc_watermarks_check(&marks, 1'000U, false) ==
+              JSONRPC_WATERMARK_HOLD);
+  ASSERT_TRUE(jsonrpc_watermarks_check(&marks, 1'001U, false) ==
+              JSONRPC_WATERMARK_PAUSE);
+  // Paused: between the marks it stays paused, at low it resumes.
+  ASSERT_TRUE(jsonrpc_watermarks_check(&marks, 2'000U, true) ==
+              JSONRPC_WATERMARK_HOLD);
+  ASSERT_TRUE(jsonrpc_watermarks_check(&marks, 401U, true) ==
+              JSONRPC_WATERMARK_HOLD);
+  ASSERT_TRUE(jsonrpc_watermarks_check(&marks, 400U, true) ==
+              JSONRPC_WATERMARK_RESUME);
+
+  // High 0 disables them.
+  const jsonrpc_watermarks_t off = jsonrpc_watermarks_make(0U, 0U);
+  ASSERT_TRUE(jsonrpc_watermarks_check(&off, SIZE_MAX, false) ==
+              JSONRPC_WATERMARK_HOLD);
+  return true;
+}
+
+static bool test_admission_budget_and_shedding() {
+  const jsonrpc_admission_t open_door = {0};
+  ASSERT_TRUE(jsonrpc_admission_check(&open_door, UINT32_MAX, SIZE_MAX) ==
+              JSONRPC_ADMIT_ACCEPT);
+
+  jsonrpc_admission_t policy = {.max_connections = 10U,
+                                .accepts_per_tick = 4U};
+  ASSERT_TRUE(jsonrpc_admission_check(&policy, 3U, 9U) ==
+              JSONRPC_ADMIT_ACCEPT);
+  // A spent budget defers before the cap is even looked at.
+  ASSERT_TRUE(jsonrpc_admission_check(&policy, 4U, 0U) ==
+              JSONRPC_ADMIT_DEFER);
+  ASSERT_TRUE(jsonrpc_admission_check(&policy, 4U, 10U) ==
+              JSONRPC_ADMIT_DEFER);
+  // At the cap arrivals are shed, or queued when pausing.
+  ASSERT_TRUE(jsonrpc_admission_check(&policy, 0U, 10U) ==
+              JSONRPC_ADMIT_SHED);
+  policy.pause_at_limit = true;
+  ASSERT_TRUE(jsonrpc_admission_check(&policy, 0U, 10U) ==
+              JSONRPC_ADMIT_PAUSE);
+  // Back under the cap the listener admits again.
+  ASSERT_TRUE(jsonrpc_admission_check(&policy, 0U, 9U) ==
+              JSONRPC_ADMIT_ACCEPT);
+  return true;
+}
+
+static bool test_message_clock_restarts_on_progress() {
+  test_context_t context = {0};
+  g_active_test_context = &context;
+  auto conn = test_conn_new(&context);
+  ASSERT_TRUE(conn != nullptr);
+
+  // A peer pipelines requests and every read ends mid-message. The message
+  // timeout (1000 ms here) runs from the start of the current partial
+  // message, not from the first one the connection ever buffered.
+  constexpr uint64_t timeout_ms = 1'000U;
+  jsonrpc_partial_clock_t clock = {0};
+  const char *reads[] = {
+      "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"ping\"}\n{\"jsonrpc\":",
+      "\"2.0\",\"id\":2,\"method\":\"ping\"}\n{\"jsonrpc\":\"2.0\",",
+      "\"id\":3,",
+  };
+  const uint64_t read_at[] = {0U, 600U, 1'200U};
+  const bool restarts[] = {true, true, false};
+  for (size_t i = 0U; i < 3U; ++i) {
+    jsonrpc_conn_feed(conn, (const uint8_t *)reads[i], strlen(reads[i]));
+    ASSERT_TRUE(jsonrpc_conn_pending_input(conn) != 0U);
+    ASSERT_TRUE(jsonrpc_partial_clock_update(
+                    &clock, read_at[i], jsonrpc_conn_pending_input(conn),
+                    jsonrpc_conn_messages_completed(conn)) == restarts[i]);
+  }
+  ASSERT_TRUE(jsonrpc_conn_messages_completed(conn) == 2U);
+  ASSERT_TRUE(context.transport_state.message_count == 2U);
+  // Past the timeout counted from the first partial message, but not from
+  // the one still buffered; a read that only adds to it does not help.
+  ASSERT_TRUE(clock.pending && clock.since == 600U);
+  ASSERT_TRUE(1'200U < clock.since + timeout_ms);
+  ASSERT_TRUE(1'600U >= clock.since + timeout_ms);
+
+  // Finishing the last message stops the clock.
+  const char *tail = "\"method\":\"ping\"}\n";
+  jsonrpc_conn_feed(conn, (const uint8_t *)tail, strlen(tail));
+  ASSERT_TRUE(!jsonrpc_partial_clock_update(
+      &clock, 1'300U, jsonrpc_conn_pending_input(conn),
+      jsonrpc_conn_messages_completed(conn)));
+  ASSERT_TRUE(!clock.pending);
+
+  jsonrpc_conn_free(conn);
+  test_transport_state_reset(&context.transport_state);
+  g_active_test_context = nullptr;
+  return true;
+}
+
+static bool test_grow_sink(JSON_Output_Sink *sink, size_t min_free) {
+  const size_t new_cap = sink->len + min_free;
+  auto grown = (char *)calloc(new_cap, sizeof(char));
+  if (grown == nullptr) {
+    return false;
+  }
+  if (sink->data != nullptr) {
+    memcpy(grown, sink->data, sink->len);
+  }
+  free(sink->data);
+  sink->data = grown;
+  sink->cap = new_cap;
+  return true;
+}
+
+static bool test_serialize_to_sink_matches_string() {
+  const char *document =
+      "{\"a\":[1,2.5,-3e+20,true,false,null],\"s\":\"q\\\"\\\\\\n\\u0001/\","
+      "\"o\":{\"nested\":[{},[]]}}";
+  auto value = json_parse_string(document);
+  ASSERT_TRUE(value != nullptr);
+  auto expected = json_serialize_to_string(value);
+  ASSERT_TRUE(expected != nullptr);
+
+  JSON_Output_Sink sink = {.data = nullptr,
+                           .len = 0U,
+                           .cap = 0U,
+                           .grow = test_grow_sink,
+                           .user_data = nullptr};
+  ASSERT_TRUE(json_serialize_to_sink(value, &sink, 1U) == JSONSuccess);
+  ASSERT_TRUE(sink.len == strlen(expected));
+  ASSERT_TRUE(memcmp(sink.data, expected, sink.len) == 0);
+  ASSERT_TRUE(sink.cap - sink.len >= 1U);
+
+  // Appending keeps earlier output and a failed grow restores len.
+  const size_t first_len = sink.len;
+  ASSERT_TRUE(json_serialize_to_sink(value, &sink, 0U) == JSONSuccess);
+  ASSERT_TRUE(sink.len == first_len * 2U);
+  ASSERT_TRUE(memcmp(sink.data + first_len, expected, first_len) == 0);
+  sink.grow = nullptr;
+  ASSERT_TRUE(json_serialize_to_sink(value, &sink, sink.cap) == JSONFailure);
+  ASSERT_TRUE(sink.len == first_len * 2U);
+
+  free(sink.data);
+  json_free_serialized_string(expected);
+  json_value_free(value);
+  return true;
+}
+
+static bool test_msgpack_round_trip() {
+  // Smallest encodings: fixmap, fixstr, fixarray, fixints, uint16, float32.
+  auto small = json_parse_string("{\"a\":[1,-1,300,2.5]}");
+  ASSERT_TRUE(small != nullptr);
+  JSON_Output_Sink sink = {.data = nullptr,
+                           .len = 0U,
+                           .cap = 0U,
+                           .grow = test_grow_sink,
+                           .user_data = nullptr};
+  ASSERT_TRUE(jsonrpc_msgpack_encode(small, &sink));
+  static const uint8_t expected[] = {0x81, 0xA1, 'a',  0x94, 0x01,
+                                     0xFF, 0xCD, 0x01, 0x2C, 0xCA,
+                                     0x40, 0x20, 0x00, 0x00};
+  ASSERT_TRUE(sink.len == sizeof(expected));
+  ASSERT_TRUE(memcmp(sink.data, expected, sizeof(expected)) == 0);
+  json_value_free(small);
+
+  // Every type and width decodes back to an equal DOM.
+  char long_string[300];
+  memset(long_string, 'x', sizeof(long_string) - 1U);
+  long_string[sizeof(long_string) - 1U] = '\0';
+  char document[1'024];
+  (void)snprintf(document, sizeof(document),
+                 "{\"ints\":[0,127,128,65535,65536,4294967296,-32,-33,-129,"
+                 "-32769,-2147483649],\"floats\":[0.1,-1.5e300,-0.0],"
+                 "\"s\":\"\\u00e9\\u0000%.40s\",\"long\":\"%s\","
+                 "\"nested\":{\"t\":true,\"f\":false,\"n\":null,\"e\":[]}}",
+                 long_string, long_string);
+  auto value = json_parse_string(document);
+  ASSERT_TRUE(value != nullptr);
+  sink.len = 0U;
+  ASSERT_TRUE(jsonrpc_msgpack_encode(value, &sink));
+  auto decoded = jsonrpc_msgpack_decode((const uint8_t *)sink.data, sink.len);
+  ASSERT_TRUE(decoded != nullptr);
+  ASSERT_TRUE(json_value_equals(value, decoded));
+  json_value_free(decoded);
+
+  // Truncated or trailing input, a non-string or repeated key, bin data and
+  // the unused tag are all rejected.
+  ASSERT_TRUE(jsonrpc_msgpack_decode((const uint8_t *)sink.data,
+                                     sink.len - 1U) == nullptr);
+  static const uint8_t trailing[] = {0x90, 0xC0};
+  static const uint8_t int_key[] = {0x81, 0x01, 0xC0};
+  static const uint8_t repeated_key[] = {0x82, 0xA1, 'k', 0x01,
+                                         0xA1, 'k',  0x02};
+  static const uint8_t bin[] = {0xC4, 0x01, 0x00};
+  static const uint8_t never_used[] = {0xC1};
+  ASSERT_TRUE(jsonrpc_msgpack_decode(trailing, sizeof(trailing)) == nullptr);
+  ASSERT_TRUE(jsonrpc_msgpack_decode(int_key, sizeof(int_key)) == nullptr);
+  ASSERT_TRUE(jsonrpc_msgpack_decode(repeated_key, sizeof(repeated_key)) ==
+              nullptr);
+  ASSERT_TRUE(jsonrpc_msgpack_decode(bin, sizeof(bin)) == nullptr);
+  ASSERT_TRUE(jsonrpc_msgpack_decode(never_used, sizeof(never_used)) ==
+              nullptr);
+
+  free(sink.data);
+  json_value_free(value);
+  return true;
+}
+
+// Append json, encoded as MessagePack, to sink as one length-prefixed frame.
+static bool test_append_msgpack_frame(JSON_Output_Sink *sink,
+                                      const char *json) {
+  auto value = json_parse_string(json);
+  if (value == nullptr || (sink->cap - sink->len < 4U &&
+                           !test_grow_sink(sink, 4U))) {
+    json_value_free(value);
+    return false;
+  }
+  const size_t header_at = sink->len;
+  sink->len += 4U;
+  const bool encoded = jsonrpc_msgpack_encode(value, sink);
+  json_value_free(value);
+  return encoded &&
+         jsonrpc_frame_header(JSONRPC_FRAMING_LENGTH_PREFIX,
+                              sink->len - header_at - 4U,
+                              (uint8_t *)sink->data + header_at) == 4U;
+}
+
+static bool test_msgpack_encoding_negotiation() {
+  test_context_t context = {0};
+  g_active_test_context = &context;
+  auto conn = test_conn_new(&context);
+  ASSERT_TRUE(conn != nullptr);
+  ASSERT_TRUE(!jsonrpc_conn_allow_msgpack(conn));
+  ASSERT_TRUE(
+      jsonrpc_conn_set_framing(conn, JSONRPC_FRAMING_LENGTH_PREFIX, 0U));
+  ASSERT_TRUE(jsonrpc_conn_allow_msgpack(conn));
+  ASSERT_TRUE(jsonrpc_conn_get_encoding(conn) == JSONRPC_ENCODING_JSON);
+
+  // A MessagePack batch switches the connection; the batch response and a
+  // later parse error come back as MessagePack too.
+  JSON_Output_Sink sink = {.data = nullptr,
+                           .len = 0U,
+                           .cap = 0U,
+                           .grow = test_grow_sink,
+                           .user_data = nullptr};
+  ASSERT_TRUE(test_append_msgpack_frame(
+      &sink, "[{\"jsonrpc\":\"2.0\",\"id\":7,\"method\":\"ping\"},"
+             "{\"jsonrpc\":\"2.0\",\"id\":8,\"method\":\"raise\"}]"));
+  jsonrpc_conn_feed(conn, (const uint8_t *)sink.data, sink.len);
+  ASSERT_TRUE(jsonrpc_conn_get_encoding(conn) == JSONRPC_ENCODING_MSGPACK);
+  ASSERT_TRUE(
+      !jsonrpc_conn_set_framing(conn, JSONRPC_FRAMING_NEWLINE, 0U));
+  static const uint8_t bad_frame[] = {0x00, 0x00, 0x00, 0x02, 0x81, 0xC1};
+  jsonrpc_conn_feed(conn, bad_frame, sizeof(bad_frame));
+  ASSERT_TRUE(context.transport_state.message_count == 2U);
+
+  const auto batch_bytes = (const uint8_t *)context.transport_state.messages[0];
+  auto batch = jsonrpc_msgpack_decode(
+      batch_bytes + 4U, context.transport_state.message_lens[0] - 4U);
+  ASSERT_TRUE(batch != nullptr);
+  auto responses = json_value_get_array(batch);
+  ASSERT_TRUE(json_array_get_count(responses) == 2U);
+  auto pong = json_array_get_object(responses, 0U);
+  ASSERT_TRUE(json_object_get_number(pong, "id") == 7.0);
+  ASSERT_TRUE(strcmp(json_object_get_string(pong, "result"), "pong") == 0);
+  auto raised = json_object_get_object(json_array_get_object(responses, 1U),
+                                       "error");
+  ASSERT_TRUE((int32_t)json_object_get_number(raised, "code") ==
+              JSONRPC_ERR_INTERNAL);
+  json_value_free(batch);
+
+  const auto error_bytes = (const uint8_t *)context.transport_state.messages[1];
+  auto parse_err = jsonrpc_msgpack_decode(
+      error_bytes + 4U, context.transport_state.message_lens[1] - 4U);
+  ASSERT_TRUE(parse_err != nullptr);
+  auto error_obj =
+      json_object_get_object(json_value_get_object(parse_err), "error");
+  ASSERT_TRUE((int32_t)json_object_get_number(error_obj, "code") ==
+              JSONRPC_ERR_PARSE);
+  json_value_free(parse_err);
+  jsonrpc_conn_free(conn);
+  test_transport_state_reset(&context.transport_state);
+
+  // A connection that opens with JSON stays on JSON.
+  conn = test_conn_new(&context);
+  ASSERT_TRUE(conn != nullptr);
+  ASSERT_TRUE(
+      jsonrpc_conn_set_framing(conn, JSONRPC_FRAMING_LENGTH_PREFIX, 0U));
+  ASSERT_TRUE(jsonrpc_conn_allow_msgpack(conn));
+  const char *ping = "{\"jsonrpc\":\"2.0\",\"id\":9,\"method\":\"ping\"}";
+  uint8_t header[JSONRPC_FRAME_HEADER_MAX];
+  ASSERT_TRUE(jsonrpc_frame_header(JSONRPC_FRAMING_LENGTH_PREFIX, strlen(ping),
+                                   header) == 4U);
+  jsonrpc_conn_feed(conn, header, 4U);
+  jsonrpc_conn_feed(conn, (const uint8_t *)ping, strlen(ping));
+  ASSERT_TRUE(jsonrpc_conn_get_encoding(conn) == JSONRPC_ENCODING_JSON);
+  auto response = test_parse_length_prefixed(&context.transport_state, 0U);
+  ASSERT_TRUE(response != nullptr);
+  ASSERT_TRUE(json_object_get_number(json_value_get_object(response), "id") ==
+              9.0);
+  json_value_free(response);
+  jsonrpc_conn_free(conn);
+  test_transport_state_reset(&context.transport_state);
+
+  // So does one whose first message starts with a UTF-8 BOM.
+  conn = test_conn_new(&context);
+  ASSERT_TRUE(conn != nullptr);
+  ASSERT_TRUE(
+      jsonrpc_conn_set_framing(conn, JSONRPC_FRAMING_LENGTH_PREFIX, 0U));
+  ASSERT_TRUE(jsonrpc_conn_allow_msgpack(conn));
+  const char *bom_ping =
+      "\xEF\xBB\xBF{\"jsonrpc\":\"2.0\",\"id\":10,\"method\":\"ping\"}";
+  ASSERT_TRUE(jsonrpc_frame_header(JSONRPC_FRAMING_LENGTH_PREFIX,
+                                   strlen(bom_ping), header) == 4U);
+  jsonrpc_conn_feed(conn, header, 4U);
+  jsonrpc_conn_feed(conn, (const uint8_t *)bom_ping, strlen(bom_ping));
+  ASSERT_TRUE(jsonrpc_conn_get_encoding(conn) == JSONRPC_ENCODING_JSON);
+  response = test_parse_length_prefixed(&context.transport_state, 0U);
+  ASSERT_TRUE(response != nullptr);
+  ASSERT_TRUE(json_object_get_number(json_value_get_object(response), "id") ==
+              10.0);
+  json_value_free(response);
+
+  free(sink.data);
+  jsonrpc_conn_free(conn);
+  test_transport_state_reset(&context.transport_state);
+  g_active_test_context = nullptr;
+  return true;
+}
+
+static bool test_transport_reserve_commit_path() {
+  test_context_t context = {0};
+  g_active_test_context = &context;
+  jsonrpc_transport_t transport = {.user_data = &context.transport_state,
+                                   .send_raw = test_send_raw,
+                                   .close = test_close,
+                                   .reserve = test_reserve,
+                                   .commit = test_commit};
+  jsonrpc_callbacks_t callbacks = {.on_open = on_open,
+                                   .on_close = on_close,
+                                   .on_request = on_request,
+                                   .on_notification = on_notification};
+  auto conn = jsonrpc_conn_new(transport, callbacks, &context);
+  ASSERT_TRUE(conn != nullptr);
+
+  const char *request = "{\"jsonrpc\":\"2.0\",\"id\":31,\"method\":\"ping\"}\n";
+  jsonrpc_conn_feed(conn, (const uint8_t *)request, strlen(request));
+
+  ASSERT_TRUE(context.transport_state.commit_calls == 1U);
+  ASSERT_TRUE(context.transport_state.reserve_calls > 1U);
+  ASSERT_TRUE(context.transport_state.message_count == 1U);
+  auto response = test_parse_sent_json(&context.transport_state, 0U);
+  ASSERT_TRUE(response != nullptr);
+  auto response_obj = json_value_get_object(response);
+  ASSERT_TRUE(json_object_get_number(response_obj, "id") == 31.0);
+  ASSERT_TRUE(strcmp(json_object_get_string(response_obj, "result"), "pong") ==
+              0);
+  json_value_free(response);
+
+  jsonrpc_conn_free(conn);
+  test_transport_state_reset(&context.transport_state);
+  g_active_test_context = nullptr;
+  return true;
+}
+
+static bool test_parse_string_with_len_bounds() {
+  // The bytes past len must never be read: each document is followed by
+  // input that would change the result if the parser ran over its end.
+  const char buffer[] = "{\"n\":12}345\n[true]false";
+  auto value = json_parse_string_with_len(buffer, strlen("{\"n\":12}"));
+  ASSERT_TRUE(value != nullptr);
+  ASSERT_TRUE(json_object_get_number(json_object(value), "n") == 12.0);
+  json_value_free(value);
+
+  value = json_parse_string_with_len(buffer + 8, 2U);
+  ASSERT_TRUE(value != nullptr);
+  ASSERT_TRUE(json_value_get_number(value) == 34.0);
+  json_value_free(value);
+
+  ASSERT_TRUE(json_parse_string_with_len(buffer + 12, 5U) == nullptr);
+  ASSERT_TRUE(json_parse_string_with_len(buffer + 18, 4U) == nullptr);
+  ASSERT_TRUE(json_parse_string_with_len("\"\\u00", 5U) == nullptr);
+
+  const char with_nul[] = "{\"a\":1}\0{}";
+  ASSERT_TRUE(json_parse_string_with_len(with_nul, sizeof(with_nul) - 1U) ==
+              nullptr);
+  ASSERT_TRUE(json_parse_string_with_len("[1] x", 5U) == nullptr);
+  // Numbers are parsed in place unless they run up to the end of the input.
+  const char numbers[] = "[0x10]-Infinity -]1.5e3 0.0000000000000000000000"
+                         "0000000000000000000000000000000000000000000000000"
+                         "000000000000000000001";
+  ASSERT_TRUE(json_parse_string_with_len(numbers, 6U) == nullptr);
+  ASSERT_TRUE(json_parse_string_with_len(numbers + 6, 10U) == nullptr);
+  ASSERT_TRUE(json_parse_string_with_len(numbers + 16, 2U) == nullptr);
+  value = json_parse_string_with_len(numbers + 18, 6U);
+  ASSERT_TRUE(value != nullptr && json_value_get_number(value) == 1500.0);
+  json_value_free(value);
+  value = json_parse_string_with_len(numbers + 24, strlen(numbers + 24));
+  ASSERT_TRUE(value != nullptr && json_value_get_number(value) == 1e-92);
+  json_value_free(value);
+  value = json_parse_string_with_len(" [1]\t", 5U);
+  ASSERT_TRUE(value != nullptr);
+  json_value_free(value);
+  return true;
+}
+
+static size_t g_route_calls = 0U;
+
+static bool test_route_handler(jsonrpc_conn_t *conn [[maybe_unused]],
+                               const JSON_Value *params [[maybe_unused]],
+                               jsonrpc_response_t *response, void *user_data) {
+  g_route_calls += 1U;
+  const auto slot = (uintptr_t)user_data;
+  if (slot == UINTPTR_MAX) {
+    return false;
+  }
+  response->result = json_value_init_number((double)slot);
+  return response->result != nullptr;
+}
+
+static bool test_router_dispatch() {
+  test_context_t context = {0};
+  g_active_test_context = &context;
+  g_route_calls = 0U;
+
+  constexpr size_t method_count = 300U;
+  auto router = jsonrpc_router_new();
+  ASSERT_TRUE(router != nullptr);
+  char name[32];
+  for (size_t i = 0U; i < method_count; ++i) {
+    snprintf(name, sizeof(name), "m%zu", i);
+    ASSERT_TRUE(jsonrpc_router_add(router, name, test_route_handler,
+                                   JSONRPC_METHOD_DEFAULT, (void *)(uintptr_t)i));
+  }
+  ASSERT_TRUE(!jsonrpc_router_add(router, "m7", test_route_handler,
+                                  JSONRPC_METHOD_DEFAULT, nullptr));
+  ASSERT_TRUE(jsonrpc_router_add(router, "quiet", test_route_handler,
+                                 JSONRPC_METHOD_REQUEST_ONLY, nullptr));
+  ASSERT_TRUE(jsonrpc_router_add(router, "declines", test_route_handler,
+                                 JSONRPC_METHOD_DEFAULT,
+                                 (void *)(uintptr_t)UINTPTR_MAX));
+  ASSERT_TRUE(jsonrpc_router_count(router) == method_count + 2U);
+  ASSERT_TRUE(jsonrpc_router_find(router, "m299", 4U) != nullptr);
+  ASSERT_TRUE(jsonrpc_router_find(router, "m2999", 4U) != nullptr);
+  ASSERT_TRUE(jsonrpc_router_find(router, "m300", 4U) == nullptr);
+
+  jsonrpc_callbacks_t callbacks = {.on_open = on_open,
+                                   .on_close = on_close,
+                                   .on_request = on_request,
+                                   .on_notification = on_notification,
+                                   .router = router};
+  auto conn = test_conn_new_with_callbacks(&context, callbacks);
+  ASSERT_TRUE(conn != nullptr);
+
+  const char *input =
+      "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"m123\"}\n"
+      "{\"jsonrpc\":\"2.0\",\"id\":2,\"method\":\"ping\"}\n"
+      "{\"jsonrpc\":\"2.0\",\"id\":3,\"method\":\"declines\"}\n"
+      "{\"jsonrpc\":\"2.0\",\"method\":\"quiet\"}\n"
+      "{\"jsonrpc\":\"2.0\",\"method\":\"m5\"}\n";
+  jsonrpc_conn_feed(conn, (const uint8_t *)input, strlen(input));
+
+  // m123 and declines (request) plus m5 (notification); quiet is dropped.
+  ASSERT_TRUE(g_route_calls == 3U);
+  ASSERT_TRUE(context.callback_state.request_count == 1U);
+  ASSERT_TRUE(context.callback_state.notification_count == 0U);
+  ASSERT_TRUE(context.transport_state.message_count == 3U);
+
+  auto routed = test_parse_sent_json(&context.transport_state, 0U);
+  ASSERT_TRUE(routed != nullptr);
+  ASSERT_TRUE(json_object_get_number(json_value_get_object(routed), "result") ==
+              123.0);
+  json_value_free(routed);
+
+  auto fallback = test_parse_sent_json(&context.transport_state, 1U);
+  ASSERT_TRUE(fallback != nullptr);
+  ASSERT_TRUE(strcmp(json_object_get_string(json_value_get_object(fallback),
+                                            "result"),
+                     "pong") == 0);
+  json_value_free(fallback);
+
+  auto declined = test_parse_sent_json(&context.transport_state, 2U);
+  ASSERT_TRUE(declined != nullptr);
+  auto error_obj = json_object_get_object(json_value_get_object(declined), "error");
+  ASSERT_TRUE((int32_t)json_object_get_number(error_obj, "code") ==
+              JSONRPC_ERR_METHOD_NOT_FOUND);
+  json_value_free(declined);
+
+  jsonrpc_conn_free(conn);
+  jsonrpc_router_free(router);
+  test_transport_state_reset(&context.transport_state);
+  g_active_test_context = nullptr;
+  return true;
+}
+
+static bool g_request_bulk_owned = false;
+
+// Reports whether the parsed request was adopted by the arena, then answers
+// with a fresh array holding the value passed as user_data (handed over), or
+// with a copy of params.
+static bool test_bulk_handler(jsonrpc_conn_t *conn [[maybe_unused]],
+                              const JSON_Value *params,
+                              jsonrpc_response_t *response, void *user_data) {
+  const JSON_Value *root = params;
+  while (json_value_get_parent(root) != nullptr) {
+    root = json_value_get_parent(root);
+  }
+  g_request_bulk_owned = json_value_is_bulk_owned(root);
+  if (user_data != nullptr) {
+    response->result = json_value_init_array();
+    return response->result != nullptr &&
+           json_array_append_value(json_array(response->result),
+                                   (JSON_Value *)user_data) == JSONSuccess;
+  }
+  response->result = json_value_deep_copy(params);
+  return response->result != nullptr;
+}
+
+static bool test_arena_trees_release_in_bulk() {
+  auto value = json_parse_string("{\"a\":[1,2,{\"b\":\"c\"}]}");
+  ASSERT_TRUE(value != nullptr);
+  ASSERT_TRUE(!json_value_is_bulk_owned(value));
+  json_value_set_bulk_owned(value, true);
+  json_value_free(value); // no-op while marked
+  ASSERT_TRUE(json_value_get_type(value) == JSONObject);
+  json_value_set_bulk_owned(value, false);
+  json_value_free(value);
+
+  test_context_t context = {0};
+  g_active_test_context = &context;
+  // Created outside any message scope, so it lives on the heap and must still
+  // be freed node by node once attached under a result built in the arena.
+  auto handed_over = json_parse_string("[\"heap\",{\"x\":1}]");
+  ASSERT_TRUE(handed_over != nullptr);
+
+  auto router = jsonrpc_router_new();
+  ASSERT_TRUE(router != nullptr);
+  ASSERT_TRUE(jsonrpc_router_add(router, "build", test_bulk_handler,
+                                 JSONRPC_METHOD_DEFAULT, nullptr));
+  ASSERT_TRUE(jsonrpc_router_add(router, "hand_over", test_bulk_handler,
+                                 JSONRPC_METHOD_DEFAULT, handed_over));
+  jsonrpc_callbacks_t callbacks = {.on_request = on_request, .router = router};
+  auto conn = test_conn_new_with_callbacks(&context, callbacks);
+  ASSERT_TRUE(conn != nullptr);
+
+  const char *build =
+      "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"build\","
+      "\"params\":[1,[2,[3]],{\"k\":\"v\"}]}\n";
+  g_request_bulk_owned = false;
+  jsonrpc_conn_feed(conn, (const uint8_t *)build, strlen(build));
+  ASSERT_TRUE(g_request_bulk_owned);
+
+  const char *hand_over =
+      "{\"jsonrpc\":\"2.0\",\"id\":2,\"method\":\"hand_over\","
+      "\"params\":[]}\n";
+  jsonrpc_conn_feed(conn, (const uint8_t *)hand_over, strlen(hand_over));
+  ASSERT_TRUE(context.transport_state.message_count == 2U);
+
+  auto built = test_parse_sent_json(&context.transport_state, 0U);
+  ASSERT_TRUE(built != nullptr);
+  auto built_result =
+      json_object_get_array(json_value_get_object(built), "result");
+  ASSERT_TRUE(json_array_get_count(built_result) == 3U);
+  json_value_free(built);
+
+  auto handed = test_parse_sent_json(&context.transport_state, 1U);
+  ASSERT_TRUE(handed != nullptr);
+  auto handed_result = json_array_get_array(
+      json_object_get_array(json_value_get_object(handed), "result"), 0U);
+  ASSERT_TRUE(strcmp(json_array_get_string(handed_result, 0U), "heap") == 0);
+  json_value_free(handed);
+
+  jsonrpc_conn_free(conn);
+  jsonrpc_router_free(router);
+  test_transport_state_reset(&context.transport_state);
+  g_active_test_context = nullptr;
+  return true;
+}
+
+static jsonrpc_request_handle_t *g_deferred[4];
+static size_t g_deferred_count = 0U;
+
+static bool test_deferring_handler(jsonrpc_conn_t *conn,
+                                   const JSON_Value *params [[maybe_unused]],
+                                   jsonrpc_response_t *response,
+                                   void *user_data) {
+  auto handle = jsonrpc_conn_defer(conn, true);
+  if (handle == nullptr || g_deferred_count >= 4U) {
+    return false;
+  }
+  // Left-over results of a deferred request are discarded.
+  response->result = json_value_init_string("discarded");
+  if (user_data != nullptr) {
+    return jsonrpc_request_complete_result(handle,
+                                           json_value_init_string("now"));
+  }
+  g_deferred[g_deferred_count++] = handle;
+  return true;
+}
+
+static bool test_deferred_responses() {
+  test_context_t context = {0};
+  g_active_test_context = &context;
+  g_deferred_count = 0U;
+
+  auto router = jsonrpc_router_new();
+  ASSERT_TRUE(router != nullptr);
+  ASSERT_TRUE(jsonrpc_router_add(router, "later", test_deferring_handler,
+                                 JSONRPC_METHOD_DEFAULT, nullptr));
+  ASSERT_TRUE(jsonrpc_router_add(router, "now", test_deferring_handler,
+                                 JSONRPC_METHOD_DEFAULT, &context));
+  jsonrpc_callbacks_t callbacks = {.on_open = on_open,
+                                   .on_close = on_close,
+                                   .on_request = on_request,
+                                   .on_notification = on_notification,
+                                   .router = router};
+  auto conn = test_conn_new_with_callbacks(&context, callbacks);
+  ASSERT_TRUE(conn != nullptr);
+
+  const char *single =
+      "{\"jsonrpc\":\"2.0\",\"id\":\"s\",\"method\":\"later\",\"params\":[7]}\n"
+      "{\"jsonrpc\":\"2.0\",\"id\":2,\"method\":\"now\"}\n";
+  jsonrpc_conn_feed(conn, (const uint8_t *)single, strlen(single));
+  ASSERT_TRUE(g_deferred_count == 1U);
+  ASSERT_TRUE(context.transport_state.message_count == 1U);
+  ASSERT_TRUE(json_value_get_type(jsonrpc_request_handle_params(g_deferred[0])) ==
+              JSONArray);
+  ASSERT_TRUE(jsonrpc_request_handle_conn(g_deferred[0]) == conn);
+  ASSERT_TRUE(jsonrpc_request_complete_result(g_deferred[0],
+                                              json_value_init_number(8.0)));
+  ASSERT_TRUE(context.transport_state.message_count == 2U);
+
+  auto immediate = test_parse_sent_json(&context.transport_state, 0U);
+  ASSERT_TRUE(immediate != nullptr);
+  ASSERT_TRUE(strcmp(json_object_get_string(json_value_get_object(immediate),
+                                            "result"),
+                     "now") == 0);
+  json_value_free(immediate);
+  auto later = test_parse_sent_json(&context.transport_state, 1U);
+  ASSERT_TRUE(later != nullptr);
+  ASSERT_TRUE(strcmp(json_object_get_string(json_value_get_object(later), "id"),
+                     "s") == 0);
+  ASSERT_TRUE(json_object_get_number(json_value_get_object(later), "result") ==
+              8.0);
+  json_value_free(later);
+
+  // The batch waits for both deferred members; synchronous ones are kept.
+  g_deferred_count = 0U;
+  const char *batch =
+      "[{\"jsonrpc\":\"2.0\",\"id\":10,\"method\":\"later\"},"
+      "{\"jsonrpc\":\"2.0\",\"id\":11,\"method\":\"ping\"},"
+      "{\"jsonrpc\":\"2.0\",\"method\":\"later\"},"
+      "{\"jsonrpc\":\"2.0\",\"id\":12,\"method\":\"later\"}]\n";
+  jsonrpc_conn_feed(conn, (const uint8_t *)batch, strlen(batch));
+  ASSERT_TRUE(g_deferred_count == 2U);
+  ASSERT_TRUE(context.transport_state.message_count == 2U);
+  ASSERT_TRUE(jsonrpc_request_complete_error(g_deferred[1], JSONRPC_ERR_INTERNAL,
+                                             nullptr));
+  ASSERT_TRUE(context.transport_state.message_count == 2U);
+  ASSERT_TRUE(jsonrpc_request_complete_result(g_deferred[0],
+                                              json_value_init_boolean(true)));
+  ASSERT_TRUE(context.transport_state.message_count == 3U);
+  auto batch_response = test_parse_sent_json(&context.transport_state, 2U);
+  ASSERT_TRUE(batch_response != nullptr);
+  ASSERT_TRUE(json_array_get_count(json_value_get_array(batch_response)) == 3U);
+  json_value_free(batch_response);
+
+  // Handles outlive their connection.
+  g_deferred_count = 0U;
+  const char *orphan =
+      "[{\"jsonrpc\":\"2.0\",\"id\":20,\"method\":\"later\"},"
+      "{\"jsonrpc\":\"2.0\",\"id\":21,\"method\":\"later\"}]\n"
+      "{\"jsonrpc\":\"2.0\",\"id\":22,\"method\":\"later\"}\n";
+  jsonrpc_conn_feed(conn, (const uint8_t *)orphan, strlen(orphan));
+  ASSERT_TRUE(g_deferred_count == 3U);
+  ASSERT_TRUE(jsonrpc_request_complete_result(g_deferred[0],
+                                              json_value_init_null()));
+  jsonrpc_conn_free(conn);
+  ASSERT_TRUE(jsonrpc_request_handle_conn(g_deferred[1]) == nullptr);
+  ASSERT_TRUE(!jsonrpc_request_complete_result(g_deferred[1],
+                                               json_value_init_null()));
+  ASSERT_TRUE(!jsonrpc_request_complete_error(g_deferred[2], JSONRPC_ERR_INTERNAL,
+                                              nullptr));
+  ASSERT_TRUE(context.transport_state.message_count == 3U);
+
+  jsonrpc_router_free(router);
+  test_transport_state_reset(&context.transport_state);
+  g_active_test_context = nullptr;
+  return true;
+}
+
+static bool test_http_framing() {
+  test_context_t context = {0};
+  g_active_test_context = &context;
+  g_deferred_count = 0U;
+
+  auto router = jsonrpc_router_new();
+  ASSERT_TRUE(router != nullptr);
+  ASSERT_TRUE(jsonrpc_router_add(router, "later", test_deferring_handler,
+                                 JSONRPC_METHOD_DEFAULT, nullptr));
+  jsonrpc_callbacks_t callbacks = {.on_open = on_open,
+                                   .on_close = on_close,
+                                   .on_request = on_request,
+                                   .on_notification = on_notification,
+                                   .router = router};
+  auto conn = test_conn_new_with_callbacks(&context, callbacks);
+  ASSERT_TRUE(conn != nullptr);
+  ASSERT_TRUE(jsonrpc_conn_set_framing(conn, JSONRPC_FRAMING_HTTP, 0U));
+  const test_transport_state_t *sent = &context.transport_state;
+
+  // Requests pipelined behind a deferred one are answered after it, in
+  // order; the notification gets an empty 204.
+  const char *pipelined =
+      "POST /rpc HTTP/1.1\r\nHost: test\r\nContent-Length: 41\r\n\r\n"
+      "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"later\"}"
+      "POST /rpc HTTP/1.1\r\ncontent-length: 40\r\n\r\n"
+      "{\"jsonrpc\":\"2.0\",\"id\":2,\"method\":\"ping\"}"
+      "POST /rpc HTTP/1.1\r\nContent-Length: 33\r\n\r\n"
+      "{\"jsonrpc\":\"2.0\",\"method\":\"ping\"}";
+  jsonrpc_conn_feed(conn, (const uint8_t *)pipelined, strlen(pipelined));
+  ASSERT_TRUE(g_deferred_count == 1U);
+  ASSERT_TRUE(sent->message_count == 0U);
+  ASSERT_TRUE(jsonrpc_request_complete_result(g_deferred[0],
+                                              json_value_init_number(1.0)));
+  ASSERT_TRUE(sent->message_count == 3U);
+  for (size_t i = 0U; i < 2U; ++i) {
+    const char *message = sent->messages[i];
+    const char *body = strstr(message, "\r\n\r\n");
+    ASSERT_TRUE(body != nullptr);
+    body += 4U;
+    char expected[JSONRPC_FRAME_HEADER_MAX + 1U] = {0};
+    ASSERT_TRUE(jsonrpc_frame_header(JSONRPC_FRAMING_HTTP, strlen(body),
+                                     (uint8_t *)expected) ==
+                (size_t)(body - message));
+    ASSERT_TRUE(strncmp(message, expected, (size_t)(body - message)) == 0);
+    auto response = json_parse_string(body);
+    ASSERT_TRUE(response != nullptr);
+    ASSERT_TRUE(json_object_get_number(json_value_get_object(response),
+                                       "id") == 1.0 + (double)i);
+    json_value_free(response);
+  }
+  ASSERT_TRUE(strcmp(sent->messages[2], "HTTP/1.1 204 No Content\r\n\r\n") ==
+              0);
+  ASSERT_TRUE(sent->pause_calls == 1U && !sent->reads_paused);
+
+  // An expecting client is told to continue once the headers are in.
+  const char *expecting =
+      "POST / HTTP/1.1\r\nExpect: 100-continue\r\nContent-Length: 40\r\n\r\n"
+      "{\"jsonrpc\":\"2.0\",\"id\":3,";
+  jsonrpc_conn_feed(conn, (const uint8_t *)expecting, strlen(expecting));
+  ASSERT_TRUE(sent->message_count == 4U);
+  ASSERT_TRUE(strcmp(sent->messages[3], "HTTP/1.1 100 Continue\r\n\r\n") == 0);
+  const char *rest = "\"method\":\"ping\"}";
+  jsonrpc_conn_feed(conn, (const uint8_t *)rest, strlen(rest));
+  ASSERT_TRUE(sent->message_count == 5U);
+  ASSERT_TRUE(strstr(sent->messages[4], "\"id\":3") != nullptr);
+
+  // HTTP/1.0 and Connection: close end the connection after the response.
+  const char *closing =
+      "POST / HTTP/1.1\r\nConnection: close\r\nContent-Length: 40\r\n\r\n"
+      "{\"jsonrpc\":\"2.0\",\"id\":4,\"method\":\"ping\"}";
+  jsonrpc_conn_feed(conn, (const uint8_t *)closing, strlen(closing));
+  ASSERT_TRUE(sent->message_count == 6U);
+  ASSERT_TRUE(strstr(sent->messages[5], "Connection: close\r\n") != nullptr);
+  ASSERT_TRUE(context.transport_state.close_calls == 1U);
+  jsonrpc_conn_free(conn);
+  test_transport_state_reset(&context.transport_state);
+
+  // Other methods are refused with a JSON-RPC error and the connection is
+  // closed.
+  conn = test_conn_new_with_callbacks(&context, callbacks);
+  ASSERT_TRUE(conn != nullptr);
+  ASSERT_TRUE(jsonrpc_conn_set_framing(conn, JSONRPC_FRAMING_HTTP, 0U));
+  const char *get = "GET / HTTP/1.1\r\nHost: test\r\n\r\n";
+  jsonrpc_conn_feed(conn, (const uint8_t *)get, strlen(get));
+  ASSERT_TRUE(sent->message_count == 1U);
+  ASSERT_TRUE(strncmp(sent->messages[0], "HTTP/1.1 405 Method Not Allowed\r\n",
+                      33U) == 0);
+  ASSERT_TRUE(strstr(sent->messages[0], "Allow: POST\r\n") != nullptr);
+  ASSERT_TRUE(strstr(sent->messages[0], "-32600") != nullptr);
+  ASSERT_TRUE(context.transport_state.close_calls == 1U);
+
+  jsonrpc_conn_free(conn);
+  test_transport_state_reset(&context.transport_state);
+
+  // More requests than the per-request limit allows at once are held behind a
+  // deferred one, with reads paused, and then answered in order: the limit
+  // applies to each request, not to the queue.
+  constexpr size_t max_message = 1'024U;
+  constexpr size_t held_count = 30U;
+  constexpr size_t body_len = 300U;
+  char held[(held_count + 1U) * 384U];
+  size_t held_len = 0U;
+  for (size_t i = 0U; i <= held_count; ++i) {
+    const int written = snprintf(
+        held + held_len, sizeof(held) - held_len,
+        "POST / HTTP/1.1\r\nContent-Length: %zu\r\n\r\n"
+        "{\"jsonrpc\":\"2.0\",\"id\":%zu,\"method\":\"%s\"%*s}",
+        body_len, i + 10U, i == 0U ? "later" : "ping",
+        (int)(body_len - (i == 0U ? 42U : 41U)), "");
+    ASSERT_TRUE(written > 0 && (size_t)written < sizeof(held) - held_len);
+    held_len += (size_t)written;
+  }
+  // More than a request with the largest headers allowed (8 KiB) could span.
+  ASSERT_TRUE(held_len > 8'192U + max_message);
+  g_deferred_count = 0U;
+  conn = test_conn_new_with_callbacks(&context, callbacks);
+  ASSERT_TRUE(conn != nullptr);
+  ASSERT_TRUE(
+      jsonrpc_conn_set_framing(conn, JSONRPC_FRAMING_HTTP, max_message));
+  constexpr size_t chunk_len = 1'000U;
+  for (size_t offset = 0U; offset < held_len; offset += chunk_len) {
+    const size_t remaining = held_len - offset;
+    jsonrpc_conn_feed(conn, (const uint8_t *)held + offset,
+                      remaining < chunk_len ? remaining : chunk_len);
+  }
+  ASSERT_TRUE(g_deferred_count == 1U);
+  ASSERT_TRUE(sent->message_count == 0U && sent->close_calls == 0U);
+  ASSERT_TRUE(sent->reads_paused && sent->pause_calls == 1U);
+  ASSERT_TRUE(jsonrpc_request_complete_result(g_deferred[0],
+                                              json_value_init_number(1.0)));
+  ASSERT_TRUE(!sent->reads_paused && sent->close_calls == 0U);
+  ASSERT_TRUE(sent->message_count == held_count + 1U);
+  for (size_t i = 0U; i <= held_count; ++i) {
+    const char *body = strstr(sent->messages[i], "\r\n\r\n");
+    ASSERT_TRUE(strncmp(sent->messages[i], "HTTP/1.1 200 OK\r\n", 17U) == 0);
+    ASSERT_TRUE(body != nullptr);
+    auto response = json_parse_string(body + 4U);
+    ASSERT_TRUE(response != nullptr);
+    ASSERT_TRUE(json_object_get_number(json_value_get_object(response),
+                                       "id") == (double)(i + 10U));
+    json_value_free(response);
+  }
+
+  jsonrpc_conn_free(conn);
+  jsonrpc_router_free(router);
+  test_transport_state_reset(&context.transport_state);
+  g_active_test_context = nullptr;
+  return true;
+}
+
+// Completes another connection's deferred request with a tree built in this
+// connection's arena, so it is freed while the other arena is active.
+static bool test_relay_handler(jsonrpc_conn_t *conn [[maybe_unused]],
+                               const JSON_Value *params [[maybe_unused]],
+                               jsonrpc_response_t *response,
+                               void *user_data [[maybe_unused]]) {
+  if (g_deferred_count != 1U) {
+    return false;
+  }
+  auto relayed = json_parse_string("[1,{\"deep\":[2,3,\"four\"]}]");
+  if (!jsonrpc_request_complete_result(g_deferred[0], relayed)) {
+    return false;
+  }
+  g_deferred_count = 0U;
+  response->result = json_value_init_boolean(true);
+  return response->result != nullptr;
+}
+
+static JSON_Value *g_kept_value = nullptr;
+
+// Keeps a copy of params, built in the message arena, past the message.
+static bool test_keep_handler(jsonrpc_conn_t *conn [[maybe_unused]],
+                              const JSON_Value *params,
+                              jsonrpc_response_t *response,
+                              void *user_data [[maybe_unused]]) {
+  g_kept_value = json_value_deep_copy(params);
+  response->result = json_value_init_null();
+  return g_kept_value != nullptr && response->result != nullptr;
+}
+
+static bool test_arena_frees_across_nested_scopes() {
+  test_context_t waiting_context = {0};
+  test_context_t relay_context = {0};
+  g_active_test_context = &relay_context;
+  g_deferred_count = 0U;
+
+  auto router = jsonrpc_router_new();
+  ASSERT_TRUE(router != nullptr);
+  ASSERT_TRUE(jsonrpc_router_add(router, "later", test_deferring_handler,
+                                 JSONRPC_METHOD_DEFAULT, nullptr));
+  ASSERT_TRUE(jsonrpc_router_add(router, "relay", test_relay_handler,
+                                 JSONRPC_METHOD_DEFAULT, nullptr));
+  ASSERT_TRUE(jsonrpc_router_add(router, "keep", test_keep_handler,
+                                 JSONRPC_METHOD_DEFAULT, nullptr));
+  jsonrpc_callbacks_t callbacks = {.on_request = on_request, .router = router};
+  auto waiting = test_conn_new_with_callbacks(&waiting_context, callbacks);
+  auto relay = test_conn_new_with_callbacks(&relay_context, callbacks);
+  ASSERT_TRUE(waiting != nullptr && relay != nullptr);
+
+  const char *later = "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"later\"}\n";
+  jsonrpc_conn_feed(waiting, (const uint8_t *)later, strlen(later));
+  ASSERT_TRUE(g_deferred_count == 1U);
+
+  const char *relay_request =
+      "{\"jsonrpc\":\"2.0\",\"id\":2,\"method\":\"relay\"}\n";
+  jsonrpc_conn_feed(relay, (const uint8_t *)relay_request,
+                    strlen(relay_request));
+  ASSERT_TRUE(g_deferred_count == 0U);
+  ASSERT_TRUE(relay_context.transport_state.message_count == 1U);
+  ASSERT_TRUE(waiting_context.transport_state.message_count == 1U);
+
+  auto relayed = test_parse_sent_json(&waiting_context.transport_state, 0U);
+  ASSERT_TRUE(relayed != nullptr);
+  auto result = json_object_get_array(json_value_get_object(relayed), "result");
+  ASSERT_TRUE(strcmp(json_array_get_string(
+                         json_object_get_array(json_array_get_object(result, 1U),
+                                               "deep"),
+                         2U),
+                     "four") == 0);
+  json_value_free(relayed);
+
+  // Arena memory freed after its scope has ended is left to the arena, never
+  // handed to free().
+  const char *keep =
+      "{\"jsonrpc\":\"2.0\",\"id\":3,\"method\":\"keep\","
+      "\"params\":{\"a\":[1,\"b\"]}}\n";
+  g_kept_value = nullptr;
+  jsonrpc_conn_feed(relay, (const uint8_t *)keep, strlen(keep));
+  ASSERT_TRUE(relay_context.transport_state.message_count == 2U);
+  ASSERT_TRUE(g_kept_value != nullptr);
+  json_value_free(g_kept_value);
+  g_kept_value = nullptr;
+
+  jsonrpc_conn_free(waiting);
+  jsonrpc_conn_free(relay);
+  jsonrpc_router_free(router);
+  test_transport_state_reset(&waiting_context.transport_state);
+  test_transport_state_reset(&relay_context.transport_state);
+  g_active_test_context = nullptr;
+  return true;
+}
+
+typedef struct {
+  const jsonrpc_method_t *method;
+  jsonrpc_request_handle_t *handle;
+  jsonrpc_response_t response;
+  bool handled;
+} test_offload_job_t;
+
+static test_offload_job_t g_offload_jobs[4];
+static size_t g_offload_count = 0U;
+static bool g_offload_accepts = true;
+
+static bool test_offload(jsonrpc_conn_t *conn [[maybe_unused]],
+                         const jsonrpc_method_t *method,
+                         jsonrpc_request_handle_t *handle) {
+  if (!g_offload_accepts || g_offload_count >= 4U) {
+    return false;
+  }
+  g_offload_jobs[g_offload_count++] = (test_offload_job_t){
+      .method = method, .handle = handle, .response = {0}, .handled = false};
+  return true;
+}
+
+static int test_offload_worker(void *arg) {
+  auto job = (test_offload_job_t *)arg;
+  job->handled = job->method->handler(
+      nullptr, jsonrpc_request_handle_params(job->handle), &job->response,
+      job->method->user_data);
+  return 0;
+}
+
+static bool test_sum_handler(jsonrpc_conn_t *conn [[maybe_unused]],
+                             const JSON_Value *params,
+                             jsonrpc_response_t *response,
+                             void *user_data [[maybe_unused]]) {
+  auto array = json_value_get_array(params);
+  if (array == nullptr) {
+    response->error_code = JSONRPC_ERR_INVALID_PARAMS;
+    return true;
+  }
+  double sum = 0.0;
+  for (size_t i = 0U; i < json_array_get_count(array); ++i) {
+    sum += json_array_get_number(array, i);
+  }
+  response->result = json_value_init_number(sum);
+  return true;
+}
+
+static bool test_blocking_methods_are_offloaded() {
+  test_context_t context = {0};
+  g_active_test_context = &context;
+  g_offload_count = 0U;
+  g_offload_accepts = true;
+
+  auto router = jsonrpc_router_new();
+  ASSERT_TRUE(router != nullptr);
+  ASSERT_TRUE(jsonrpc_router_add(router, "sum", test_sum_handler,
+                                 JSONRPC_METHOD_BLOCKING, nullptr));
+  jsonrpc_callbacks_t callbacks = {.on_open = on_open,
+                                   .on_close = on_close,
+                                   .on_request = on_request,
+                                   .on_notification = on_notification,
+                                   .router = router,
+                                   .offload = test_offload};
+  auto conn = test_conn_new_with_callbacks(&context, callbacks);
+  ASSERT_TRUE(conn != nullptr);
+
+  const char *input =
+      "[{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"sum\",\"params\":[1,2]},"
+      "{\"jsonrpc\":\"2.0\",\"id\":2,\"method\":\"sum\",\"params\":{}}]\n";
+  jsonrpc_conn_feed(conn, (const uint8_t *)input, strlen(input));
+  ASSERT_TRUE(g_offload_count == 2U);
+  ASSERT_TRUE(context.transport_state.message_count == 0U);
+
+  // Handlers run on other threads against the kept params; completion
+  // happens back on this (loop) thread.
+  thrd_t threads[2];
+  for (size_t i = 0U; i < 2U; ++i) {
+    ASSERT_TRUE(thrd_create(&threads[i], test_offload_worker,
+                            &g_offload_jobs[i]) == thrd_success);
+  }
+  for (size_t i = 0U; i < 2U; ++i) {
+    ASSERT_TRUE(thrd_join(threads[i], nullptr) == thrd_success);
+    ASSERT_TRUE(jsonrpc_request_complete_response(g_offload_jobs[i].handle,
+                                                  g_offload_jobs[i].handled,
+                                                  &g_offload_jobs[i].response));
+  }
+  ASSERT_TRUE(context.transport_state.message_count == 1U);
+  auto batch = test_parse_sent_json(&context.transport_state, 0U);
+  ASSERT_TRUE(batch != nullptr);
+  auto responses = json_value_get_array(batch);
+  ASSERT_TRUE(json_array_get_count(responses) == 2U);
+  for (size_t i = 0U; i < 2U; ++i) {
+    auto item = json_array_get_object(responses, i);
+    if (json_object_get_number(item, "id") == 1.0) {
+      ASSERT_TRUE(json_object_get_number(item, "result") == 3.0);
+    } else {
+      ASSERT_TRUE(json_object_get_number(json_object_get_object(item, "error"),
+                                         "code") == JSONRPC_ERR_INVALID_PARAMS);
+    }
+  }
+  json_value_free(batch);
+
+  // A refused offload runs the handler inline.
+  g_offload_accepts = false;
+  const char *refused =
+      "{\"jsonrpc\":\"2.0\",\"id\":3,\"method\":\"sum\",\"params\":[4]}\n";
+  jsonrpc_conn_feed(conn, (const uint8_t *)refused, strlen(refused));
+  ASSERT_TRUE(context.transport_state.message_count == 2U);
+  auto inline_response = test_parse_sent_json(&context.transport_state, 1U);
+  ASSERT_TRUE(inline_response != nullptr);
+  ASSERT_TRUE(json_object_get_number(json_value_get_object(inline_response),
+                                     "result") == 4.0);
+  json_value_free(inline_response);
+
+  jsonrpc_conn_free(conn);
+  jsonrpc_router_free(router);
+  test_transport_state_reset(&context.transport_state);
+  g_active_test_context = nullptr;
+  return true;
+}
+
+static int test_feed_worker(void *arg) {
+  auto conn = (jsonrpc_conn_t *)arg;
+  char request[96];
+  for (size_t i = 0U; i < 20U; ++i) {
+    const int written = snprintf(
+        request, sizeof(request),
+        "{\"jsonrpc\":\"2.0\",\"id\":%zu,\"method\":\"sum\",\"params\":[%zu,1]}\n",
+        i, i);
+    jsonrpc_conn_feed(conn, (const uint8_t *)request, (size_t)written);
+  }
+  return 0;
+}
+
+static bool test_connections_parse_on_separate_threads() {
+  auto router = jsonrpc_router_new();
+  ASSERT_TRUE(router != nullptr);
+  ASSERT_TRUE(jsonrpc_router_add(router, "sum", test_sum_handler,
+                                 JSONRPC_METHOD_DEFAULT, nullptr));
+  jsonrpc_callbacks_t callbacks = {.router = router};
+
+  // Each thread parses into its own connection arena.
+  test_context_t contexts[2] = {0};
+  jsonrpc_conn_t *conns[2];
+  thrd_t threads[2];
+  for (size_t t = 0U; t < 2U; ++t) {
+    conns[t] = test_conn_new_with_callbacks(&contexts[t], callbacks);
+    ASSERT_TRUE(conns[t] != nullptr);
+  }
+  for (size_t t = 0U; t < 2U; ++t) {
+    ASSERT_TRUE(thrd_create(&threads[t], test_feed_worker, conns[t]) ==
+                thrd_success);
+  }
+  for (size_t t = 0U; t < 2U; ++t) {
+    ASSERT_TRUE(thrd_join(threads[t], nullptr) == thrd_success);
+  }
+
+  for (size_t t = 0U; t < 2U; ++t) {
+    ASSERT_TRUE(contexts[t].transport_state.message_count == 20U);
+    for (size_t i = 0U; i < 20U; ++i) {
+      auto response = test_parse_sent_json(&contexts[t].transport_state, i);
+      ASSERT_TRUE(response != nullptr);
+      ASSERT_TRUE(json_object_get_number(json_value_get_object(response),
+                                         "result") == (double)i + 1.0);
+      json_value_free(response);
+    }
+    jsonrpc_conn_free(conns[t]);
+    test_transport_state_reset(&contexts[t].transport_state);
+  }
+  jsonrpc_router_free(router);
+  return true;
+}
+
 int main() {
   typedef struct {
     const char *name;
@@ -817,6 +2633,13 @@ int main() {
       {.name = "batch_edge_cases", .run = test_batch_edge_cases},
       {.name = "framing_and_embedded_nul_parse_error",
        .run = test_framing_and_embedded_nul_parse_error},
+      {.name = "framing_scan_resumes_across_feeds",
+       .run = test_framing_scan_resumes_across_feeds},
+      {.name = "pipelined_messages_split_across_feeds",
+       .run = test_pipelined_messages_split_across_feeds},
+      {.name = "length_prefix_framing", .run = test_length_prefix_framing},
+      {.name = "content_length_framing", .run = test_content_length_framing},
+      {.name = "websocket_framing", .run = test_websocket_framing},
       {.name = "request_too_large_closes_connection",
        .run = test_request_too_large_closes_connection},
       {.name = "inbound_buffer_overflow_closes_connection",
@@ -828,6 +2651,40 @@ int main() {
       {.name = "connection_closed_during_on_open_returns_null",
        .run = test_connection_closed_during_on_open_returns_null},
       {.name = "arena_api_paths", .run = test_arena_api_paths},
+      {.name = "chained_arena_grows_and_settles",
+       .run = test_chained_arena_grows_and_settles},
+      {.name = "pool_watermarks_and_trim",
+       .run = test_pool_watermarks_and_trim},
+      {.name = "feed_through_reused_slab",
+       .run = test_feed_through_reused_slab},
+      {.name = "conn_memory_accounting", .run = test_conn_memory_accounting},
+      {.name = "timer_wheel_expiry_and_rounds",
+       .run = test_timer_wheel_expiry_and_rounds},
+      {.name = "write_queue_watermarks", .run = test_write_queue_watermarks},
+      {.name = "admission_budget_and_shedding",
+       .run = test_admission_budget_and_shedding},
+      {.name = "message_clock_restarts_on_progress",
+       .run = test_message_clock_restarts_on_progress},
+      {.name = "arena_trees_release_in_bulk",
+       .run = test_arena_trees_release_in_bulk},
+      {.name = "serialize_to_sink_matches_string",
+       .run = test_serialize_to_sink_matches_string},
+      {.name = "msgpack_round_trip", .run = test_msgpack_round_trip},
+      {.name = "msgpack_encoding_negotiation",
+       .run = test_msgpack_encoding_negotiation},
+      {.name = "transport_reserve_commit_path",
+       .run = test_transport_reserve_commit_path},
+      {.name = "parse_string_with_len_bounds",
+       .run = test_parse_string_with_len_bounds},
+      {.name = "router_dispatch", .run = test_router_dispatch},
+      {.name = "deferred_responses", .run = test_deferred_responses},
+      {.name = "http_framing", .run = test_http_framing},
+      {.name = "arena_frees_across_nested_scopes",
+       .run = test_arena_frees_across_nested_scopes},
+      {.name = "blocking_methods_are_offloaded",
+       .run = test_blocking_methods_are_offloaded},
+      {.name = "connections_parse_on_separate_threads",
+       .run = test_connections_parse_on_separate_threads},
   };
 
   size_t failures = 0U;
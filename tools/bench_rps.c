@@ -14,7 +14,9 @@
 
 #include <uv.h>
 
+#include "jsonrpc/msgpack.h"
 #include "jsonrpc/parson.h"
+#include "jsonrpc/websocket.h"
 
 constexpr int32_t DEFAULT_PORT = 8080;
 constexpr int32_t DEFAULT_CONNECTIONS = 50;
@@ -25,14 +27,26 @@ constexpr size_t MAX_LINE_BYTES = 131'072U;
 constexpr double MS_PER_SEC = 1'000.0;
 constexpr double NS_PER_SEC = 1'000'000'000.0;
 
+// Message framing, as the server's --framing option.
+typedef enum {
+  BENCH_FRAMING_NEWLINE,
+  BENCH_FRAMING_LENGTH,         // 4-byte big-endian length prefix
+  BENCH_FRAMING_CONTENT_LENGTH, // "Content-Length: N\r\n\r\n" header
+  BENCH_FRAMING_HTTP,           // keep-alive HTTP/1.1 POST
+  BENCH_FRAMING_WEBSOCKET,      // masked frames after an upgrade handshake
+} bench_framing_t;
+
 typedef struct {
   const char *host;
   int32_t port;
+  const char *unix_path; // connect here instead of host:port when set
   int32_t connections;
   double duration_sec;
   double timeout_sec;
   const char *method;
   const char *params_json;
+  bench_framing_t framing;
+  bool msgpack; // encode requests as MessagePack (length-delimited framing)
 } bench_options_t;
 
 typedef struct {
@@ -53,7 +67,12 @@ typedef struct {
 struct bench_conn_t {
   int32_t index;
   bench_ctx_t *ctx;
-  uv_tcp_t tcp;
+  union {
+    uv_handle_t handle;
+    uv_stream_t stream;
+    uv_tcp_t tcp;
+    uv_pipe_t pipe;
+  } io;
   uv_connect_t connect_req;
   uv_timer_t timeout_timer;
   bool active;
@@ -62,6 +81,7 @@ struct bench_conn_t {
   bool write_inflight;
   bool closing;
   bool timed_out;
+  bool upgraded; // WebSocket handshake answered
   char *read_chunk;
   size_t read_chunk_cap;
   uint8_t *recv_buf;
@@ -69,6 +89,8 @@ struct bench_conn_t {
   size_t recv_cap;
   uint64_t request_id;
   uint64_t responses;
+  uint64_t sent_ns;    // when the request awaiting a response was written
+  uint64_t latency_ns; // summed over responses
 };
 
 struct bench_ctx_t {
@@ -93,12 +115,19 @@ static void print_usage(FILE *out, const char *program) {
           "Options:\n"
           "  --host <host>         Server host (default: 127.0.0.1)\n"
           "  --port <port>         Server port (default: 8080)\n"
-          "  --connections <n>     Parallel TCP connections (default: 50)\n"
+          "  --unix <path>         Connect to a Unix socket instead of TCP\n"
+          "  --connections <n>     Parallel connections (default: 50)\n"
           "  --duration <sec>      Benchmark duration in seconds (default: 5)\n"
           "  --timeout <sec>       Per-request read timeout in seconds "
           "(default: 5)\n"
           "  --method <name>       JSON-RPC method (default: ping)\n"
           "  --params <json>       Optional JSON params (array or object)\n"
+          "  --framing <mode>      newline, length, content-length, http or "
+          "websocket\n"
+          "                        (default: newline)\n"
+          "  --msgpack             Send MessagePack requests (server "
+          "--msgpack;\n"
+          "                        needs a framing other than newline)\n"
           "  --help                Show this help\n",
           program);
 }
@@ -106,11 +135,14 @@ static void print_usage(FILE *out, const char *program) {
 static void bench_options_init(bench_options_t *options) {
   options->host = "127.0.0.1";
   options->port = DEFAULT_PORT;
+  options->unix_path = nullptr;
   options->connections = DEFAULT_CONNECTIONS;
   options->duration_sec = DEFAULT_DURATION_SEC;
   options->timeout_sec = DEFAULT_TIMEOUT_SEC;
   options->method = "ping";
   options->params_json = nullptr;
+  options->framing = BENCH_FRAMING_NEWLINE;
+  options->msgpack = false;
 }
 
 [[nodiscard]] static bool parse_int32(const char *text, int32_t *out) {
@@ -171,6 +203,14 @@ static void bench_options_init(bench_options_t *options) {
       }
       continue;
     }
+    if (strcmp(arg, "--unix") == 0) {
+      if (i + 1 >= argc) {
+        fprintf(stderr, "--unix requires a value\n");
+        return 2;
+      }
+      options->unix_path = argv[++i];
+      continue;
+    }
     if (strcmp(arg, "--connections") == 0) {
       if (i + 1 >= argc) {
         fprintf(stderr, "--connections requires a value\n");
@@ -220,11 +260,39 @@ static void bench_options_init(bench_options_t *options) {
       options->params_json = argv[++i];
       continue;
     }
+    if (strcmp(arg, "--framing") == 0) {
+      const char *mode = i + 1 < argc ? argv[++i] : "";
+      if (strcmp(mode, "newline") == 0) {
+        options->framing = BENCH_FRAMING_NEWLINE;
+      } else if (strcmp(mode, "length") == 0) {
+        options->framing = BENCH_FRAMING_LENGTH;
+      } else if (strcmp(mode, "content-length") == 0) {
+        options->framing = BENCH_FRAMING_CONTENT_LENGTH;
+      } else if (strcmp(mode, "http") == 0) {
+        options->framing = BENCH_FRAMING_HTTP;
+      } else if (strcmp(mode, "websocket") == 0) {
+        options->framing = BENCH_FRAMING_WEBSOCKET;
+      } else {
+        fprintf(stderr, "--framing must be newline, length, content-length, "
+                        "http or websocket\n");
+        return 2;
+      }
+      continue;
+    }
+    if (strcmp(arg, "--msgpack") == 0) {
+      options->msgpack = true;
+      continue;
+    }
 
     fprintf(stderr, "Unknown argument: %s\n", arg);
     return 2;
   }
 
+  if (options->msgpack && options->framing == BENCH_FRAMING_NEWLINE) {
+    fprintf(stderr, "--msgpack needs --framing length, content-length, http "
+                    "or websocket\n");
+    return 2;
+  }
   return 0;
 }
 
@@ -284,9 +352,33 @@ static void bench_options_init(bench_options_t *options) {
   return (uint64_t)ms;
 }
 
+// Output sink for jsonrpc_msgpack_encode over a heap buffer.
+[[nodiscard]] static bool bench_sink_grow(JSON_Output_Sink *sink,
+                                          size_t min_free) {
+  size_t cap = sink->cap == 0U ? 256U : sink->cap;
+  while (cap - sink->len < min_free) {
+    if (cap > SIZE_MAX / 2U) {
+      return false;
+    }
+    cap *= 2U;
+  }
+  char *data = (char *)calloc(cap, 1U);
+  if (data == nullptr) {
+    return false;
+  }
+  if (sink->len != 0U) {
+    memcpy(data, sink->data, sink->len);
+  }
+  free(sink->data);
+  sink->data = data;
+  sink->cap = cap;
+  return true;
+}
+
 [[nodiscard]] static bool build_request(owned_buffer_t *out, const char *method,
                                         const JSON_Value *params_value,
-                                        uint64_t request_id) {
+                                        uint64_t request_id,
+                                        bench_framing_t framing, bool msgpack) {
   if (out == nullptr || method == nullptr) {
     return false;
   }
@@ -322,34 +414,96 @@ static void bench_options_init(bench_options_t *options) {
     }
   }
 
-  const size_t json_size = json_serialization_size(root);
+  // A MessagePack body is encoded up front and copied in behind the header.
+  JSON_Output_Sink packed = {.data = nullptr,
+                             .len = 0U,
+                             .cap = 0U,
+                             .grow = bench_sink_grow,
+                             .user_data = nullptr};
+  if (msgpack && !jsonrpc_msgpack_encode(root, &packed)) {
+    free(packed.data);
+    json_value_free(root);
+    return false;
+  }
+  const size_t json_size =
+      msgpack ? packed.len + 1U : json_serialization_size(root);
   if (json_size == 0U) {
     json_value_free(root);
     return false;
   }
   if (json_size > SIZE_MAX - 2U) {
+    free(packed.data);
     json_value_free(root);
     return false;
   }
 
-  const size_t alloc_size = json_size + 1U;
+  // json_size counts the terminating NUL, which becomes the newline.
+  const size_t body_len = json_size - 1U;
+  char header[128] = {0};
+  int header_len = 0;
+  if (framing == BENCH_FRAMING_LENGTH) {
+    if (body_len > UINT32_MAX) {
+      free(packed.data);
+      json_value_free(root);
+      return false;
+    }
+    header[0] = (char)(body_len >> 24U);
+    header[1] = (char)(body_len >> 16U);
+    header[2] = (char)(body_len >> 8U);
+    header[3] = (char)body_len;
+    header_len = 4;
+  } else if (framing == BENCH_FRAMING_CONTENT_LENGTH) {
+    header_len = snprintf(header, sizeof(header), "Content-Length: %zu\r\n\r\n",
+                          body_len);
+  } else if (framing == BENCH_FRAMING_HTTP) {
+    header_len = snprintf(header, sizeof(header),
+                          "POST / HTTP/1.1\r\nHost: bench\r\n"
+                          "Content-Type: application/%s\r\n"
+                          "Content-Length: %zu\r\n\r\n",
+                          msgpack ? "msgpack" : "json", body_len);
+  } else if (framing == BENCH_FRAMING_WEBSOCKET) {
+    // Client frames are masked; the key only has to vary between frames.
+    const auto key = (uint32_t)(request_id * 0x9E37'79B9U);
+    header_len = (int)jsonrpc_ws_frame_header(
+        msgpack ? JSONRPC_WS_BINARY : JSONRPC_WS_TEXT, body_len,
+        (uint8_t *)header);
+    header[1] = (char)((uint8_t)header[1] | 0x80U);
+    memcpy(header + header_len, &key, sizeof(key));
+    header_len += (int)sizeof(key);
+  }
+
+  const size_t alloc_size = (size_t)header_len + json_size + 1U;
   // Ownership: caller frees out->data.
   char *buffer = (char *)calloc(alloc_size, 1U);
   if (buffer == nullptr) {
+    free(packed.data);
     json_value_free(root);
     return false;
   }
 
-  if (json_serialize_to_buffer(root, buffer, json_size) != JSONSuccess) {
+  memcpy(buffer, header, (size_t)header_len);
+  if (msgpack) {
+    memcpy(buffer + header_len, packed.data, body_len);
+    free(packed.data);
+  } else if (json_serialize_to_buffer(root, buffer + header_len, json_size) !=
+             JSONSuccess) {
     free(buffer);
     json_value_free(root);
     return false;
   }
 
-  buffer[json_size - 1U] = '\n';
-  buffer[json_size] = '\0';
+  const bool newline = framing == BENCH_FRAMING_NEWLINE;
+  if (newline) {
+    buffer[header_len + body_len] = '\n';
+  }
+  if (framing == BENCH_FRAMING_WEBSOCKET) {
+    // Masking is the same XOR as unmasking.
+    uint8_t *body = (uint8_t *)buffer + header_len;
+    jsonrpc_ws_unmask(body, body, body_len,
+                      (const uint8_t *)header + header_len - 4, 0U);
+  }
   out->data = buffer;
-  out->len = json_size;
+  out->len = (size_t)header_len + body_len + (newline ? 1U : 0U);
 
   json_value_free(root);
   return true;
@@ -418,24 +572,119 @@ static void conn_fail(bench_conn_t *conn, const char *reason) {
   return true;
 }
 
-static bool conn_consume_lines(bench_conn_t *conn) {
+// Length of the first complete response in recv_buf, header or delimiter
+// included, or 0 while it is incomplete.
+static size_t conn_response_len(const bench_conn_t *conn) {
+  const uint8_t *data = conn->recv_buf;
+  const size_t len = conn->recv_len;
+  switch (conn->ctx->options.framing) {
+  case BENCH_FRAMING_NEWLINE: {
+    const uint8_t *newline = (const uint8_t *)memchr(data, '\n', len);
+    return newline == nullptr ? 0U : (size_t)(newline - data) + 1U;
+  }
+  case BENCH_FRAMING_LENGTH: {
+    if (len < 4U) {
+      return 0U;
+    }
+    const size_t frame_len = 4U + ((size_t)data[0] << 24U |
+                                   (size_t)data[1] << 16U |
+                                   (size_t)data[2] << 8U | (size_t)data[3]);
+    return frame_len <= len ? frame_len : 0U;
+  }
+  case BENCH_FRAMING_CONTENT_LENGTH: {
+    static const char name[] = "Content-Length: ";
+    const size_t name_len = sizeof(name) - 1U;
+    if (len < name_len || memcmp(data, name, name_len) != 0) {
+      return 0U;
+    }
+    size_t i = name_len;
+    size_t body_len = 0U;
+    while (i < len && data[i] >= '0' && data[i] <= '9') {
+      body_len = body_len * 10U + (size_t)(data[i] - '0');
+      i += 1U;
+    }
+    if (len - i < 4U || memcmp(data + i, "\r\n\r\n", 4U) != 0) {
+      return 0U;
+    }
+    const size_t frame_len = i + 4U + body_len;
+    return frame_len <= len ? frame_len : 0U;
+  }
+  case BENCH_FRAMING_HTTP: {
+    // The server always sends Content-Length, except on 204 No Content.
+    const uint8_t *end = (const uint8_t *)memmem(data, len, "\r\n\r\n", 4U);
+    if (end == nullptr) {
+      return 0U;
+    }
+    const size_t header_len = (size_t)(end - data) + 4U;
+    static const char name[] = "\r\nContent-Length: ";
+    const uint8_t *field =
+        (const uint8_t *)memmem(data, header_len, name, sizeof(name) - 1U);
+    size_t body_len = 0U;
+    if (field != nullptr) {
+      for (const uint8_t *c = field + sizeof(name) - 1U; *c >= '0' && *c <= '9';
+           ++c) {
+        body_len = body_len * 10U + (size_t)(*c - '0');
+      }
+    }
+    const size_t frame_len = header_len + body_len;
+    return frame_len <= len ? frame_len : 0U;
+  }
+  case BENCH_FRAMING_WEBSOCKET: {
+    if (!conn->upgraded) {
+      const uint8_t *end =
+          (const uint8_t *)memmem(data, len, "\r\n\r\n", 4U);
+      return end == nullptr ? 0U : (size_t)(end - data) + 4U;
+    }
+    if (len < 2U) {
+      return 0U;
+    }
+    const size_t length7 = data[1] & 0x7FU;
+    const size_t length_bytes =
+        length7 == 127U ? 8U : length7 == 126U ? 2U : 0U;
+    if (len < 2U + length_bytes) {
+      return 0U;
+    }
+    size_t body_len = length_bytes == 0U ? length7 : 0U;
+    for (size_t i = 0U; i < length_bytes; ++i) {
+      body_len = body_len << 8U | data[2U + i];
+    }
+    const size_t frame_len = 2U + length_bytes + body_len;
+    return frame_len <= len ? frame_len : 0U;
+  }
+  }
+  return 0U;
+}
+
+static bool conn_consume_responses(bench_conn_t *conn) {
   if (conn == nullptr) {
     return false;
   }
   bool got_response = false;
   while (conn->recv_len > 0U) {
-    uint8_t *newline = (uint8_t *)memchr(conn->recv_buf, '\n', conn->recv_len);
-    if (newline == nullptr) {
+    const size_t response_len = conn_response_len(conn);
+    if (response_len == 0U) {
       break;
     }
-    const size_t line_len = (size_t)(newline - (uint8_t *)conn->recv_buf);
-    const size_t remaining = conn->recv_len - line_len - 1U;
+    if (conn->ctx->options.framing == BENCH_FRAMING_WEBSOCKET &&
+        !conn->upgraded &&
+        memcmp(conn->recv_buf, "HTTP/1.1 101 ", 13U) != 0) {
+      conn_fail(conn, "WebSocket upgrade refused");
+      return false;
+    }
+    const size_t remaining = conn->recv_len - response_len;
     if (remaining > 0U) {
-      memmove(conn->recv_buf, conn->recv_buf + line_len + 1U, remaining);
+      memmove(conn->recv_buf, conn->recv_buf + response_len, remaining);
     }
     conn->recv_len = remaining;
-    conn->responses += 1U;
     got_response = true;
+    if (conn->ctx->options.framing == BENCH_FRAMING_WEBSOCKET &&
+        !conn->upgraded) {
+      // The handshake's answer is not counted as a response.
+      conn->upgraded = true;
+      continue;
+    }
+    conn->responses += 1U;
+    conn->latency_ns += uv_hrtime() - conn->sent_ns;
   }
   return got_response;
 }
@@ -484,9 +733,9 @@ static void conn_close(bench_conn_t *conn) {
     uv_close((uv_handle_t *)&conn->timeout_timer, nullptr);
   }
 
-  if (!uv_is_closing((uv_handle_t *)&conn->tcp)) {
-    uv_read_stop((uv_stream_t *)&conn->tcp);
-    uv_close((uv_handle_t *)&conn->tcp, on_conn_closed);
+  if (!uv_is_closing(&conn->io.handle)) {
+    uv_read_stop(&conn->io.stream);
+    uv_close(&conn->io.handle, on_conn_closed);
   }
 }
 
@@ -557,12 +806,28 @@ static void conn_send_next(bench_conn_t *conn) {
   }
 
   owned_buffer_t request = {.data = nullptr, .len = 0U};
-  if (!build_request(&request, ctx->options.method, ctx->params_value,
-                     conn->request_id + 1U)) {
+  if (ctx->options.framing == BENCH_FRAMING_WEBSOCKET && !conn->upgraded) {
+    static const char upgrade[] = "GET / HTTP/1.1\r\nHost: bench\r\n"
+                                  "Upgrade: websocket\r\n"
+                                  "Connection: Upgrade\r\n"
+                                  "Sec-WebSocket-Key: "
+                                  "dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                                  "Sec-WebSocket-Version: 13\r\n\r\n";
+    request.len = sizeof(upgrade) - 1U;
+    request.data = (char *)calloc(request.len, 1U);
+    if (request.data == nullptr) {
+      conn_fail(conn, "failed to build request");
+      return;
+    }
+    memcpy(request.data, upgrade, request.len);
+  } else if (!build_request(&request, ctx->options.method, ctx->params_value,
+                            conn->request_id + 1U, ctx->options.framing,
+                            ctx->options.msgpack)) {
     conn_fail(conn, "failed to build request");
     return;
+  } else {
+    conn->request_id += 1U;
   }
-  conn->request_id += 1U;
 
   write_ctx_t *write_ctx = (write_ctx_t *)calloc(1U, sizeof(write_ctx_t));
   if (write_ctx == nullptr) {
@@ -582,8 +847,9 @@ static void conn_send_next(bench_conn_t *conn) {
 
   uv_buf_t buf = uv_buf_init(write_ctx->payload, (unsigned int)write_ctx->len);
   conn->write_inflight = true;
+  conn->sent_ns = uv_hrtime();
   const int rc =
-      uv_write(&write_ctx->req, (uv_stream_t *)&conn->tcp, &buf, 1, on_write);
+      uv_write(&write_ctx->req, &conn->io.stream, &buf, 1, on_write);
   if (rc != 0) {
     conn->write_inflight = false;
     free(write_ctx->payload);
@@ -615,7 +881,7 @@ static void on_read(uv_stream_t *stream, ssize_t nread, const uv_buf_t *buf) {
       conn_fail(conn, "response too large");
       return;
     }
-    if (conn_consume_lines(conn)) {
+    if (conn_consume_responses(conn)) {
       conn_stop_timeout(conn);
       conn->awaiting_response = false;
       if (conn->ctx != nullptr && conn->ctx->send_enabled) {
@@ -648,7 +914,7 @@ static void on_connect(uv_connect_t *req, int status) {
   conn->connected = true;
 
   const int read_status =
-      uv_read_start((uv_stream_t *)&conn->tcp, on_alloc, on_read);
+      uv_read_start(&conn->io.stream, on_alloc, on_read);
   if (read_status != 0) {
     conn_fail(conn, uv_strerror(read_status));
     return;
@@ -685,19 +951,21 @@ static void on_duration(uv_timer_t *timer) {
   conn->index = index;
   conn->ctx = ctx;
 
-  const int tcp_status = uv_tcp_init(&ctx->loop, &conn->tcp);
-  if (tcp_status != 0) {
-    fprintf(stderr, "connection %" PRId32 ": tcp init failed: %s\n", index,
-            uv_strerror(tcp_status));
+  const bool use_pipe = ctx->options.unix_path != nullptr;
+  const int io_status = use_pipe ? uv_pipe_init(&ctx->loop, &conn->io.pipe, 0)
+                                 : uv_tcp_init(&ctx->loop, &conn->io.tcp);
+  if (io_status != 0) {
+    fprintf(stderr, "connection %" PRId32 ": %s init failed: %s\n", index,
+            use_pipe ? "pipe" : "tcp", uv_strerror(io_status));
     return false;
   }
-  conn->tcp.data = conn;
+  conn->io.handle.data = conn;
 
   const int timer_status = uv_timer_init(&ctx->loop, &conn->timeout_timer);
   if (timer_status != 0) {
     fprintf(stderr, "connection %" PRId32 ": timer init failed: %s\n", index,
             uv_strerror(timer_status));
-    uv_close((uv_handle_t *)&conn->tcp, on_conn_closed);
+    uv_close(&conn->io.handle, on_conn_closed);
     return false;
   }
   conn->timeout_timer.data = conn;
@@ -707,7 +975,7 @@ static void on_duration(uv_timer_t *timer) {
     fprintf(stderr, "connection %" PRId32 ": read buffer alloc failed\n",
             index);
     uv_close((uv_handle_t *)&conn->timeout_timer, nullptr);
-    uv_close((uv_handle_t *)&conn->tcp, on_conn_closed);
+    uv_close(&conn->io.handle, on_conn_closed);
     return false;
   }
   conn->read_chunk_cap = READ_CHUNK_BYTES;
@@ -727,7 +995,8 @@ int main(int argc, char **argv) {
     fprintf(stderr, "--connections must be > 0\n");
     return 2;
   }
-  if (options.port <= 0 || options.port > UINT16_MAX) {
+  if (options.unix_path == nullptr &&
+      (options.port <= 0 || options.port > UINT16_MAX)) {
     fprintf(stderr, "--port must be in range 1..65535\n");
     return 2;
   }
@@ -755,7 +1024,8 @@ int main(int argc, char **argv) {
   ctx.params_value = params_value;
   ctx.send_enabled = true;
 
-  if (!resolve_host(options.host, options.port, &ctx.addr, &ctx.addr_len)) {
+  if (options.unix_path == nullptr &&
+      !resolve_host(options.host, options.port, &ctx.addr, &ctx.addr_len)) {
     json_value_free(params_value);
     return 2;
   }
@@ -794,9 +1064,15 @@ int main(int argc, char **argv) {
     }
 
     conn->connect_req.data = conn;
-    const int rc =
-        uv_tcp_connect(&conn->connect_req, &conn->tcp,
-                       (const struct sockaddr *)&ctx.addr, on_connect);
+    int rc = 0;
+    if (options.unix_path != nullptr) {
+      // Failures are reported to on_connect.
+      uv_pipe_connect(&conn->connect_req, &conn->io.pipe, options.unix_path,
+                      on_connect);
+    } else {
+      rc = uv_tcp_connect(&conn->connect_req, &conn->io.tcp,
+                          (const struct sockaddr *)&ctx.addr, on_connect);
+    }
     if (rc != 0) {
       fprintf(stderr, "connection %" PRId32 ": connect failed: %s\n",
               conn->index, uv_strerror(rc));
@@ -828,18 +1104,25 @@ int main(int argc, char **argv) {
   }
 
   uint64_t total = 0U;
+  uint64_t latency_ns = 0U;
   for (size_t i = 0; i < conn_count; ++i) {
     total += ctx.connections[i].responses;
+    latency_ns += ctx.connections[i].latency_ns;
   }
 
   const double elapsed_sec = (double)(ctx.end_ns - ctx.start_ns) / NS_PER_SEC;
   const double rps = elapsed_sec > 0.0 ? (double)total / elapsed_sec : 0.0;
+  const double avg_latency_ms =
+      total > 0U
+          ? (double)latency_ns / (double)total / NS_PER_SEC * MS_PER_SEC
+          : 0.0;
 
   printf("connections=%" PRId32 "\n", options.connections);
   printf("responses=%" PRIu64 "\n", total);
   printf("timeouts=%" PRIu64 "\n", ctx.timed_out_conns);
   printf("elapsed_sec=%.3f\n", elapsed_sec);
   printf("rps=%.1f\n", rps);
+  printf("avg_latency_ms=%.3f\n", avg_latency_ms);
 
   uv_timer_stop(&ctx.duration_timer);
   uv_close((uv_handle_t *)&ctx.duration_timer, nullptr);